@@ -0,0 +1,18 @@
+QT       -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = RayNmeaSimCli
+
+# Headless runner on QCoreApplication, same simulation core as the GUI
+include(simcore.pri)
+
+SOURCES += \
+    src/simcli.cpp
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,31 @@
+QT       -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = RayNmeaSimBench
+
+# Benchmarks and round-trip checks for the simulation core. Run "RayNmeaSimBench all" or one of
+# the names it lists; a failed check makes the exit code non-zero.
+include(../simcore.pri)
+
+SOURCES += \
+    actisensebench.cpp \
+    benchmain.cpp \
+    capturebench.cpp \
+    dispatchbench.cpp \
+    fleetbench.cpp \
+    geodesybench.cpp \
+    logconverterbench.cpp \
+    navigationbench.cpp \
+    replaybench.cpp \
+    routeloaderbench.cpp \
+    schedulerbench.cpp
+
+HEADERS += \
+    bench.h
+
+linux {
+    SOURCES += socketcanbench.cpp
+}
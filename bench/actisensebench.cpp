@@ -0,0 +1,188 @@
+#include <QElapsedTimer>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "actisensebstparser.h"
+#include "actisensecodec.h"
+#include "bench.h"
+#include "nmea2000_actisense.h"
+
+namespace {
+
+constexpr int DefaultMessages = 200000;
+constexpr int EncodeRounds = 20;
+// Received stream for the parser, fed in the chunk size onSerialDataAvailable reads
+constexpr int FeedBytes = 64 << 20;
+constexpr int FeedChunk = 4096;
+// The NGT-1 at its fastest baud rate, 8N1; the parser may use at most this share of a core for it
+constexpr double LineBytesPerSecond = 230400 / 10.0;
+constexpr double MaxCoreShare = 0.10;
+
+// Every fourth payload is nothing but DLE, the rest mix DLE, STX and ETX into random bytes so
+// escaped DLE STX and DLE ETX pairs show up inside frames
+void randomMessage(std::mt19937 &random, tN2kMsg &N2kMsg)
+{
+    N2kMsg.Clear();
+    N2kMsg.Priority = static_cast<unsigned char>(random() % 8);
+    N2kMsg.SetPGN(random() % 0x40000);
+    N2kMsg.Destination = static_cast<unsigned char>(random());
+    N2kMsg.DataLen = static_cast<int>(random() % (tN2kMsg::MaxDataLen + 1));
+    const bool allDle = random() % 4 == 0;
+    for (int i = 0; i < N2kMsg.DataLen; i++) {
+        const unsigned kind = random() % 8;
+        N2kMsg.Data[i] = allDle || kind < 2 ? ActisenseCodec::Dle
+                         : kind == 2        ? ActisenseCodec::Stx
+                         : kind == 3        ? ActisenseCodec::Etx
+                                            : static_cast<unsigned char>(random());
+    }
+}
+
+// Sent (0x94) messages carry no source, so it is not compared
+bool sameMessage(const tN2kMsg &a, const tN2kMsg &b)
+{
+    return a.PGN == b.PGN && a.Priority == b.Priority && a.Destination == b.Destination && a.DataLen == b.DataLen
+           && memcmp(a.Data, b.Data, static_cast<size_t>(a.DataLen)) == 0;
+}
+
+// What a busy bus looks like from the NGT-1: received (0x93) frames of single frame, fast packet and
+// transport sizes back to back
+std::vector<uint8_t> receivedStream(std::mt19937 &random, int bytes, int &frames)
+{
+    std::vector<uint8_t> stream;
+    stream.reserve(static_cast<size_t>(bytes) + ActisenseCodec::maxEncodedLength(NMEA2000_Actisense::MaxBodyLen));
+    uint8_t body[NMEA2000_Actisense::MaxBodyLen];
+    uint8_t frame[ActisenseCodec::maxEncodedLength(NMEA2000_Actisense::MaxBodyLen)];
+    static const int lengths[] = {8, 8, 8, 8, 14, 20, 43, 8, 8, 134};
+    tN2kMsg N2kMsg;
+    frames = 0;
+    while (static_cast<int>(stream.size()) < bytes) {
+        N2kMsg.Clear();
+        N2kMsg.Priority = 2;
+        N2kMsg.SetPGN(126208L + random() % 4000);
+        N2kMsg.Source = static_cast<unsigned char>(random() % 250);
+        N2kMsg.Destination = 255;
+        N2kMsg.DataLen = lengths[frames % 10];
+        for (int i = 0; i < N2kMsg.DataLen; i++) {
+            N2kMsg.Data[i] = static_cast<unsigned char>(random());
+        }
+        const int length = NMEA2000_Actisense::encodeBody(N2kMsg, true, static_cast<uint32_t>(frames), body, sizeof(body));
+        const int written = ActisenseCodec::encodeFrame(body, length, frame);
+        stream.insert(stream.end(), frame, frame + written);
+        frames++;
+    }
+    return stream;
+}
+
+// Escape and unescape against a byte by byte reference
+int checkCodec(std::mt19937 &random)
+{
+    int failures = 0;
+    uint8_t data[1024];
+    uint8_t escaped[2 * sizeof(data)];
+    uint8_t unescaped[sizeof(escaped)];
+    for (int round = 0; round < 20000; round++) {
+        const int length = static_cast<int>(random() % (sizeof(data) + 1));
+        const unsigned density = random() % 4;
+        int dles = 0;
+        for (int i = 0; i < length; i++) {
+            data[i] = random() % 8 < density ? ActisenseCodec::Dle : static_cast<uint8_t>(random());
+            dles += data[i] == ActisenseCodec::Dle;
+        }
+        int firstDle = 0;
+        while (firstDle < length && data[firstDle] != ActisenseCodec::Dle) {
+            firstDle++;
+        }
+        const int escapedLen = ActisenseCodec::escape(data, length, escaped);
+        const int unescapedLen = ActisenseCodec::unescape(escaped, escapedLen, unescaped);
+        if (ActisenseCodec::findEscape(data, length) != firstDle || escapedLen != length + dles || unescapedLen != length
+            || memcmp(unescaped, data, static_cast<size_t>(length)) != 0) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+}
+
+// Random messages through encodeMessages, the BST parser (fed in random chunk sizes) and
+// decodeMessage must come back unchanged, and the codec must agree with a scalar reference.
+// Encoding throughput is measured on the same messages, parsing throughput on a received stream
+// as dense as the NGT-1 delivers it.
+int Bench::actisense(const QStringList &args)
+{
+    const int messages = args.isEmpty() ? DefaultMessages : args.first().toInt();
+    if (messages < 1) {
+        std::printf("actisense: need at least one message\n");
+        return 1;
+    }
+
+    std::mt19937 random(2);
+    const int codecFailures = checkCodec(random);
+    std::printf("actisense: escape/unescape fuzz, %d mismatches\n", codecFailures);
+
+    std::vector<tN2kMsg> sent(static_cast<size_t>(messages));
+    for (tN2kMsg &N2kMsg : sent) {
+        randomMessage(random, N2kMsg);
+    }
+    std::vector<uint8_t> stream(static_cast<size_t>(messages) * NMEA2000_Actisense::MaxEncodedMessageLen);
+    int encoded = 0;
+    const int streamBytes = NMEA2000_Actisense::encodeMessages(sent.data(), messages, stream.data(),
+                                                              static_cast<int>(stream.size()), encoded);
+
+    ActisenseBstParser parser;
+    int received = 0;
+    int mismatched = 0;
+    tN2kMsg N2kMsg;
+    auto onFrame = [&](const ActisenseBstParser::Frame &frame) {
+        if (!NMEA2000_Actisense::decodeMessage(frame.data, frame.length, N2kMsg)
+            || received >= messages || !sameMessage(N2kMsg, sent[static_cast<size_t>(received)])) {
+            mismatched++;
+        }
+        received++;
+    };
+    for (int pos = 0; pos < streamBytes;) {
+        const int chunk = qMin(streamBytes - pos, static_cast<int>(1 + random() % 600));
+        parser.feed(stream.data() + pos, chunk, onFrame);
+        pos += chunk;
+    }
+    const ActisenseBstParser::Statistics &parsed = parser.statistics();
+    std::printf("actisense: %d of %d messages round-tripped, %d mismatches, %llu checksum and %llu framing errors\n",
+                received - mismatched, messages, mismatched, static_cast<unsigned long long>(parsed.checksumErrors),
+                static_cast<unsigned long long>(parsed.framingErrors));
+
+    // Encoding alone, the whole batch into one buffer as SerialTxQueue does
+    QElapsedTimer timer;
+    timer.start();
+    quint64 encodedBytes = 0;
+    for (int round = 0; round < EncodeRounds; round++) {
+        int count = 0;
+        encodedBytes += static_cast<quint64>(NMEA2000_Actisense::encodeMessages(sent.data(), messages, stream.data(),
+                                                                                static_cast<int>(stream.size()), count));
+    }
+    const double encodeS = timer.nsecsElapsed() / 1e9;
+    std::printf("actisense: encode %.0f MB/s, %.0f ns per message (%.0f DLE-heavy bytes per message)\n",
+                encodedBytes / encodeS / 1e6, encodeS * 1e9 / (static_cast<double>(messages) * EncodeRounds),
+                static_cast<double>(streamBytes) / messages);
+
+    // Parsing and decoding a saturated receive stream, the way onSerialDataAvailable does
+    int streamFrames = 0;
+    const std::vector<uint8_t> feed = receivedStream(random, FeedBytes, streamFrames);
+    ActisenseBstParser feedParser;
+    int decoded = 0;
+    timer.restart();
+    for (size_t pos = 0; pos < feed.size(); pos += FeedChunk) {
+        const int chunk = static_cast<int>(qMin<size_t>(FeedChunk, feed.size() - pos));
+        feedParser.feed(feed.data() + pos, chunk, [&](const ActisenseBstParser::Frame &frame) {
+            decoded += NMEA2000_Actisense::decodeMessage(frame.data, frame.length, N2kMsg);
+        });
+    }
+    const double parseS = timer.nsecsElapsed() / 1e9;
+    const double parseBytesPerSecond = feed.size() / parseS;
+    const double coreShare = LineBytesPerSecond / parseBytesPerSecond;
+    std::printf("actisense: parse and decode %.0f MB/s, %.0f frames/s, %.4f%% of a core at 230400 baud (limit %.0f%%)\n",
+                parseBytesPerSecond / 1e6, streamFrames / parseS, 100 * coreShare, 100 * MaxCoreShare);
+
+    const bool ok = decoded == streamFrames && coreShare <= MaxCoreShare && codecFailures == 0 && encoded == messages && received == messages && mismatched == 0
+                    && parsed.checksumErrors == 0 && parsed.framingErrors == 0 && parsed.overruns == 0;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <QStringList>
+
+// Each bench takes the arguments after its name (none when run through "all") and returns 0, or
+// non-zero when one of its checks failed
+namespace Bench {
+
+int actisense(const QStringList &args);
+int capture(const QStringList &args);
+int dispatch(const QStringList &args);
+int fleet(const QStringList &args);
+int geodesy(const QStringList &args);
+int logConverter(const QStringList &args);
+int navigation(const QStringList &args);
+int replay(const QStringList &args);
+int routeLoader(const QStringList &args);
+int scheduler(const QStringList &args);
+#ifdef Q_OS_LINUX
+int socketCan(const QStringList &args);
+#endif
+
+// Peak resident set size of the process so far, -1 where the platform does not report it
+qint64 peakRssBytes();
+
+// Every TrackNameEvery-th point of a generated track is named "WP <n>"
+constexpr int TrackNameEvery = 1000;
+// GPX track along 59.5 N heading east, spacingDeg of longitude between points
+bool writeTrackGpx(const QString &path, int points, double spacingDeg);
+
+}
+
+#endif // BENCH_H
@@ -0,0 +1,87 @@
+#include <QCoreApplication>
+#include <cstdio>
+#include "bench.h"
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+qint64 Bench::peakRssBytes()
+{
+#ifdef Q_OS_UNIX
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MACOS
+        return static_cast<qint64>(usage.ru_maxrss);
+#else
+        return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return -1;
+}
+
+namespace {
+
+struct Entry {
+    const char *name;
+    const char *arguments;
+    const char *description;
+    int (*run)(const QStringList &args);
+};
+
+const Entry entries[] = {
+    {"actisense", "[messages]", "BST encode, parse and decode round trip with DLE-heavy payloads, MB/s", Bench::actisense},
+    {"capture", "[records]", "write a capture, reopen it and seek by time and by PGN, ns/record and us/seek", Bench::capture},
+    {"dispatch", "[pgns]", "N2kDispatcher against an if/else chain with 240 subscribed PGNs, messages/s", Bench::dispatch},
+    {"fleet", "[minutes]", "virtual fleets of 54 to 252 devices on a stepped clock, messages/s", Bench::fleet},
+    {"geodesy", "[points]", "batch geodesy kernels against Reference and QGeoCoordinate, error and speedup", Bench::geodesy},
+    {"logconverter", "[messages]", "capture to EBL, candump and CANboat and back, MB/s and digest checks", Bench::logConverter},
+    {"navigation", "[hours]", "autopilot navigation PGNs on a stepped clock, PGNs/s and stream counts", Bench::navigation},
+    {"replay", "[seconds]", "replay a generated capture at 1x, 100x and flat out, timing error and lost frames", Bench::replay},
+    {"routeloader", "[points]", "parse a generated GPX track, report MB/s and peak memory", Bench::routeLoader},
+    {"scheduler", "[streams]", "5000 PGN streams from 10 ms to 60 s, per tick overhead and firing counts", Bench::scheduler},
+#ifdef Q_OS_LINUX
+    {"socketcan", "[interface] [messages]", "send and receive through SocketCAN, frames/s and CPU per frame", Bench::socketCan},
+#endif
+};
+
+void printUsage()
+{
+    std::printf("usage: RayNmeaSimBench all | <bench> [arguments]\n");
+    for (const Entry &entry : entries) {
+        std::printf("  %-12s %-24s %s\n", entry.name, entry.arguments, entry.description);
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("RayNmeaSimBench");
+
+    QStringList args = QCoreApplication::arguments().mid(1);
+    if (args.isEmpty()) {
+        printUsage();
+        return 2;
+    }
+    const QString name = args.takeFirst();
+    const bool all = name == "all";
+
+    bool found = false;
+    int failed = 0;
+    for (const Entry &entry : entries) {
+        if (all || name == entry.name) {
+            found = true;
+            if (entry.run(all ? QStringList() : args) != 0) {
+                std::printf("%s: FAILED\n", entry.name);
+                failed++;
+            }
+        }
+    }
+    if (!found) {
+        printUsage();
+        return 2;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "capturereader.h"
+#include "capturewriter.h"
+
+namespace {
+
+constexpr int DefaultRecords = 2000000;
+constexpr int TimeSeeks = 100000;
+// Shows up once every RarePgnEvery records, so most index blocks do not have it
+constexpr unsigned long RarePgn = 126464L;
+constexpr int RarePgnEvery = 50000;
+
+const unsigned long pgns[] = {127250, 127488, 128267, 129025, 129026, 129029, 130306, 130310};
+const int lengths[] = {8, 8, 8, 8, 8, 43, 8, 8};
+constexpr int PgnCount = static_cast<int>(sizeof(pgns) / sizeof(pgns[0]));
+
+}
+
+// Millions of records written at a bus-like mix, then reopened: a full scan has to return every
+// record in order, seekTime has to land on the first record at or after a random time, and
+// nextWithPgn has to find every record of each PGN, including one that most index blocks skip.
+int Bench::capture(const QStringList &args)
+{
+    const int records = args.isEmpty() ? DefaultRecords : args.first().toInt();
+    if (records < 1) {
+        std::printf("capture: need at least one record\n");
+        return 1;
+    }
+
+    std::mt19937 random(21);
+    tN2kMsg messages[PgnCount + 1];
+    for (int i = 0; i <= PgnCount; i++) {
+        tN2kMsg &N2kMsg = messages[i];
+        N2kMsg.Priority = 2;
+        N2kMsg.SetPGN(i < PgnCount ? pgns[i] : RarePgn);
+        N2kMsg.Source = static_cast<unsigned char>(10 + i);
+        N2kMsg.DataLen = i < PgnCount ? lengths[i] : 8;
+        for (int b = 0; b < N2kMsg.DataLen; b++) {
+            N2kMsg.Data[b] = static_cast<unsigned char>(random());
+        }
+    }
+    std::vector<qint64> timestamps(static_cast<size_t>(records));
+    std::vector<uint8_t> kinds(static_cast<size_t>(records));
+    std::vector<quint64> expectedPerPgn(PgnCount + 1);
+    qint64 timestampUs = 1700000000000000LL;
+    for (int i = 0; i < records; i++) {
+        timestampUs += 1 + random() % 1000;
+        timestamps[static_cast<size_t>(i)] = timestampUs;
+        kinds[static_cast<size_t>(i)] = static_cast<uint8_t>(i % RarePgnEvery == RarePgnEvery - 1 ? PgnCount : random() % PgnCount);
+        expectedPerPgn[kinds[static_cast<size_t>(i)]]++;
+    }
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath("bench.cap");
+    CaptureWriter writer;
+    if (!dir.isValid() || !writer.open(path)) {
+        std::printf("capture: unable to write %s\n", qPrintable(path));
+        return 1;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < records; i++) {
+        writer.write(messages[kinds[static_cast<size_t>(i)]], timestamps[static_cast<size_t>(i)], i % 7 == 0);
+    }
+    writer.close();
+    const double writeS = timer.nsecsElapsed() / 1e9;
+    const CaptureWriter::Statistics written = writer.statistics();
+    std::printf("capture: wrote %d records, %.1f MB, %llu index blocks in %.3f s (%.0f ns per record, %.0f MB/s)\n", records,
+                written.bytes / 1e6, static_cast<unsigned long long>(written.indexBlocks), writeS, writeS * 1e9 / records,
+                written.bytes / writeS / 1e6);
+
+    CaptureReader reader;
+    QString error;
+    timer.restart();
+    if (!reader.open(path, &error)) {
+        std::printf("capture: %s\n", qPrintable(error));
+        return 1;
+    }
+    const double openS = timer.nsecsElapsed() / 1e9;
+
+    // Everything in order, as written
+    timer.restart();
+    quint64 scanned = 0;
+    quint64 wrongRecords = 0;
+    CaptureReader::Record record;
+    for (uint64_t offset = reader.begin(); reader.next(offset, record); scanned++) {
+        if (scanned >= static_cast<quint64>(records) || record.timestampUs != timestamps[scanned]
+            || record.PGN != messages[kinds[scanned]].PGN || record.dataLen != messages[kinds[scanned]].DataLen
+            || record.transmitted != (scanned % 7 == 0)) {
+            wrongRecords++;
+        }
+    }
+    const double scanS = timer.nsecsElapsed() / 1e9;
+    std::printf("capture: reopened in %.2f ms, %llu of %d records (%llu wrong), full scan %.1f M records/s\n", openS * 1e3,
+                static_cast<unsigned long long>(reader.recordCount()), records, static_cast<unsigned long long>(wrongRecords),
+                scanned / scanS / 1e6);
+
+    // By time, a little before the first to a little after the last record
+    std::uniform_int_distribution<qint64> seekTime(timestamps.front() - 1000, timestamps.back() + 1000);
+    std::vector<qint64> times(TimeSeeks);
+    for (qint64 &time : times) {
+        time = seekTime(random);
+    }
+    std::vector<uint64_t> offsets(TimeSeeks);
+    timer.restart();
+    for (int i = 0; i < TimeSeeks; i++) {
+        offsets[static_cast<size_t>(i)] = reader.seekTime(times[static_cast<size_t>(i)]);
+    }
+    const double seekS = timer.nsecsElapsed() / 1e9;
+    int wrongSeeks = 0;
+    for (int i = 0; i < TimeSeeks; i++) {
+        const auto expected = std::lower_bound(timestamps.begin(), timestamps.end(), times[static_cast<size_t>(i)]);
+        uint64_t offset = offsets[static_cast<size_t>(i)];
+        const bool found = reader.next(offset, record);
+        if (expected == timestamps.end() ? found : !found || record.timestampUs != *expected) {
+            wrongSeeks++;
+        }
+    }
+    std::printf("capture: %d seeks by time, %.2f us each, %d wrong\n", TimeSeeks, seekS * 1e6 / TimeSeeks, wrongSeeks);
+
+    // By PGN, every record of each one from the start
+    int wrongPgns = 0;
+    for (int i = 0; i <= PgnCount; i++) {
+        const unsigned long PGN = messages[i].PGN;
+        quint64 found = 0;
+        timer.restart();
+        for (uint64_t offset = reader.begin(); reader.nextWithPgn(offset, PGN, record); found++) {
+            if (record.PGN != PGN) {
+                break;
+            }
+        }
+        const double pgnS = timer.nsecsElapsed() / 1e9;
+        const bool right = found == expectedPerPgn[i];
+        wrongPgns += !right;
+        if (i == PgnCount || !right) {
+            std::printf("capture: PGN %lu, %llu of %llu records in %.2f ms (%.1fx faster than the full scan)%s\n", PGN,
+                        static_cast<unsigned long long>(found), static_cast<unsigned long long>(expectedPerPgn[i]),
+                        pgnS * 1e3, scanS / pgnS, right ? "" : "  <- wrong count");
+        }
+    }
+
+    const bool ok = written.writeErrors == 0 && written.records == static_cast<quint64>(records) && reader.wasClosedCleanly()
+                    && reader.recordCount() == static_cast<quint64>(records) && scanned == static_cast<quint64>(records)
+                    && wrongRecords == 0 && wrongSeeks == 0 && wrongPgns == 0;
+    return ok ? 0 : 1;
+}
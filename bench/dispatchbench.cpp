@@ -0,0 +1,98 @@
+#include <QElapsedTimer>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "n2kdispatcher.h"
+
+namespace {
+
+constexpr int DefaultPGNs = 240;
+constexpr int Messages = 4096;
+constexpr int Rounds = 2000;
+
+// The if/else chain on N2kMsg.PGN the dispatcher replaces: every PGN compared in registration order
+struct IfElseChain {
+    std::vector<unsigned long> pgns;
+    std::vector<N2kDispatcher::Handler> handlers;
+
+    bool dispatch(const tN2kMsg &N2kMsg) const
+    {
+        for (size_t i = 0; i < pgns.size(); i++) {
+            if (N2kMsg.PGN == pgns[i]) {
+                handlers[i](N2kMsg);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}
+
+// Dispatch rate with a few hundred subscribed PGNs, half of the traffic unsubscribed, against the
+// if/else chain it replaces. Both have to deliver the same messages to the same handlers.
+int Bench::dispatch(const QStringList &args)
+{
+    const int pgnCount = args.isEmpty() ? DefaultPGNs : args.first().toInt();
+    if (pgnCount < 1) {
+        std::printf("dispatch: need at least one PGN\n");
+        return 1;
+    }
+
+    // Registered PGNs scattered over the proprietary and standard ranges in random order
+    std::mt19937 random(6);
+    std::vector<unsigned long> pgns;
+    std::vector<bool> taken(N2kDispatcher::MaxPGN + 1);
+    while (static_cast<int>(pgns.size()) < pgnCount) {
+        const unsigned long PGN = 126208 + random() % 5000;
+        if (!taken[PGN]) {
+            taken[PGN] = true;
+            pgns.push_back(PGN);
+        }
+    }
+
+    std::vector<quint64> tableHits(pgns.size());
+    std::vector<quint64> chainHits(pgns.size());
+    N2kDispatcher dispatcher;
+    IfElseChain chain;
+    for (size_t i = 0; i < pgns.size(); i++) {
+        dispatcher.registerHandler(pgns[i], [&tableHits, i](const tN2kMsg &) { tableHits[i]++; });
+        chain.pgns.push_back(pgns[i]);
+        chain.handlers.push_back([&chainHits, i](const tN2kMsg &) { chainHits[i]++; });
+    }
+
+    std::vector<tN2kMsg> messages(Messages);
+    for (tN2kMsg &N2kMsg : messages) {
+        N2kMsg.SetPGN(random() % 2 ? pgns[random() % pgns.size()] : 59392 + random() % 80000);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    quint64 tableDelivered = 0;
+    for (int round = 0; round < Rounds; round++) {
+        tableDelivered += dispatcher.dispatch(messages.data(), messages.size());
+    }
+    const double tableS = timer.nsecsElapsed() / 1e9;
+
+    timer.restart();
+    quint64 chainDelivered = 0;
+    for (int round = 0; round < Rounds; round++) {
+        for (const tN2kMsg &N2kMsg : messages) {
+            chainDelivered += chain.dispatch(N2kMsg);
+        }
+    }
+    const double chainS = timer.nsecsElapsed() / 1e9;
+
+    const double total = static_cast<double>(Messages) * Rounds;
+    std::printf("dispatch: %d PGNs, %.1f%% of the traffic subscribed\n", pgnCount, 100.0 * tableDelivered / total);
+    std::printf("dispatch: sorted table and filter %.1f M/s (%.1f ns per message), if/else chain %.1f M/s (%.1f ns), %.1fx\n",
+                total / tableS / 1e6, tableS * 1e9 / total, total / chainS / 1e6, chainS * 1e9 / total, chainS / tableS);
+
+    const bool ok = tableDelivered == chainDelivered && tableHits == chainHits && tableS < chainS;
+    if (!ok) {
+        std::printf("dispatch: table delivered %llu, chain %llu\n", static_cast<unsigned long long>(tableDelivered),
+                    static_cast<unsigned long long>(chainDelivered));
+    }
+    return ok ? 0 : 1;
+}
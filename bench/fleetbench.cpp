@@ -0,0 +1,78 @@
+#include <QElapsedTimer>
+#include <cstdio>
+#include "bench.h"
+#include "nmea2000handler.h"
+#include "pgnscheduler.h"
+#include "simulationclock.h"
+#include "virtualn2kfleet.h"
+
+namespace {
+
+constexpr int DefaultMinutes = 10;
+constexpr int StepMs = 10;
+// Devices in one addStandardBoat() with its default two engines and four tanks
+constexpr int DevicesPerBoat = 9;
+// Messages per simulated second of one such boat: GPS 10 + 4, engines 2 x 10, tanks 4 x 0.4, wind 10, depth 1
+constexpr double MessagesPerBoatSecond = 46.6;
+
+}
+
+// Fleets of about 50, 100 and 250 devices built from standard boats, stepped on a manual clock with
+// the scheduler feeding a sink that only counts. Every device has to claim its own address and the
+// streams have to deliver their nominal rate over the simulated time.
+int Bench::fleet(const QStringList &args)
+{
+    const int minutes = args.isEmpty() ? DefaultMinutes : args.first().toInt();
+    if (minutes < 1) {
+        std::printf("fleet: need at least one simulated minute\n");
+        return 1;
+    }
+
+    Nmea2000Handler handler;
+    PgnScheduler scheduler;
+    SimulationClock clock;
+    VirtualN2kFleet fleet(handler, scheduler);
+    fleet.setClock(&clock);
+    quint64 sunk = 0;
+    scheduler.setSink([&sunk](const tN2kMsg *, int count) {
+        sunk += static_cast<quint64>(count);
+        return count;
+    });
+    QObject::connect(&clock, &SimulationClock::tick, &scheduler, [&scheduler](qint64 nowMs, qint64) {
+        scheduler.advanceTo(nowMs);
+    });
+
+    bool ok = true;
+    const qint64 durationMs = minutes * 60 * 1000LL;
+    for (const int boats : {6, 12, VirtualN2kFleet::MaxDevices / DevicesPerBoat}) {
+        fleet.clear();
+        for (int boat = 0; boat < boats; boat++) {
+            fleet.addStandardBoat();
+        }
+        sunk = 0;
+        fleet.start();
+
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 t = 0; t < durationMs; t += StepMs) {
+            clock.advance(StepMs);
+        }
+        const double wallS = timer.nsecsElapsed() / 1e9;
+        const VirtualN2kFleet::Statistics stats = fleet.statistics();
+        fleet.stop();
+
+        int claimed = 0;
+        for (int address = 0; address < VirtualN2kFleet::NullAddress; address++) {
+            claimed += fleet.deviceAtAddress(static_cast<uint8_t>(address)) >= 0;
+        }
+        const double expected = boats * MessagesPerBoatSecond * durationMs / 1000.0;
+        const bool passed = claimed == fleet.deviceCount() && sunk == stats.messagesGenerated
+                            && sunk >= 0.99 * expected && sunk <= 1.01 * expected;
+        std::printf("fleet: %3d devices, %d addresses claimed, %9llu messages (expected %.0f) in %.2f s, %.0f messages/s, "
+                    "%.0f per simulated second%s\n",
+                    fleet.deviceCount(), claimed, static_cast<unsigned long long>(sunk), expected, wallS, sunk / wallS,
+                    stats.messagesPerSecond, passed ? "" : "  <- wrong count");
+        ok = ok && passed;
+    }
+    return ok ? 0 : 1;
+}
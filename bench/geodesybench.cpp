@@ -0,0 +1,170 @@
+#include <QElapsedTimer>
+#include <QGeoCoordinate>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "geodesy.h"
+
+namespace {
+
+constexpr int DefaultPoints = 1000000;
+constexpr int Rounds = 5;
+
+// Largest deviation of the batch kernels from Geodesy::Reference that is accepted
+constexpr double MaxDistanceErrorM = 1e-5;
+constexpr double MaxBearingErrorRad = 1e-9;
+constexpr double MaxDestinationErrorM = 1e-5;
+constexpr double MaxCrossTrackErrorM = 1e-5;
+
+// Best of a few runs, so a stray context switch does not decide the speedup
+template<typename Kernel>
+double bestSeconds(Kernel &&kernel)
+{
+    double best = 1e30;
+    for (int round = 0; round < Rounds; round++) {
+        QElapsedTimer timer;
+        timer.start();
+        kernel();
+        best = std::min(best, timer.nsecsElapsed() / 1e9);
+    }
+    return best;
+}
+
+double maxDifference(const std::vector<double> &a, const std::vector<double> &b)
+{
+    double worst = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        worst = std::max(worst, std::fabs(a[i] - b[i]));
+    }
+    return worst;
+}
+
+void report(const char *kernel, int points, double batchS, double referenceS, double qtS, double error, const char *unit,
+            double limit)
+{
+    std::printf("geodesy: %-14s %6.1f M/s batch, %5.1fx Reference, %5.1fx QGeoCoordinate, max error %.2g %s (limit %.0g)%s\n",
+                kernel, points / batchS / 1e6, referenceS / batchS, qtS / batchS, error, unit, limit,
+                error <= limit ? "" : "  <- too large");
+}
+
+}
+
+// The batch kernels against Geodesy::Reference for accuracy and against Reference and
+// QGeoCoordinate for speed: point pairs all over the globe for distance and bearing, up to 500 km
+// runs for the destination point and points within 50 km of a 100 km leg for the cross track error.
+int Bench::geodesy(const QStringList &args)
+{
+    const int points = args.isEmpty() ? DefaultPoints : args.first().toInt();
+    if (points < 1) {
+        std::printf("geodesy: need at least one point\n");
+        return 1;
+    }
+    const size_t n = static_cast<size_t>(points);
+
+    std::mt19937_64 random(13);
+    std::uniform_real_distribution<double> latitude(-80.0, 80.0);
+    std::uniform_real_distribution<double> longitude(-180.0, 180.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<double> lat1(n), lon1(n), lat2(n), lon2(n), bearing(n), distance(n);
+    std::vector<QGeoCoordinate> from(n), to(n);
+    for (size_t i = 0; i < n; i++) {
+        lat1[i] = latitude(random);
+        lon1[i] = longitude(random);
+        lat2[i] = latitude(random);
+        lon2[i] = longitude(random);
+        bearing[i] = unit(random) * 2.0 * M_PI;
+        distance[i] = unit(random) * 500000.0;
+        from[i] = QGeoCoordinate(lat1[i], lon1[i]);
+        to[i] = QGeoCoordinate(lat2[i], lon2[i]);
+    }
+    // A 100 km leg north-east from 59.5 N 10.5 E and points scattered around it
+    const double startLat = 59.5, startLon = 10.5, endLat = 60.1, endLon = 11.9;
+    std::vector<double> nearLat(n), nearLon(n);
+    for (size_t i = 0; i < n; i++) {
+        nearLat[i] = startLat - 0.5 + 1.1 * unit(random);
+        nearLon[i] = startLon - 1.0 + 2.4 * unit(random);
+    }
+
+    std::vector<double> batch(n), reference(n), batch2(n), reference2(n), qt(n);
+    bool ok = true;
+
+    const double distanceBatchS = bestSeconds([&] { Geodesy::distance(lat1.data(), lon1.data(), lat2.data(), lon2.data(), batch.data(), n); });
+    const double distanceReferenceS = bestSeconds([&] {
+        Geodesy::Reference::distance(lat1.data(), lon1.data(), lat2.data(), lon2.data(), reference.data(), n);
+    });
+    const double distanceQtS = bestSeconds([&] {
+        for (size_t i = 0; i < n; i++) {
+            qt[i] = from[i].distanceTo(to[i]);
+        }
+    });
+    const double distanceError = maxDifference(batch, reference);
+    report("distance", points, distanceBatchS, distanceReferenceS, distanceQtS, distanceError, "m", MaxDistanceErrorM);
+    ok = ok && distanceError <= MaxDistanceErrorM;
+
+    const double bearingBatchS = bestSeconds([&] {
+        Geodesy::initialBearing(lat1.data(), lon1.data(), lat2.data(), lon2.data(), batch.data(), n);
+    });
+    const double bearingReferenceS = bestSeconds([&] {
+        Geodesy::Reference::initialBearing(lat1.data(), lon1.data(), lat2.data(), lon2.data(), reference.data(), n);
+    });
+    const double bearingQtS = bestSeconds([&] {
+        for (size_t i = 0; i < n; i++) {
+            qt[i] = qDegreesToRadians(from[i].azimuthTo(to[i]));
+        }
+    });
+    // Both sides of north are the same direction
+    double bearingError = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        const double difference = std::fabs(batch[i] - reference[i]);
+        bearingError = std::max(bearingError, std::min(difference, 2.0 * M_PI - difference));
+    }
+    report("initialBearing", points, bearingBatchS, bearingReferenceS, bearingQtS, bearingError, "rad", MaxBearingErrorRad);
+    ok = ok && bearingError <= MaxBearingErrorRad;
+
+    const double destinationBatchS = bestSeconds([&] {
+        Geodesy::destination(lat1.data(), lon1.data(), bearing.data(), distance.data(), batch.data(), batch2.data(), n);
+    });
+    const double destinationReferenceS = bestSeconds([&] {
+        Geodesy::Reference::destination(lat1.data(), lon1.data(), bearing.data(), distance.data(), reference.data(),
+                                        reference2.data(), n);
+    });
+    const double destinationQtS = bestSeconds([&] {
+        for (size_t i = 0; i < n; i++) {
+            qt[i] = from[i].atDistanceAndAzimuth(distance[i], qRadiansToDegrees(bearing[i])).latitude();
+        }
+    });
+    // How far apart the two destination points are
+    std::vector<double> apart(n);
+    Geodesy::Reference::distance(batch.data(), batch2.data(), reference.data(), reference2.data(), apart.data(), n);
+    const double destinationError = *std::max_element(apart.begin(), apart.end());
+    report("destination", points, destinationBatchS, destinationReferenceS, destinationQtS, destinationError, "m",
+           MaxDestinationErrorM);
+    ok = ok && destinationError <= MaxDestinationErrorM;
+
+    const double crossTrackBatchS = bestSeconds([&] {
+        Geodesy::crossTrack(nearLat.data(), nearLon.data(), n, startLat, startLon, endLat, endLon, batch.data());
+    });
+    const double crossTrackReferenceS = bestSeconds([&] {
+        Geodesy::Reference::crossTrack(nearLat.data(), nearLon.data(), n, startLat, startLon, endLat, endLon, reference.data());
+    });
+    // What the autopilot did per point before the leg table: distance and two azimuths from the leg start
+    const QGeoCoordinate legStart(startLat, startLon), legEnd(endLat, endLon);
+    const double crossTrackQtS = bestSeconds([&] {
+        for (size_t i = 0; i < n; i++) {
+            const QGeoCoordinate point(nearLat[i], nearLon[i]);
+            const double angle = legStart.distanceTo(point) / Geodesy::EarthRadiusM;
+            const double offset = qDegreesToRadians(legStart.azimuthTo(point) - legStart.azimuthTo(legEnd));
+            qt[i] = std::asin(std::sin(angle) * std::sin(offset)) * Geodesy::EarthRadiusM;
+        }
+    });
+    const double crossTrackError = maxDifference(batch, reference);
+    report("crossTrack", points, crossTrackBatchS, crossTrackReferenceS, crossTrackQtS, crossTrackError, "m",
+           MaxCrossTrackErrorM);
+    ok = ok && crossTrackError <= MaxCrossTrackErrorM;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include <QFile>
+#include <QTemporaryDir>
+#include <cstdio>
+#include <random>
+#include "bench.h"
+#include "capturewriter.h"
+#include "n2klogconverter.h"
+
+namespace {
+
+constexpr int DefaultMessages = 300000;
+
+// Single frame, fast packet, BAM and RTS sized messages, payloads heavy in the bytes the EBL and BST
+// framing escape (0x10, 0x1B), every seventh one flagged as sent by us
+bool writeCapture(const QString &path, int messages)
+{
+    CaptureWriter writer;
+    if (!writer.open(path)) {
+        return false;
+    }
+    std::mt19937 random(5);
+    qint64 timestampUs = 1700000000000000LL;
+    tN2kMsg N2kMsg;
+    for (int i = 0; i < messages; i++) {
+        N2kMsg.Clear();
+        N2kMsg.Priority = static_cast<unsigned char>(2 + i % 5);
+        N2kMsg.Source = static_cast<unsigned char>(random() % 250);
+        N2kMsg.Destination = 255;
+        switch (i % 6) {
+        case 0: N2kMsg.SetPGN(129025L); N2kMsg.DataLen = 8; break;
+        case 1: N2kMsg.SetPGN(129029L); N2kMsg.DataLen = 43; break;
+        case 2: N2kMsg.SetPGN(127250L); N2kMsg.DataLen = 8; break;
+        case 3: N2kMsg.SetPGN(130000L); N2kMsg.DataLen = 20; break;
+        case 4: N2kMsg.SetPGN(59904L); N2kMsg.Destination = 5; N2kMsg.DataLen = 12; break;
+        default: N2kMsg.SetPGN(126996L); N2kMsg.DataLen = 134; break;
+        }
+        for (int b = 0; b < N2kMsg.DataLen; b++) {
+            const unsigned kind = random() % 8;
+            N2kMsg.Data[b] = kind == 0 ? 0x1B : kind == 1 ? 0x10 : static_cast<unsigned char>(random());
+        }
+        timestampUs += random() % 2000;
+        writer.write(N2kMsg, timestampUs, i % 7 == 0);
+    }
+    writer.close();
+    return writer.statistics().writeErrors == 0;
+}
+
+// Changes the last payload digit of a CANboat log, which stays well formed
+bool corruptLastByte(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite) || file.size() < 2 || !file.seek(file.size() - 2)) {
+        return false;
+    }
+    char digit;
+    if (!file.getChar(&digit) || !file.seek(file.size() - 2)) {
+        return false;
+    }
+    return file.putChar(digit == '0' ? '1' : '0');
+}
+
+}
+
+// Capture to each field format and back with verification on. Candump and CANboat keep every field
+// the digest covers, so their final capture has to match the original one; EBL drops the source of
+// messages we sent, so it is only checked by the converter's own read-back. A corrupted payload digit
+// has to change the digest.
+int Bench::logConverter(const QStringList &args)
+{
+    const int messages = args.isEmpty() ? DefaultMessages : args.first().toInt();
+    QTemporaryDir dir;
+    const QString capture = dir.filePath("original.cap");
+    if (!dir.isValid() || messages < 1 || !writeCapture(capture, messages)) {
+        std::printf("logconverter: unable to write %s\n", qPrintable(capture));
+        return 1;
+    }
+
+    N2kLogConverter::Options options;
+    const N2kLogConverter::Result original = N2kLogConverter::count(capture, N2kLogFormat::Type::Capture, options);
+    bool ok = original.ok && original.messages == static_cast<quint64>(messages);
+
+    struct Format {
+        N2kLogFormat::Type type;
+        const char *file;
+        bool keepsEveryField;
+    };
+    const Format formats[] = {
+        {N2kLogFormat::Type::ActisenseEbl, "out.ebl", false},
+        {N2kLogFormat::Type::Candump, "out.log", true},
+        {N2kLogFormat::Type::CanboatText, "out.txt", true},
+    };
+    for (const Format &format : formats) {
+        const QString name = N2kLogFormat::typeName(format.type);
+        const QString output = dir.filePath(format.file);
+        const QString back = dir.filePath("back.cap");
+        const N2kLogConverter::Result there = N2kLogConverter::convert(capture, N2kLogFormat::Type::Capture, output, format.type, options);
+        const N2kLogConverter::Result again = N2kLogConverter::convert(output, format.type, back, N2kLogFormat::Type::Capture, options);
+        bool passed = there.ok && again.ok && again.messages == original.messages;
+        if (format.keepsEveryField) {
+            const N2kLogConverter::Result final = N2kLogConverter::count(back, N2kLogFormat::Type::Capture, options);
+            passed = passed && final.ok && final.digest == original.digest;
+        }
+        std::printf("logconverter: capture -> %-8s %7.1f MB at %4.0f MB/s, back at %4.0f MB/s, %llu messages %s%s\n", qPrintable(name),
+                    there.outputBytes / 1e6, there.megabytesPerSecond(), again.megabytesPerSecond(),
+                    static_cast<unsigned long long>(again.messages), passed ? "identical" : "MISMATCH",
+                    there.ok && again.ok ? "" : qPrintable(" (" + there.error + again.error + ")"));
+        ok = ok && passed;
+    }
+
+    // The digest has to notice a changed payload byte that leaves the count alone
+    const QString text = dir.filePath("out.txt");
+    const N2kLogConverter::Result before = N2kLogConverter::count(text, N2kLogFormat::Type::CanboatText, options);
+    const bool corrupted = corruptLastByte(text);
+    const N2kLogConverter::Result after = N2kLogConverter::count(text, N2kLogFormat::Type::CanboatText, options);
+    const bool detected = corrupted && after.messages == before.messages && after.digest != before.digest;
+    std::printf("logconverter: changed payload byte %s\n", detected ? "detected" : "NOT detected");
+    return ok && detected ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <cstdio>
+#include <cstdlib>
+#include "autopilotsimulator.h"
+#include "bench.h"
+#include "navigationn2kbridge.h"
+#include "pgnscheduler.h"
+#include "simulationclock.h"
+
+namespace {
+
+constexpr int DefaultHours = 24;
+constexpr int StepMs = 10;
+constexpr int RoutePoints = 200;
+constexpr double RouteSpacingDeg = 0.01;    // About 560 m a leg at 59.5 N
+
+}
+
+// The autopilot, the bridge and the scheduler driven by a stepped clock as fast as they go. Every
+// stream has to come out once per period over the whole run, while most of them are copied from
+// the cached message instead of encoded again.
+int Bench::navigation(const QStringList &args)
+{
+    const int hours = args.isEmpty() ? DefaultHours : args.first().toInt();
+    if (hours < 1) {
+        std::printf("navigation: need at least one simulated hour\n");
+        return 1;
+    }
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath("route.gpx");
+    if (!dir.isValid() || !writeTrackGpx(path, RoutePoints, RouteSpacingDeg)) {
+        std::printf("navigation: unable to write %s\n", qPrintable(path));
+        return 1;
+    }
+
+    SimulationClock clock;
+    AutoPilotSimulator autoPilot;
+    autoPilot.setClock(&clock);
+    autoPilot.setRouteCacheEnabled(false);
+    autoPilot.setReverseRoute(true);
+    autoPilot.setSpeed(10.0);
+    if (!autoPilot.loadRoute(path)) {
+        std::printf("navigation: unable to load the route\n");
+        return 1;
+    }
+
+    PgnScheduler scheduler;
+    NavigationN2kBridge bridge(autoPilot, scheduler);
+    quint64 sunk = 0;
+    quint64 empty = 0;
+    scheduler.setSink([&sunk, &empty](const tN2kMsg *N2kMsgs, int count) {
+        for (int i = 0; i < count; i++) {
+            empty += N2kMsgs[i].DataLen == 0;
+        }
+        sunk += static_cast<quint64>(count);
+        return count;
+    });
+    QObject::connect(&clock, &SimulationClock::tick, &scheduler, [&scheduler](qint64 nowMs, qint64) {
+        scheduler.advanceTo(nowMs);
+    });
+
+    autoPilot.start();
+    clock.stop();   // Started by the autopilot, advanced by hand below
+    bridge.start();
+
+    const qint64 durationMs = hours * 3600 * 1000LL;
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 t = 0; t < durationMs; t += StepMs) {
+        clock.advance(StepMs);
+    }
+    const double wallS = timer.nsecsElapsed() / 1e9;
+
+    bool ok = empty == 0;
+    const NavigationN2kBridge::Statistics stats = bridge.statistics();
+    for (int message = 0; message < NavigationN2kBridge::MessageCount; ++message) {
+        const auto which = static_cast<NavigationN2kBridge::Message>(message);
+        const int periodMs = bridge.period(which);
+        const qint64 expected = periodMs > 0 ? durationMs / periodMs : 0;
+        const bool inRange = std::llabs(static_cast<long long>(stats.generated[message]) - expected) <= 2;
+        std::printf("navigation: %lu every %5d ms: %9llu sent (expected %lld), %9llu encoded%s\n", NavigationN2kBridge::pgn(which),
+                    periodMs, static_cast<unsigned long long>(stats.generated[message]), static_cast<long long>(expected),
+                    static_cast<unsigned long long>(stats.encoded[message]), inRange ? "" : "  <- wrong count");
+        ok = ok && inRange;
+    }
+    ok = ok && sunk == stats.totalGenerated();
+
+    std::printf("navigation: %d h simulated in %.2f s, %.0f PGNs/s, %.0f ns per PGN including the autopilot, %.1f%% encoded\n",
+                hours, wallS, stats.totalGenerated() / wallS, wallS * 1e9 / qMax<quint64>(1, stats.totalGenerated()),
+                100.0 * stats.totalEncoded() / qMax<quint64>(1, stats.totalGenerated()));
+    if (empty) {
+        std::printf("navigation: %llu empty messages\n", static_cast<unsigned long long>(empty));
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cstdio>
+#include <cstring>
+#include "bench.h"
+#include "capturereplayer.h"
+#include "capturewriter.h"
+
+namespace {
+
+// Seconds of the capture played at 1x; the faster runs play a capture Fast times as long
+constexpr int DefaultSeconds = 3;
+constexpr double Fast = 100.0;
+constexpr int MessagesPerSecond = 2000;
+// How long past the end of the capture a timed run may take before it counts as stuck
+constexpr qint64 GraceUs = 10000000;
+
+const unsigned long pgns[] = {127250, 128267, 129025, 129026, 130306};
+constexpr int PgnCount = static_cast<int>(sizeof(pgns) / sizeof(pgns[0]));
+
+// Evenly spaced records numbered in their first four payload bytes, so the sink can tell a lost or
+// reordered frame
+bool writeCapture(const QString &path, int seconds)
+{
+    CaptureWriter writer;
+    if (!writer.open(path)) {
+        return false;
+    }
+    const int messages = seconds * MessagesPerSecond;
+    tN2kMsg N2kMsg;
+    for (int i = 0; i < messages; i++) {
+        N2kMsg.Clear();
+        N2kMsg.Priority = 2;
+        N2kMsg.SetPGN(pgns[i % PgnCount]);
+        N2kMsg.Source = static_cast<unsigned char>(10 + i % PgnCount);
+        N2kMsg.DataLen = 8;
+        const uint32_t number = static_cast<uint32_t>(i);
+        memcpy(N2kMsg.Data, &number, sizeof(number));
+        writer.write(N2kMsg, 1700000000000000LL + static_cast<qint64>(i) * 1000000 / MessagesPerSecond);
+    }
+    writer.close();
+    return writer.statistics().writeErrors == 0;
+}
+
+}
+
+// A generated capture replayed into a sink that only counts and checks the numbering: at the
+// original speed, at 100x and flat out. No frame may be lost or reordered, a timed run may not
+// finish before the capture's last record is due, and the timing error percentiles are reported.
+int Bench::replay(const QStringList &args)
+{
+    const int seconds = args.isEmpty() ? DefaultSeconds : args.first().toInt();
+    if (seconds < 1) {
+        std::printf("replay: need at least one second\n");
+        return 1;
+    }
+
+    QTemporaryDir dir;
+    const QString shortPath = dir.filePath("short.cap");
+    const QString longPath = dir.filePath("long.cap");
+    if (!dir.isValid() || !writeCapture(shortPath, seconds) || !writeCapture(longPath, static_cast<int>(seconds * Fast))) {
+        std::printf("replay: unable to write the captures in %s\n", qPrintable(dir.filePath("")));
+        return 1;
+    }
+
+    bool ok = true;
+    for (const double speed : {1.0, Fast, 0.0}) {
+        CaptureReplayer replayer;
+        QString error;
+        if (!replayer.open(speed == 1.0 ? shortPath : longPath, &error)) {
+            std::printf("replay: %s\n", qPrintable(error));
+            return 1;
+        }
+        const CaptureReader &reader = replayer.reader();
+        const quint64 expected = reader.recordCount();
+        const qint64 spanUs = reader.lastTimestampUs() - reader.firstTimestampUs();
+
+        // Called from the replay thread only; read here once isRunning() is false
+        quint64 received = 0;
+        quint64 outOfOrder = 0;
+        replayer.setSink([&received, &outOfOrder](const tN2kMsg *N2kMsgs, int count) {
+            for (int i = 0; i < count; i++) {
+                uint32_t number;
+                memcpy(&number, N2kMsgs[i].Data, sizeof(number));
+                outOfOrder += number != received;
+                received++;
+            }
+            return count;
+        });
+        CaptureReplayer::Options options;
+        options.speed = speed;
+        replayer.setOptions(options);
+
+        const qint64 limitUs = (speed > 0.0 ? static_cast<qint64>(spanUs / speed) : 0) + GraceUs;
+        if (!replayer.start()) {
+            std::printf("replay: unable to start at speed %g\n", speed);
+            return 1;
+        }
+        QElapsedTimer timer;
+        timer.start();
+        while (replayer.isRunning() && timer.nsecsElapsed() / 1000 < limitUs) {
+            QThread::msleep(5);
+        }
+        const bool stuck = replayer.isRunning();
+        replayer.stop();
+
+        const CaptureReplayer::Statistics stats = replayer.statistics();
+        const bool early = speed > 0.0 && stats.elapsedUs < static_cast<qint64>(spanUs / speed);
+        const bool passed = !stuck && !early && received == expected && stats.frames == expected && outOfOrder == 0;
+        std::printf("replay: speed %-5g %llu of %llu frames, %llu out of order, %llu stalls in %.3f s (%.0f frames/s)%s\n",
+                    speed, static_cast<unsigned long long>(received), static_cast<unsigned long long>(expected),
+                    static_cast<unsigned long long>(outOfOrder), static_cast<unsigned long long>(stats.stalls),
+                    stats.elapsedUs / 1e6, stats.framesPerSecond,
+                    stuck ? "  <- did not finish" : early ? "  <- finished early" : passed ? "" : "  <- lost or reordered frames");
+        if (speed > 0.0) {
+            const LatencyHistogram::Snapshot &timing = stats.timingError;
+            std::printf("replay: speed %-5g timing error %.1f us mean, p50 %llu us, p99 %llu us, p99.9 %llu us, max %llu us\n",
+                        speed, timing.meanUs(), static_cast<unsigned long long>(timing.percentileUs(50)),
+                        static_cast<unsigned long long>(timing.percentileUs(99)),
+                        static_cast<unsigned long long>(timing.percentileUs(99.9)),
+                        static_cast<unsigned long long>(timing.maxUs));
+        }
+        ok = ok && passed;
+    }
+    return ok ? 0 : 1;
+}
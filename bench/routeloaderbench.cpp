@@ -0,0 +1,121 @@
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <cmath>
+#include <cstdio>
+#include "autopilotsimulator.h"
+#include "bench.h"
+#include "routeloader.h"
+
+// Written in 1 MB pieces so the generator does not raise the peak the route loader bench measures
+bool Bench::writeTrackGpx(const QString &path, int points, double spacingDeg)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QByteArray chunk("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                     "<gpx version=\"1.1\" creator=\"RayNmeaSimBench\">\n<trk><name>Bench</name><trkseg>\n");
+    char line[160];
+    for (int i = 0; i < points; i++) {
+        const double latitude = 59.5 + 0.2 * std::sin(i * 1e-4);
+        const double longitude = 20.0 + i * spacingDeg;
+        const int length = i % TrackNameEvery == 0
+            ? std::snprintf(line, sizeof(line), "<trkpt lat=\"%.7f\" lon=\"%.7f\"><ele>0.0</ele><name>WP %d</name></trkpt>\n",
+                            latitude, longitude, i / TrackNameEvery)
+            : std::snprintf(line, sizeof(line), "<trkpt lat=\"%.7f\" lon=\"%.7f\"><ele>0.0</ele><time>2024-06-01T12:00:00Z</time></trkpt>\n",
+                            latitude, longitude);
+        chunk.append(line, length);
+        if (chunk.size() >= (1 << 20)) {
+            if (file.write(chunk) != chunk.size()) {
+                return false;
+            }
+            chunk.clear();
+        }
+    }
+    chunk += "</trkseg></trk>\n</gpx>\n";
+    return file.write(chunk) == chunk.size();
+}
+
+namespace {
+
+constexpr int DefaultPoints = 1200000;
+constexpr double SpacingDeg = 1e-5;
+// Peak RSS growth allowed while loading, in file sizes. The mapped file plus the growing columns
+// (about 1.6 for the bench GPX) or the columns plus the leg table (about 1.4) fit, a DOM or a
+// QByteArray copy of the file does not.
+constexpr double MaxPeakFiles = 2.0;
+
+double megabytes(qint64 bytes)
+{
+    return bytes / 1e6;
+}
+
+}
+
+int Bench::routeLoader(const QStringList &args)
+{
+    const int points = args.isEmpty() ? DefaultPoints : args.first().toInt();
+    if (points < 2) {
+        std::printf("routeloader: need at least 2 points\n");
+        return 1;
+    }
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath("bench.gpx");
+    if (!dir.isValid() || !writeTrackGpx(path, points, SpacingDeg)) {
+        std::printf("routeloader: unable to write %s\n", qPrintable(path));
+        return 1;
+    }
+    const qint64 fileBytes = QFileInfo(path).size();
+    const int expectedNames = (points + TrackNameEvery - 1) / TrackNameEvery;
+    bool ok = true;
+
+    // Parser alone
+    const qint64 peakStart = peakRssBytes();
+    QElapsedTimer timer;
+    timer.start();
+    RouteData data;
+    QString error;
+    if (!RouteLoader::load(path, data, &error)) {
+        std::printf("routeloader: %s\n", qPrintable(error));
+        return 1;
+    }
+    const double parseS = timer.nsecsElapsed() / 1e9;
+    const qint64 peakParse = peakRssBytes();
+    if (data.size() != static_cast<size_t>(points) || data.names.size() != expectedNames) {
+        std::printf("routeloader: got %zu points and %d names, expected %d and %d\n", data.size(),
+                    static_cast<int>(data.names.size()), points, expectedNames);
+        ok = false;
+    }
+    std::printf("routeloader: %d points, %.1f MB GPX parsed in %.3f s (%.0f MB/s), result %.1f MB (%.1f bytes/point)\n",
+                points, megabytes(fileBytes), parseS, megabytes(fileBytes) / parseS, megabytes(data.memoryBytes()),
+                static_cast<double>(data.memoryBytes()) / points);
+    data = RouteData();
+
+    // The autopilot path: parse, compile the leg table and keep the columns, no cache
+    AutoPilotSimulator autoPilot;
+    autoPilot.setRouteCacheEnabled(false);
+    timer.restart();
+    if (!autoPilot.loadRoute(path) || autoPilot.routeData().size() != static_cast<size_t>(points)) {
+        std::printf("routeloader: AutoPilotSimulator::loadRoute did not load %d points\n", points);
+        ok = false;
+    }
+    const double loadS = timer.nsecsElapsed() / 1e9;
+    const qint64 peakLoad = peakRssBytes();
+    std::printf("routeloader: AutoPilotSimulator::loadRoute in %.3f s, %d legs\n", loadS, autoPilot.routeGeometry().legCount());
+
+    // Touched pages of the mapping count towards RSS, so the file size is an upper bound of what
+    // the peak includes besides the result
+    if (peakStart >= 0) {
+        const qint64 limit = static_cast<qint64>(MaxPeakFiles * fileBytes);
+        const bool bounded = peakParse - peakStart <= limit && peakLoad - peakStart <= limit;
+        std::printf("routeloader: peak RSS +%.1f MB after parsing, +%.1f MB after loadRoute (file %.1f MB, mapped, "
+                    "limit %.1f MB)%s\n",
+                    megabytes(peakParse - peakStart), megabytes(peakLoad - peakStart), megabytes(fileBytes),
+                    megabytes(limit), bounded ? "" : "  <- too much memory");
+        ok = ok && bounded;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "pgnscheduler.h"
+
+namespace {
+
+constexpr int DefaultStreams = 5000;
+constexpr int Minutes = 10;
+// The scheduler's own default tick interval
+constexpr int TickMs = 5;
+// Scheduling overhead allowed per tick at the 99th percentile
+constexpr double MaxTickUs = 1000.0;
+
+const int periodsMs[] = {10, 20, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 60000};
+
+}
+
+// Thousands of streams between 10 ms and 60 s, a third of them with jitter, advanced in the
+// scheduler's own 5 ms ticks over ten simulated minutes. Every stream has to fire once per period
+// and the time spent in advanceTo, generators included, has to stay below a millisecond per tick.
+int Bench::scheduler(const QStringList &args)
+{
+    const int streamCount = args.isEmpty() ? DefaultStreams : args.first().toInt();
+    if (streamCount < 1) {
+        std::printf("scheduler: need at least one stream\n");
+        return 1;
+    }
+
+    PgnScheduler scheduler;
+    quint64 sunk = 0;
+    scheduler.setSink([&sunk](const tN2kMsg *, int count) {
+        sunk += static_cast<quint64>(count);
+        return count;
+    });
+
+    const int periodCount = static_cast<int>(sizeof(periodsMs) / sizeof(periodsMs[0]));
+    std::vector<quint64> fired(static_cast<size_t>(streamCount));
+    std::vector<int> streamPeriods(static_cast<size_t>(streamCount));
+    for (int i = 0; i < streamCount; i++) {
+        PgnScheduler::StreamOptions options;
+        options.periodMs = periodsMs[i % periodCount];
+        options.jitterMs = i % 3 == 0 ? options.periodMs / 10 : 0;
+        streamPeriods[static_cast<size_t>(i)] = options.periodMs;
+        const unsigned long PGN = 126208L + static_cast<unsigned long>(i % 4000);
+        scheduler.registerStream(PGN, options, [&fired, i, PGN](tN2kMsg &N2kMsg) {
+            N2kMsg.SetPGN(PGN);
+            N2kMsg.DataLen = 8;
+            fired[static_cast<size_t>(i)]++;
+            return true;
+        });
+    }
+
+    const qint64 durationMs = Minutes * 60 * 1000LL;
+    std::vector<double> tickUs;
+    tickUs.reserve(static_cast<size_t>(durationMs / TickMs));
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 t = TickMs; t <= durationMs; t += TickMs) {
+        scheduler.advanceTo(t);
+        tickUs.push_back(scheduler.statistics().lastTickUs);
+    }
+    const double wallS = timer.nsecsElapsed() / 1e9;
+
+    // Each stream fires once per period; the first firing falls within the first period and
+    // jitter can move the last one across the end of the run
+    int wrongStreams = 0;
+    for (int i = 0; i < streamCount; i++) {
+        const qint64 expected = durationMs / streamPeriods[static_cast<size_t>(i)];
+        if (std::llabs(static_cast<long long>(fired[static_cast<size_t>(i)]) - expected) > 1) {
+            wrongStreams++;
+        }
+    }
+
+    const PgnScheduler::Statistics stats = scheduler.statistics();
+    std::sort(tickUs.begin(), tickUs.end());
+    const double p50 = tickUs[tickUs.size() / 2];
+    const double p99 = tickUs[tickUs.size() * 99 / 100];
+    std::printf("scheduler: %d streams, %llu messages in %lld simulated s (%.0f per s), %.2f s wall\n", streamCount,
+                static_cast<unsigned long long>(sunk), static_cast<long long>(durationMs / 1000), sunk * 1000.0 / durationMs, wallS);
+    std::printf("scheduler: per %d ms tick %.1f us mean, %.1f us p50, %.1f us p99, %.1f us max (limit %.0f us at p99), "
+                "%.0f ns per message\n",
+                TickMs, stats.totalTickUs / qMax<quint64>(1, stats.ticks), p50, p99, stats.maxTickUs, MaxTickUs,
+                stats.totalTickUs * 1000.0 / qMax<quint64>(1, sunk));
+    std::printf("scheduler: lateness p99 below %llu us, %llu skipped periods, %d streams off their count\n",
+                static_cast<unsigned long long>(stats.lateness.percentileUs(99)),
+                static_cast<unsigned long long>(stats.skippedPeriods), wrongStreams);
+
+    const bool ok = wrongStreams == 0 && stats.skippedPeriods == 0 && sunk == stats.generated && p99 < MaxTickUs;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+#include "bench.h"
+#include "socketcantransport.h"
+
+namespace {
+
+constexpr int DefaultMessages = 200000;
+// Messages in flight, well inside the receiving socket's buffer so the kernel drops nothing
+constexpr int Window = 64;
+constexpr int StallMs = 2000;
+constexpr unsigned char Source = 42;
+
+// Single frame, fast packet, BAM and addressed single frame messages, numbered in the first four
+// payload bytes so a lost or reordered one shows up
+void makeMessage(int index, tN2kMsg &N2kMsg)
+{
+    N2kMsg.Clear();
+    N2kMsg.Priority = 3;
+    N2kMsg.Source = Source;
+    N2kMsg.Destination = 255;
+    switch (index % 4) {
+    case 0: N2kMsg.SetPGN(127250L); N2kMsg.DataLen = 8; break;
+    case 1: N2kMsg.SetPGN(129029L); N2kMsg.DataLen = 43; break;
+    case 2: N2kMsg.SetPGN(130000L); N2kMsg.DataLen = 20; break;
+    default: N2kMsg.SetPGN(59904L); N2kMsg.Destination = 5; N2kMsg.DataLen = 8; break;
+    }
+    for (int b = 0; b < N2kMsg.DataLen; b++) {
+        N2kMsg.Data[b] = b < 4 ? static_cast<unsigned char>(index >> (8 * b)) : static_cast<unsigned char>(index * 31 + b);
+    }
+}
+
+bool sameMessage(const tN2kMsg &a, const tN2kMsg &b)
+{
+    return a.PGN == b.PGN && a.Priority == b.Priority && a.Source == b.Source && a.Destination == b.Destination
+           && a.DataLen == b.DataLen && memcmp(a.Data, b.Data, static_cast<size_t>(a.DataLen)) == 0;
+}
+
+qint64 cpuTimeUs()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+}
+
+// Two transports on one CAN interface (vcan0 unless named): one sends, the other receives through a
+// kernel filter on the PGNs sent. Everything has to arrive complete and in order. Without the
+// interface (modprobe vcan; ip link add vcan0 type vcan; ip link set vcan0 up) the bench is skipped.
+int Bench::socketCan(const QStringList &args)
+{
+    const QString interfaceName = args.value(0, "vcan0");
+    const int messages = args.size() > 1 ? args.at(1).toInt() : DefaultMessages;
+    if (messages < 1) {
+        std::printf("socketcan: need at least one message\n");
+        return 1;
+    }
+
+    SocketCanTransport::Counters txCounters;
+    SocketCanTransport::Counters rxCounters;
+    SocketCanTransport tx(txCounters);
+    SocketCanTransport rx(rxCounters);
+    QString error;
+    if (!tx.open(interfaceName, {}, &error) || !rx.open(interfaceName, {127250, 129029, 130000, 59904}, &error)) {
+        std::printf("socketcan: skipped, %s\n", qPrintable(error));
+        return 0;
+    }
+
+    int sent = 0;
+    int received = 0;
+    int mismatched = 0;
+    tN2kMsg expected;
+    QObject::connect(&rx, &N2kTransport::nmea2000MessagesReceived, [&](const tN2kMsg *N2kMsgs, int count) {
+        for (int i = 0; i < count; i++) {
+            if (N2kMsgs[i].Source != Source) {
+                continue;   // Someone else on the interface
+            }
+            makeMessage(received++, expected);
+            if (!sameMessage(N2kMsgs[i], expected)) {
+                mismatched++;
+            }
+        }
+    });
+    // Wakes the loop below when nothing arrives any more
+    QTimer wakeUp;
+    wakeUp.start(100);
+
+    QElapsedTimer elapsed;
+    QElapsedTimer sinceProgress;
+    elapsed.start();
+    sinceProgress.start();
+    const qint64 cpuStartUs = cpuTimeUs();
+    tN2kMsg N2kMsg;
+    while (received < messages && sinceProgress.elapsed() < StallMs) {
+        while (sent < messages && sent - received < Window) {
+            makeMessage(sent, N2kMsg);
+            if (!tx.SendMessage(N2kMsg)) {
+                break;
+            }
+            sent++;
+        }
+        const int before = received;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        if (received != before) {
+            sinceProgress.restart();
+        }
+    }
+    const qint64 cpuUs = cpuTimeUs() - cpuStartUs;
+    const double seconds = elapsed.nsecsElapsed() / 1e9;
+
+    const SocketCanTransport::Statistics txStats = txCounters.snapshot();
+    const SocketCanTransport::Statistics rxStats = rxCounters.snapshot();
+    const quint64 frames = rxStats.framesReceived;
+    std::printf("socketcan: %s, %d messages, %llu frames in %.2f s, %.0f frames/s, %.1f frames per sendmmsg, "
+                "%.1f per recvmmsg, %.2f us CPU per frame\n",
+                qPrintable(interfaceName), received, static_cast<unsigned long long>(frames), seconds, frames / seconds,
+                txStats.framesPerCall(), rxStats.framesPerCall(), frames ? static_cast<double>(cpuUs) / frames : 0.0);
+    std::printf("socketcan: receive latency mean %.1f us, p99 below %llu us, %llu kernel drops\n", rxStats.rxLatency.meanUs(),
+                static_cast<unsigned long long>(rxStats.rxLatency.percentileUs(99)),
+                static_cast<unsigned long long>(rxStats.rxOverflows));
+
+    const bool ok = received == messages && mismatched == 0 && txStats.txDropped == 0 && rxStats.rxOverflows == 0;
+    if (!ok) {
+        std::printf("socketcan: %d of %d messages arrived, %d differ from what was sent, %llu refused\n", received, messages,
+                    mismatched, static_cast<unsigned long long>(txStats.txDropped));
+    }
+    return ok ? 0 : 1;
+}
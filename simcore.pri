@@ -0,0 +1,160 @@
+# Headless simulation core shared by the GUI (RayNmeaSim.pro) and the CLI runner
+# (RayNmeaSimCli.pro). Nothing in here may depend on QtWidgets.
+
+QT += core serialport positioning concurrent
+
+CONFIG += c++17
+
+# Define application version and some other constants
+APP_VERSION = 0.1.0
+APP_NAME = RayNmeaSim
+APP_COMPANY = RFStateSide
+APP_SECRET_KEY = ChangeMeIsAGoodIdea
+
+# Add the constants to the preprocessor defines
+DEFINES += APP_VERSION=\\\"$$APP_VERSION\\\"
+DEFINES += APP_NAME=\\\"$$APP_NAME\\\"
+DEFINES += APP_COMPANY=\\\"$$APP_COMPANY\\\"
+DEFINES += APP_SECRET_KEY=\\\"$$APP_SECRET_KEY\\\"
+
+# Platform-specific flags
+win32 {
+#    DEFINES += ACTISENSE
+    INCLUDEPATH += C:/Programming/Qt/RayNmeaSim/src
+    INCLUDEPATH += C:/Programming/Qt/NMEA2000/src
+}
+
+unix {
+#    DEFINES += LINUX_CAN
+    INCLUDEPATH += /home/pi/Programming/Qt/RayNmeaSim/src
+    INCLUDEPATH += /home/pi/Programming/Qt/NMEA2000/src
+
+}
+# INCLUDEPATH += /home/pi/Programming/Qt/NMEA2000/src
+INCLUDEPATH += /Programming/Qt/NMEA2000/src
+INCLUDEPATH += $$PWD/src $$PWD/../NMEA2000/src
+
+SOURCES += \
+$$PWD/../NMEA2000/src/ActisenseReader.cpp \
+$$PWD/../NMEA2000/src/N2kDeviceList.cpp \
+$$PWD/../NMEA2000/src/N2kGroupFunction.cpp \
+$$PWD/../NMEA2000/src/N2kGroupFunctionDefaultHandlers.cpp \
+$$PWD/../NMEA2000/src/N2kMaretron.cpp \
+$$PWD/../NMEA2000/src/N2kMessages.cpp \
+$$PWD/../NMEA2000/src/N2kMsg.cpp \
+$$PWD/../NMEA2000/src/N2kStream.cpp \
+$$PWD/../NMEA2000/src/N2kTimer.cpp \
+$$PWD/../NMEA2000/src/NMEA2000.cpp \
+$$PWD/../NMEA2000/src/Seasmart.cpp \
+    $$PWD/src/actisensebstparser.cpp \
+    $$PWD/src/actisensecodec.cpp \
+    $$PWD/src/actisenselink.cpp \
+    $$PWD/src/autopilotsimulator.cpp \
+    $$PWD/src/capturereader.cpp \
+    $$PWD/src/capturereplayer.cpp \
+    $$PWD/src/capturewriter.cpp \
+    $$PWD/src/convert.cpp \
+    $$PWD/src/latencyhistogram.cpp \
+    $$PWD/src/n2kdispatcher.cpp \
+    $$PWD/src/n2kframeassembler.cpp \
+    $$PWD/src/n2klogconverter.cpp \
+    $$PWD/src/n2klogformat.cpp \
+    $$PWD/src/navigationn2kbridge.cpp \
+    $$PWD/src/navigationstate.cpp \
+    $$PWD/src/nmea2000_actisense.cpp \
+    $$PWD/src/nmea2000handler.cpp \
+    $$PWD/src/pgnscheduler.cpp \
+    $$PWD/src/routecache.cpp \
+    $$PWD/src/routegeometry.cpp \
+    $$PWD/src/routeloader.cpp \
+    $$PWD/src/routesimplifier.cpp \
+    $$PWD/src/serialtxqueue.cpp \
+    $$PWD/src/simulationclock.cpp \
+    $$PWD/src/simulationengine.cpp \
+    $$PWD/src/timingwheel.cpp \
+    $$PWD/src/vesselpool.cpp \
+    $$PWD/src/virtualn2kfleet.cpp
+
+HEADERS += \
+$$PWD/../NMEA2000/src/ActisenseReader.h \
+$$PWD/../NMEA2000/src/N2kCANMsg.h \
+$$PWD/../NMEA2000/src/N2kDef.h \
+$$PWD/../NMEA2000/src/N2kDeviceList.h \
+$$PWD/../NMEA2000/src/N2kGroupFunction.h \
+$$PWD/../NMEA2000/src/N2kGroupFunctionDefaultHandlers.h \
+$$PWD/../NMEA2000/src/N2kMaretron.h \
+$$PWD/../NMEA2000/src/N2kMessages.h \
+$$PWD/../NMEA2000/src/N2kMessagesEnumToStr.h \
+$$PWD/../NMEA2000/src/N2kMsg.h \
+$$PWD/../NMEA2000/src/N2kStream.h \
+$$PWD/../NMEA2000/src/N2kTimer.h \
+$$PWD/../NMEA2000/src/N2kTypes.h \
+$$PWD/../NMEA2000/src/NMEA2000.h \
+$$PWD/../NMEA2000/src/NMEA2000StdTypes.h \
+$$PWD/../NMEA2000/src/NMEA2000_CAN.h \
+$$PWD/../NMEA2000/src/NMEA2000_CompilerDefns.h \
+$$PWD/../NMEA2000/src/RingBuffer.h \
+$$PWD/../NMEA2000/src/RingBuffer.tpp \
+$$PWD/../NMEA2000/src/Seasmart.h \
+    $$PWD/src/actisensebstparser.h \
+    $$PWD/src/actisensecodec.h \
+    $$PWD/src/actisenselink.h \
+    $$PWD/src/autopilotsimulator.h \
+    $$PWD/src/captureformat.h \
+    $$PWD/src/capturereader.h \
+    $$PWD/src/capturereplayer.h \
+    $$PWD/src/capturewriter.h \
+    $$PWD/src/convert.h \
+    $$PWD/src/geodesy.h \
+    $$PWD/src/latencyhistogram.h \
+    $$PWD/src/n2kdispatcher.h \
+    $$PWD/src/n2kframeassembler.h \
+    $$PWD/src/n2klogconverter.h \
+    $$PWD/src/n2klogformat.h \
+    $$PWD/src/n2ktransport.h \
+    $$PWD/src/navigationn2kbridge.h \
+    $$PWD/src/navigationstate.h \
+    $$PWD/src/nmea2000_actisense.h \
+    $$PWD/src/nmea2000handler.h \
+    $$PWD/src/pgnscheduler.h \
+    $$PWD/src/routecache.h \
+    $$PWD/src/routegeometry.h \
+    $$PWD/src/routeloader.h \
+    $$PWD/src/routesimplifier.h \
+    $$PWD/src/seqlock.h \
+    $$PWD/src/serialtxqueue.h \
+    $$PWD/src/simulationclock.h \
+    $$PWD/src/simulationengine.h \
+    $$PWD/src/spscqueue.h \
+    $$PWD/src/timingwheel.h \
+    $$PWD/src/vesselpool.h \
+    $$PWD/src/virtualn2kfleet.h
+
+# Include NMEA2000_SocketCAN and the pseudo-terminal NGT-1 only for Unix (Rpi, CI)
+unix {
+    SOURCES += $$PWD/../NMEA2000/src/NMEA2000_SocketCAN.cpp \
+        $$PWD/src/virtualngt1.cpp
+    HEADERS += $$PWD/../NMEA2000/src/NMEA2000_SocketCAN.h \
+        $$PWD/src/virtualngt1.h
+}
+
+# SocketCAN transport with recvmmsg/sendmmsg batching, Linux only
+linux {
+    SOURCES += $$PWD/src/socketcantransport.cpp
+    HEADERS += $$PWD/src/socketcantransport.h
+}
+
+# The geodesy kernels only if-convert and vectorize with these flags (omp simd only, no OpenMP
+# runtime). They relax errno and FP trap semantics, so they stay on this one file instead of the
+# whole build.
+gcc {
+    GEODESY_SOURCES = $$PWD/src/geodesy.cpp
+    geodesy_simd.input = GEODESY_SOURCES
+    geodesy_simd.output = ${QMAKE_VAR_OBJECTS_DIR}${QMAKE_FILE_IN_BASE}$$first(QMAKE_EXT_OBJ)
+    geodesy_simd.commands = $$QMAKE_CXX $(CXXFLAGS) -fopenmp-simd -fno-math-errno -fno-trapping-math $(INCPATH) -c ${QMAKE_FILE_IN} -o ${QMAKE_FILE_OUT}
+    geodesy_simd.dependency_type = TYPE_C
+    geodesy_simd.variable_out = OBJECTS
+    QMAKE_EXTRA_COMPILERS += geodesy_simd
+} else {
+    SOURCES += $$PWD/src/geodesy.cpp
+}
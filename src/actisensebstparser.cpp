@@ -0,0 +1,9 @@
+#include "actisensebstparser.h"
+
+void ActisenseBstParser::reset()
+{
+    state = WaitDle;
+    frameLen = 0;
+    checksum = 0;
+    stats = Statistics();
+}
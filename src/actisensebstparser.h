@@ -0,0 +1,171 @@
+#ifndef ACTISENSEBSTPARSER_H
+#define ACTISENSEBSTPARSER_H
+
+#include <cstdint>
+#include <cstring>
+#include "actisensecodec.h"
+
+// Streaming parser for Actisense BST frames (DLE STX <command> <len> <payload> <checksum> DLE ETX).
+// Bytes are fed in whatever chunks the serial port delivers them. Runs between DLE bytes are located
+// with ActisenseCodec::findEscape and copied into a fixed frame buffer in one go, escaped DLE bytes are
+// collapsed on the way and the checksum is accumulated on the fly, so a complete frame is handed to
+// the caller as a view without any per-frame allocation or buffer compaction.
+class ActisenseBstParser
+{
+public:
+    // Largest unescaped frame: command + length + 255 payload bytes + checksum
+    static constexpr int MaxFrameLen = 1 + 1 + 255 + 1;
+
+    // View on a validated frame, starting at the command byte and excluding the checksum.
+    // Only valid for the duration of the callback.
+    struct Frame {
+        const uint8_t *data;
+        int length;
+
+        uint8_t command() const { return data[0]; }
+        uint8_t payloadLength() const { return data[1]; }
+        const uint8_t *payload() const { return data + 2; }
+    };
+
+    struct Statistics {
+        uint64_t bytesProcessed = 0;
+        uint64_t framesParsed = 0;
+        uint64_t checksumErrors = 0;
+        uint64_t framingErrors = 0;
+        uint64_t overruns = 0;
+    };
+
+    ActisenseBstParser() = default;
+
+    // Feed raw bytes; onFrame(const Frame &) is called for every complete, checksum-valid frame.
+    template<typename FrameHandler>
+    void feed(const uint8_t *bytes, int count, FrameHandler &&onFrame);
+
+    void reset();
+    const Statistics &statistics() const { return stats; }
+
+private:
+    enum State { WaitDle, WaitStx, InFrame, InFrameDle };
+
+    static constexpr uint8_t Dle = ActisenseCodec::Dle;
+    static constexpr uint8_t Stx = ActisenseCodec::Stx;
+    static constexpr uint8_t Etx = ActisenseCodec::Etx;
+
+    State state = WaitDle;
+    uint8_t frame[MaxFrameLen];
+    int frameLen = 0;
+    uint8_t checksum = 0;
+    Statistics stats;
+
+    void beginFrame()
+    {
+        state = InFrame;
+        frameLen = 0;
+        checksum = 0;
+    }
+
+    bool appendByte(uint8_t byte)
+    {
+        if (frameLen >= MaxFrameLen) {
+            stats.overruns++;
+            state = WaitDle;
+            return false;
+        }
+        frame[frameLen++] = byte;
+        checksum += byte;
+        return true;
+    }
+
+    template<typename FrameHandler>
+    void endFrame(FrameHandler &onFrame);
+};
+
+template<typename FrameHandler>
+void ActisenseBstParser::feed(const uint8_t *bytes, int count, FrameHandler &&onFrame)
+{
+    stats.bytesProcessed += count;
+
+    int i = 0;
+    while (i < count) {
+        if (state == InFrame) {
+            // Bulk copy everything up to the next DLE
+            int run = ActisenseCodec::findEscape(bytes + i, count - i);
+            if (frameLen + run > MaxFrameLen) {
+                stats.overruns++;
+                state = WaitDle;
+                i += run;
+                continue;
+            }
+            memcpy(frame + frameLen, bytes + i, static_cast<size_t>(run));
+            checksum += ActisenseCodec::byteSum(bytes + i, run);
+            frameLen += run;
+            i += run;
+            if (i < count) {
+                state = InFrameDle;
+                i++;
+            }
+            continue;
+        }
+
+        const uint8_t byte = bytes[i++];
+
+        switch (state) {
+        case WaitDle:
+            if (byte == Dle) {
+                state = WaitStx;
+            }
+            break;
+
+        case WaitStx:
+            if (byte == Stx) {
+                beginFrame();
+            } else if (byte != Dle) {
+                state = WaitDle;
+            }
+            break;
+
+        case InFrameDle:
+            if (byte == Dle) {
+                // Escaped data byte
+                if (appendByte(byte)) {
+                    state = InFrame;
+                }
+            } else if (byte == Etx) {
+                endFrame(onFrame);
+                state = WaitDle;
+            } else if (byte == Stx) {
+                // Unterminated frame followed by a new start, resynchronize on it
+                stats.framingErrors++;
+                beginFrame();
+            } else {
+                stats.framingErrors++;
+                state = WaitDle;
+            }
+            break;
+
+        case InFrame:
+            break;
+        }
+    }
+}
+
+template<typename FrameHandler>
+void ActisenseBstParser::endFrame(FrameHandler &onFrame)
+{
+    // Command, length and checksum at minimum, and the length byte must agree with what we framed
+    if (frameLen < 3 || frame[1] != frameLen - 3) {
+        stats.framingErrors++;
+        return;
+    }
+
+    // The checksum byte makes the sum over the whole frame zero
+    if (checksum != 0) {
+        stats.checksumErrors++;
+        return;
+    }
+
+    stats.framesParsed++;
+    onFrame(Frame{frame, frameLen - 1});
+}
+
+#endif // ACTISENSEBSTPARSER_H
@@ -0,0 +1,128 @@
+#include "actisensecodec.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ACTISENSE_CODEC_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ACTISENSE_CODEC_NEON
+#endif
+
+#if defined(ACTISENSE_CODEC_SSE2) && defined(_MSC_VER)
+#include <intrin.h>
+static inline int firstSetBit(unsigned mask)
+{
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+}
+#elif defined(ACTISENSE_CODEC_SSE2)
+static inline int firstSetBit(unsigned mask)
+{
+    return __builtin_ctz(mask);
+}
+#endif
+
+int ActisenseCodec::findEscape(const uint8_t *data, int length)
+{
+    int i = 0;
+
+#if defined(ACTISENSE_CODEC_SSE2)
+    const __m128i dle = _mm_set1_epi8(static_cast<char>(Dle));
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, dle)));
+        if (mask != 0) {
+            return i + firstSetBit(mask);
+        }
+    }
+#elif defined(ACTISENSE_CODEC_NEON)
+    const uint8x16_t dle = vdupq_n_u8(Dle);
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t match = vceqq_u8(vld1q_u8(data + i), dle);
+        // Narrow each byte lane to 4 bits so the match mask fits in a 64 bit scalar
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+        if (mask != 0) {
+            return i + (__builtin_ctzll(mask) >> 2);
+        }
+    }
+#endif
+
+    // Scalar fallback and tail
+    const void *found = memchr(data + i, Dle, static_cast<size_t>(length - i));
+    return found ? static_cast<int>(static_cast<const uint8_t *>(found) - data) : length;
+}
+
+int ActisenseCodec::escape(const uint8_t *data, int length, uint8_t *out)
+{
+    int written = 0;
+    int i = 0;
+
+    while (i < length) {
+        int run = findEscape(data + i, length - i);
+        memcpy(out + written, data + i, static_cast<size_t>(run));
+        written += run;
+        i += run;
+
+        if (i < length) {
+            out[written++] = Dle;
+            out[written++] = Dle;
+            i++;
+        }
+    }
+
+    return written;
+}
+
+int ActisenseCodec::unescape(const uint8_t *data, int length, uint8_t *out)
+{
+    int written = 0;
+    int i = 0;
+
+    while (i < length) {
+        int run = findEscape(data + i, length - i);
+        memmove(out + written, data + i, static_cast<size_t>(run));
+        written += run;
+        i += run;
+
+        if (i < length) {
+            if (i + 1 >= length || data[i + 1] != Dle) {
+                return -1;
+            }
+            out[written++] = Dle;
+            i += 2;
+        }
+    }
+
+    return written;
+}
+
+uint8_t ActisenseCodec::byteSum(const uint8_t *data, int length)
+{
+    // Wide accumulator keeps the loop free of carries so the compiler can vectorize it
+    unsigned sum = 0;
+    for (int i = 0; i < length; i++) {
+        sum += data[i];
+    }
+    return static_cast<uint8_t>(sum);
+}
+
+int ActisenseCodec::encodeFrame(const uint8_t *message, int length, uint8_t *out)
+{
+    int written = 0;
+    out[written++] = Dle;
+    out[written++] = Stx;
+
+    written += escape(message, length, out + written);
+
+    uint8_t check = checksum(message, length);
+    out[written++] = check;
+    if (check == Dle) {
+        out[written++] = Dle;
+    }
+
+    out[written++] = Dle;
+    out[written++] = Etx;
+    return written;
+}
@@ -0,0 +1,41 @@
+#ifndef ACTISENSECODEC_H
+#define ACTISENSECODEC_H
+
+#include <cstdint>
+
+// Byte stuffing used by the Actisense BST protocol: inside a frame every DLE (0x10) data byte is
+// sent twice. Escape scanning runs over whole chunks with SSE2 or NEON where available so the
+// common case (no DLE in a long run) costs a few vector compares instead of a branch per byte.
+class ActisenseCodec
+{
+public:
+    static constexpr uint8_t Dle = 0x10;
+    static constexpr uint8_t Stx = 0x02;
+    static constexpr uint8_t Etx = 0x03;
+
+    // Index of the first DLE in data, or length if there is none
+    static int findEscape(const uint8_t *data, int length);
+
+    // Writes data to out with every DLE doubled. out must hold 2 * length bytes.
+    // Returns the number of bytes written.
+    static int escape(const uint8_t *data, int length, uint8_t *out);
+
+    // Collapses doubled DLE bytes. out may alias data. Returns the number of bytes written,
+    // or -1 if data contains a DLE that is not part of a DLE DLE pair.
+    static int unescape(const uint8_t *data, int length, uint8_t *out);
+
+    // Sum of the bytes modulo 256, the basis of the BST checksum
+    static uint8_t byteSum(const uint8_t *data, int length);
+
+    // Checksum byte that makes the sum over data plus checksum zero
+    static uint8_t checksum(const uint8_t *data, int length) { return static_cast<uint8_t>(-byteSum(data, length)); }
+
+    // Frames a raw BST message (command, length, payload): adds the checksum, escapes and wraps
+    // it in DLE STX ... DLE ETX. out must hold 2 * (length + 1) + 4 bytes. Returns bytes written.
+    static int encodeFrame(const uint8_t *message, int length, uint8_t *out);
+
+    // Upper bound of encodeFrame output for a raw message of the given length
+    static constexpr int maxEncodedLength(int length) { return 2 * (length + 1) + 4; }
+};
+
+#endif // ACTISENSECODEC_H
@@ -0,0 +1,220 @@
+#include "actisenselink.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QMetaObject>
+#include <QThread>
+#include <chrono>
+#include "nmea2000_actisense.h"
+
+ActisenseLink::ActisenseLink(size_t rxCapacity, size_t txCapacity, QObject *parent)
+    : QObject(parent)
+    , rxQueue(rxCapacity)
+    , txQueue(txCapacity)
+{}
+
+ActisenseLink::~ActisenseLink()
+{
+    stopCapture();
+}
+
+qint64 ActisenseLink::monotonicUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void ActisenseLink::open(const QString &portName, int baudRate)
+{
+    close();
+
+    // Created here so the port and codec belong to the I/O thread
+    serialPort = new QSerialPort(this);
+    serialPort->setPortName(portName);
+    serialPort->setBaudRate(baudRate);
+    serialPort->setDataBits(QSerialPort::Data8);
+    serialPort->setParity(QSerialPort::NoParity);
+    serialPort->setStopBits(QSerialPort::OneStop);
+    serialPort->setFlowControl(QSerialPort::NoFlowControl);
+
+    QThread::msleep(10);
+    NMEA2000_Actisense *actisense = new NMEA2000_Actisense(*serialPort, this);
+    transport = actisense;
+    connect(transport, &N2kTransport::nmea2000MessagesReceived, this, &ActisenseLink::onMessagesReceived);
+    QThread::msleep(10);
+    actisense->SetMode(tNMEA2000::N2km_ListenAndNode, 44);
+    QThread::msleep(10);
+
+    // Open the NMEA2000 connection
+    bool success = actisense->Open();
+    if (success) {
+        qInfo() << "NGT-1 connected on" << portName;
+    } else {
+        qWarning() << "Failed to connect to NGT-1 on" << portName;
+    }
+    emit opened(success);
+}
+
+void ActisenseLink::openSocketCan(const QString &interfaceName, const std::vector<unsigned long> &pgns)
+{
+    close();
+
+#ifdef Q_OS_LINUX
+    canCounters.reset();
+    SocketCanTransport *socketCan = new SocketCanTransport(canCounters, this);
+    QString error;
+    if (!socketCan->open(interfaceName, pgns, &error)) {
+        qWarning().noquote() << error;
+        delete socketCan;
+        emit opened(false);
+        return;
+    }
+    transport = socketCan;
+    connect(transport, &N2kTransport::nmea2000MessagesReceived, this, &ActisenseLink::onMessagesReceived);
+    qInfo() << "SocketCAN connected on" << interfaceName;
+    emit opened(true);
+#else
+    Q_UNUSED(pgns);
+    qWarning() << "SocketCAN is only available on Linux, not opening" << interfaceName;
+    emit opened(false);
+#endif
+}
+
+void ActisenseLink::close()
+{
+    if (transport) {
+        transport->Flush();
+        delete transport;
+        transport = nullptr;
+    }
+    if (serialPort) {
+        serialPort->close();
+        delete serialPort;
+        serialPort = nullptr;
+    }
+}
+
+void ActisenseLink::onMessagesReceived(const tN2kMsg *N2kMsgs, int count)
+{
+    QueuedN2kMsg entry;
+    entry.timestampUs = monotonicUs();
+
+    if (capture) {
+        for (int i = 0; i < count; i++) {
+            capture->write(N2kMsgs[i], captureEpochUs + entry.timestampUs);
+        }
+        captured.fetch_add(static_cast<quint64>(count), std::memory_order_relaxed);
+    }
+
+    int pushed = 0;
+    for (int i = 0; i < count; i++) {
+        entry.N2kMsg = N2kMsgs[i];
+        if (rxQueue.tryPush(entry)) {
+            pushed++;
+        } else {
+            rxDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // One wakeup per batch, the consumer clears the flag before it drains
+    if (pushed > 0 && !rxNotifyPending.exchange(true, std::memory_order_acq_rel)) {
+        emit rxAvailable();
+    }
+}
+
+size_t ActisenseLink::takeReceived(tN2kMsg *out, size_t maxCount)
+{
+    rxNotifyPending.store(false, std::memory_order_release);
+
+    qint64 now = monotonicUs();
+    QueuedN2kMsg entry;
+    size_t count = 0;
+    while (count < maxCount && rxQueue.tryPop(entry)) {
+        out[count++] = entry.N2kMsg;
+        rxLatency.record(static_cast<uint64_t>(now - entry.timestampUs));
+    }
+    return count;
+}
+
+bool ActisenseLink::post(const tN2kMsg &N2kMsg)
+{
+    return postBatch(&N2kMsg, 1) == 1;
+}
+
+int ActisenseLink::postBatch(const tN2kMsg *N2kMsgs, int count)
+{
+    QueuedN2kMsg entry;
+    entry.timestampUs = monotonicUs();
+
+    int posted = 0;
+    {
+        std::lock_guard<std::mutex> lock(txProducerLock);
+        for (; posted < count; posted++) {
+            entry.N2kMsg = N2kMsgs[posted];
+            if (!txQueue.tryPush(entry)) {
+                txDropped.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+    }
+
+    if (posted > 0 && !txNotifyPending.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, "drainTx", Qt::QueuedConnection);
+    }
+    return posted;
+}
+
+void ActisenseLink::drainTx()
+{
+    txNotifyPending.store(false, std::memory_order_release);
+
+    QueuedN2kMsg entry;
+    while (txQueue.tryPop(entry)) {
+        txLatency.record(static_cast<uint64_t>(monotonicUs() - entry.timestampUs));
+        if (!transport || !transport->SendMessage(entry.N2kMsg)) {
+            txDropped.fetch_add(1, std::memory_order_relaxed);
+        } else if (capture) {
+            capture->write(entry.N2kMsg, captureEpochUs + monotonicUs(), true);
+            captured.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void ActisenseLink::startCapture(const QString &path)
+{
+    stopCapture();
+
+    auto writer = std::make_unique<CaptureWriter>();
+    QString error;
+    if (!writer->open(path, &error)) {
+        qWarning() << error;
+        return;
+    }
+    captureEpochUs = QDateTime::currentMSecsSinceEpoch() * 1000 - monotonicUs();
+    capture = std::move(writer);
+    qInfo() << "Capturing to" << path;
+}
+
+void ActisenseLink::stopCapture()
+{
+    if (capture) {
+        capture->close();
+        capture.reset();
+    }
+}
+
+ActisenseLink::Statistics ActisenseLink::statistics() const
+{
+    Statistics stats;
+    stats.rxDepth = rxQueue.size();
+    stats.rxHighWater = rxQueue.highWaterMark();
+    stats.rxCapacity = rxQueue.getCapacity();
+    stats.rxDropped = rxDropped.load(std::memory_order_relaxed);
+    stats.txDepth = txQueue.size();
+    stats.txHighWater = txQueue.highWaterMark();
+    stats.txCapacity = txQueue.getCapacity();
+    stats.txDropped = txDropped.load(std::memory_order_relaxed);
+    stats.captured = captured.load(std::memory_order_relaxed);
+    stats.rxLatency = rxLatency.snapshot();
+    stats.txLatency = txLatency.snapshot();
+    return stats;
+}
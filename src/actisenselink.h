@@ -0,0 +1,111 @@
+#ifndef ACTISENSELINK_H
+#define ACTISENSELINK_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "N2kMsg.h"
+#include "capturewriter.h"
+#include "latencyhistogram.h"
+#include "spscqueue.h"
+#ifdef Q_OS_LINUX
+#include "socketcantransport.h"
+#endif
+
+class N2kTransport;
+
+// Message plus the monotonic time it entered a queue, for latency accounting
+struct QueuedN2kMsg {
+    tN2kMsg N2kMsg;
+    qint64 timestampUs = 0;
+};
+
+// Owns the N2K transport on a dedicated I/O thread: the NGT-1 serial port with the Actisense codec, or
+// on Linux a CAN interface through SocketCanTransport. Decoded messages are handed to the consumer
+// thread through a bounded SPSC ring, outbound messages come back through a second one. That one can
+// have more than one producer (the owning thread, the capture replayer's thread), so producers take
+// a lock among themselves while the I/O thread pops without one. The consumer
+// is woken with at most one queued signal per burst, so a stalled GUI only fills (and eventually
+// overflows) the ring while the transport keeps being drained.
+class ActisenseLink : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Statistics {
+        size_t rxDepth = 0;
+        size_t rxHighWater = 0;
+        size_t rxCapacity = 0;
+        quint64 rxDropped = 0;
+        size_t txDepth = 0;
+        size_t txHighWater = 0;
+        size_t txCapacity = 0;
+        quint64 txDropped = 0;
+        quint64 captured = 0;
+        LatencyHistogram::Snapshot rxLatency;
+        LatencyHistogram::Snapshot txLatency;
+    };
+
+    explicit ActisenseLink(size_t rxCapacity = 4096, size_t txCapacity = 1024, QObject *parent = nullptr);
+    ~ActisenseLink();
+
+    // Consumer thread API; post and postBatch may be called from any thread
+    bool post(const tN2kMsg &N2kMsg);
+    // Queues messages in order until the ring is full, returns how many were queued
+    int postBatch(const tN2kMsg *N2kMsgs, int count);
+    size_t takeReceived(tN2kMsg *out, size_t maxCount);
+    Statistics statistics() const;
+#ifdef Q_OS_LINUX
+    SocketCanTransport::Statistics canStatistics() const { return canCounters.snapshot(); }
+#endif
+
+    static qint64 monotonicUs();
+
+    // I/O thread, like open(). Only the PGNs in pgns are received, empty receives everything.
+    // Emits opened(false) off Linux.
+    void openSocketCan(const QString &interfaceName, const std::vector<unsigned long> &pgns);
+
+public slots:
+    // I/O thread
+    void open(const QString &portName, int baudRate);
+    void close();
+    void drainTx();
+    // Records every message received and sent from now on, see CaptureWriter
+    void startCapture(const QString &path);
+    void stopCapture();
+
+signals:
+    void opened(bool success);
+    void rxAvailable();
+
+private slots:
+    void onMessagesReceived(const tN2kMsg *N2kMsgs, int count);
+
+private:
+    QSerialPort *serialPort = nullptr;
+    N2kTransport *transport = nullptr;
+
+    SpscQueue<QueuedN2kMsg> rxQueue;
+    SpscQueue<QueuedN2kMsg> txQueue;
+    std::mutex txProducerLock;     // Makes the producers of txQueue take turns
+    std::atomic<bool> rxNotifyPending{false};
+    std::atomic<bool> txNotifyPending{false};
+    std::atomic<quint64> rxDropped{0};
+    std::atomic<quint64> txDropped{0};
+    LatencyHistogram rxLatency;
+    LatencyHistogram txLatency;
+
+    // I/O thread only; timestamps are monotonic time moved to UTC once when the capture starts
+    std::unique_ptr<CaptureWriter> capture;
+    qint64 captureEpochUs = 0;
+    std::atomic<quint64> captured{0};
+#ifdef Q_OS_LINUX
+    SocketCanTransport::Counters canCounters;
+#endif
+};
+
+#endif // ACTISENSELINK_H
@@ -17,34 +17,96 @@
 */
 
 #include "autopilotsimulator.h"
-#include <QFile>
-#include <QXmlStreamReader>
+#include "routecache.h"
+#include "routeloader.h"
+#include "routesimplifier.h"
 #include <QDebug>
+#include <QtMath>
+#include <limits>
 
 AutoPilotSimulator::AutoPilotSimulator(QObject *parent)
     : QObject(parent), currentIndex(0), speed(5), reverseRoute(false), forwardDirection(true)
 {
+    qRegisterMetaType<NavigationState>();
+    setClock(new SimulationClock(this));
 }
 
 AutoPilotSimulator::~AutoPilotSimulator()
 {
-    if (updateTimer.isActive()) {
-        updateTimer.stop();
-    }
     stop();
     disconnect();
 }
 
+void AutoPilotSimulator::setClock(SimulationClock *simulationClock)
+{
+    if (!simulationClock || simulationClock == clock) {
+        return;
+    }
+    if (clock) {
+        disconnect(clock, &SimulationClock::tick, this, &AutoPilotSimulator::onClockTick);
+        if (clock->parent() == this) {
+            clock->deleteLater();
+        }
+    }
+    clock = simulationClock;
+    connect(clock, &SimulationClock::tick, this, &AutoPilotSimulator::onClockTick);
+}
+
+void AutoPilotSimulator::onClockTick(qint64 nowMs, qint64 deltaMs)
+{
+    if (!running) {
+        return;
+    }
+
+    // A large step (accelerated or stepped clock) runs several updates back to back and publishes
+    // only the last of them
+    pendingMs += deltaMs;
+    if (pendingMs < updateIntervalMs) {
+        return;
+    }
+    while (running && pendingMs >= updateIntervalMs) {
+        pendingMs -= updateIntervalMs;
+        travelTimeMs += updateIntervalMs;
+        calculateNextCoordinate();
+    }
+    state.timeMs = nowMs - pendingMs;
+    publishState();
+}
+
 bool AutoPilotSimulator::loadRoute(const QString &filePath)
 {
-    if (filePath.endsWith(".kml", Qt::CaseInsensitive)) {
-        return parseKMLFile(filePath);
-    } else if (filePath.endsWith(".gpx", Qt::CaseInsensitive)) {
-        return parseGPXFile(filePath);
-    } else {
-        qWarning() << "Unsupported file format:" << filePath;
-        return false;
+    RouteData data;
+    bool cached = routeCacheEnabled && RouteCache::load(filePath, simplifyToleranceM, data, geometry);
+
+    if (!cached) {
+        QString errorMessage;
+        if (!RouteLoader::load(filePath, data, &errorMessage)) {
+            qWarning() << errorMessage;
+            route.clear();
+            geometry.clear();
+            emit routeLoaded(false);
+            return false;
+        }
+
+        if (simplifyToleranceM > 0.0) {
+            RouteSimplifier::Result simplified = RouteSimplifier::simplify(data, simplifyToleranceM);
+            emit statusMessage(QString("Route simplified from %1 to %2 points (%3 m tolerance)")
+                                   .arg(simplified.pointsBefore)
+                                   .arg(simplified.pointsAfter)
+                                   .arg(simplifyToleranceM));
+        }
+
+        // Leg lengths, bearings and planes are computed once here instead of every tick
+        geometry.compile(data.latitudes.data(), data.longitudes.data(), data.size());
+        if (routeCacheEnabled && !RouteCache::store(filePath, simplifyToleranceM, data, geometry)) {
+            qWarning() << "Unable to write route cache in" << RouteCache::directory();
+        }
     }
+
+    // The columns are kept as they are, no per point object is built
+    route = std::move(data);
+    emit routeLoaded(true);
+    return true;
 }
 
 void AutoPilotSimulator::start()
@@ -54,23 +116,41 @@ void AutoPilotSimulator::start()
         return;
     }
 
-    if (!updateTimer.isActive()) {
-        connect(&updateTimer, &QTimer::timeout, this, &AutoPilotSimulator::calculateNextCoordinate);
-    }
-
-    travelTimer.start();
+    pendingMs = 0;
+    travelTimeMs = 0;
+    legDistance = 0.0;
     totalDistanceTraveled = 0.0;
     currentIndex = 0;
     lastIndex = -1;
     forwardDirection = true;
-    emitNextWaypoint();
-    updateTimer.start(1000); // Update every second
+
+    state = NavigationState();
+    state.latitude = route.latitudes[0];
+    state.longitude = route.longitudes[0];
+    if (geometry.legCount() > 0) {
+        state.courseRadians = geometry.initialBearing(0);
+        state.bearingToDestinationRadians = state.courseRadians;
+    }
+    state.speed = speed;
+    state.closingVelocity = speed;
+    updateDestination();
+    updateDistanceAndTime(geometry.legCount() > 0 ? geometry.length(0) : 0.0);
+    running = true;
+    state.running = true;
+    state.timeMs = clock->nowMs();
+    publishState();
+    clock->start();
     emit RunningStateChanged(true);
 }
 
 void AutoPilotSimulator::stop()
 {
-    updateTimer.stop();
+    running = false;
+    if (state.running) {
+        state.running = false;
+        state.timeMs = clock->nowMs();
+        publishState();
+    }
     emit RunningStateChanged(false);
 }
 
@@ -84,313 +164,144 @@ void AutoPilotSimulator::setSpeed(double newSpeed)
     speed = newSpeed;
 }
 
-bool AutoPilotSimulator::parseKMLFile(const QString &filePath)
-{
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning() << "Unable to open file:" << filePath;
-        emit routeLoaded(false);
-        return false;
-    }
-
-    QXmlStreamReader xml(&file);
-    route.clear(); // Clear any existing route data
-
-    while (!xml.atEnd() && !xml.hasError()) {
-        xml.readNext();
-
-        // Parse only if we are at a start element
-        if (xml.isStartElement()) {
-            if (xml.name() == QStringLiteral("Placemark")) {
-                QString waypointName;
-                QGeoCoordinate coordinate;
-
-                while (!(xml.isEndElement() && xml.name() == QStringLiteral("Placemark"))) {
-                    xml.readNext();
-
-                    if (xml.isStartElement()) {
-                        if (xml.name() == QStringLiteral("name")) {
-                            waypointName = xml.readElementText();
-                        } else if (xml.name() == QStringLiteral("coordinates")) {
-                            QStringList coordList = xml.readElementText().trimmed().split(',');
-
-                            if (coordList.size() >= 2) {
-                                double longitude = coordList[0].toDouble();
-                                double latitude = coordList[1].toDouble();
-                                coordinate = QGeoCoordinate(latitude, longitude);
-                            }
-                        }
-                    }
-                }
-
-                if (coordinate.isValid()) {
-                    Waypoint waypoint;
-                    waypoint.coordinate = coordinate;
-                    waypoint.name = waypointName;
-                    route.append(waypoint);
-                    //qDebug() << "Loaded waypoint:" << waypoint.name
-                    //         << coordinate.latitude() << coordinate.longitude();
-                }
-            }
-        }
-    }
-
-    if (xml.hasError()) {
-        qWarning() << "Error parsing KML file:" << xml.errorString();
-        emit routeLoaded(false);
-        return false;
-    }
-
-    //qDebug() << "Total waypoints loaded:" << route.size();
-    emit routeLoaded(true);
-    return true;
-}
-
-bool AutoPilotSimulator::parseGPXFile(const QString &filePath)
+void AutoPilotSimulator::setReverseRoute(bool reverse)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning() << "Failed to open file:" << filePath;
-        return false;
-    }
-
-    QXmlStreamReader xml(&file);
-
-    route.clear();
-
-    while (!xml.atEnd() && !xml.hasError()) {
-        xml.readNext();
-
-        if (xml.isStartElement()) {
-            QString elementName = xml.name().toString();
-
-            if (elementName == QStringLiteral("trkpt")) {
-                // Extract the latitude and longitude from the trkpt attributes
-                double lat = xml.attributes().value("lat").toDouble();
-                double lon = xml.attributes().value("lon").toDouble();
-                Waypoint waypoint;
-                waypoint.coordinate = QGeoCoordinate(lat, lon);
-
-                // Look for any sub-elements like <name>
-                while (!(xml.isEndElement() && xml.name() == QStringLiteral("trkpt"))) {
-                    xml.readNext();
-
-                    if (xml.isStartElement()) {
-                        if (xml.name() == QStringLiteral("name")) {
-                            waypoint.name = xml.readElementText();
-                        }
-                    }
-                }
-
-                route.append(waypoint);
-                //qDebug() << "Loaded waypoint:" << waypoint.coordinate.latitude() << waypoint.coordinate.longitude();
-            }
-        }
-    }
-
-    if (xml.hasError()) {
-        qWarning() << "XML Error:" << xml.errorString();
-        return false;
-    }
-
-    file.close();
-
-    //qDebug() << "Total waypoints loaded:" << route.size();
-    return !route.isEmpty();
+    reverseRoute = reverse;
 }
 
-void AutoPilotSimulator::setReverseRoute(bool reverse)
+QString AutoPilotSimulator::waypointName(int index) const
 {
-    reverseRoute = reverse;
+    return index >= 0 && index < routeSize() ? route.nameAt(static_cast<size_t>(index)) : QString();
 }
 
 void AutoPilotSimulator::calculateNextCoordinate()
 {
-    static double accumulatedDistance = 0;  // Track distance covered towards the next waypoint
-
-    if (currentIndex < 0 || currentIndex >= route.size()) {
+    if (currentIndex < 0 || currentIndex >= routeSize() || routeSize() < 2) {
         stop();
         emit routeCompleted();
-        emit RunningStateChanged(false);
         //qDebug() << "Route completed or index out of bounds.";
         return;
     }
 
-    const QGeoCoordinate &current = route[currentIndex].coordinate;
-    QGeoCoordinate next;
-
-    //qDebug() << "Current Index:" << currentIndex
-    //         << "Current Coordinate:" << current.latitude() << current.longitude();
-
     // Determine the next waypoint based on direction
+    int nextIndex;
     if (forwardDirection) {
-        if (currentIndex < route.size() - 1) {
-            next = route[currentIndex + 1].coordinate;
+        if (currentIndex < routeSize() - 1) {
+            nextIndex = currentIndex + 1;
             if (currentIndex != lastIndex) {
-                QString msg = "Traveling forward to Wp " + QString::number(currentIndex + 1) + " of " + QString::number(route.size());
+                QString msg = "Traveling forward to Wp " + QString::number(currentIndex + 1) + " of " + QString::number(routeSize());
                 emit statusMessage(msg);
                 lastIndex = currentIndex;
             }
         } else if (reverseRoute) {
             forwardDirection = false;
-            currentIndex--;  // Reverse direction
-            next = route[currentIndex].coordinate;
-            if (currentIndex != lastIndex) {
-                QString msg = "Traveling back to Wp " + QString::number(currentIndex) + " of " + QString::number(route.size());
-                emit statusMessage(msg);
-                lastIndex = currentIndex;
-            }
-            emitNextWaypoint();
+            nextIndex = currentIndex - 1;
+            QString msg = "Traveling back to Wp " + QString::number(nextIndex) + " of " + QString::number(routeSize());
+            emit statusMessage(msg);
+            lastIndex = currentIndex;
+            updateDestination();
         } else {
             stop();
             emit routeCompleted();
-            emit RunningStateChanged(false);
             return;
         }
     } else {
         if (currentIndex > 0) {
-            next = route[currentIndex - 1].coordinate;
+            nextIndex = currentIndex - 1;
         } else {
             forwardDirection = true;
-            currentIndex++;
-            next = route[currentIndex].coordinate;
-            emitNextWaypoint();
+            nextIndex = currentIndex + 1;
+            updateDestination();
         }
     }
 
-    // Calculate the cross-track error (XTE)
-    double xteMeters = calculateXTE(current, waypointPosition);
-    emit XTEChanged(xteMeters);
-
-    double distanceToNext = current.distanceTo(next);
-    //qDebug() << "Speed:" << speed
-    //         << "Next Coordinate:" << next.latitude() << next.longitude()
-    //         << "Distance to Next:" << distanceToNext;
+    // Travelling backwards runs the same leg from its end
+    const int leg = qMin(currentIndex, nextIndex);
+    const double legLength = geometry.length(leg);
 
-    vesselWpBearing.WaypointClosingVelocity = speed;
+    state.speed = speed;
+    state.closingVelocity = speed;
     if (speed > 0) {
-        double distancePerInterval = speed * updateTimer.interval() / 1000.0;
-        accumulatedDistance += distancePerInterval;
-        //qDebug() << "Accumulated Distance:" << accumulatedDistance;
+        double distancePerInterval = speed * updateIntervalMs / 1000.0;
+        legDistance += distancePerInterval;
+        //qDebug() << "Leg Distance:" << legDistance;
 
-        QGeoCoordinate interpolated = current.atDistanceAndAzimuth(accumulatedDistance, current.azimuthTo(next));
-        double currentDistanceToNext = interpolated.distanceTo(next);
-        Q_UNUSED(currentDistanceToNext);
         // Update total distance traveled
         totalDistanceTraveled += distancePerInterval;
+        state.distanceTraveledM = totalDistanceTraveled;
+        state.timeTraveledS = travelTimeMs / 1000.0;
 
-        // Convert total distance to nautical miles and emit
-        double distanceInNauticalMiles = totalDistanceTraveled / 1852.0; // 1 nautical mile = 1852 meters
-        emit distanceTraveledNM(distanceInNauticalMiles);
-        //qDebug() << "Total Distance Traveled:" << totalDistanceTraveled << "meters"
-        //         << distanceInNauticalMiles << "nautical miles";
+        double along = qMin(legDistance, legLength);
+        RouteGeometry::Point point = geometry.pointAt(leg, forwardDirection ? along : legLength - along);
+        double heading = forwardDirection ? point.bearing : std::fmod(point.bearing + M_PI, 2.0 * M_PI);
+        state.courseRadians = heading;
+        state.bearingToDestinationRadians = heading;
 
-        emitDistanceAndTime(interpolated, next); // Pass interpolated position for accurate calculations
-        emit timeTraveledSeconds(travelTimer.elapsed() / 1000.0);
+        // Calculate the cross-track error (XTE)
+        state.xteM = calculateXTE(leg, point);
+        updateDistanceAndTime(legLength - along);
 
-        if (accumulatedDistance >= distanceToNext) {
+        if (legDistance >= legLength) {
             // Move to the next waypoint
-            if (forwardDirection) {
-                currentIndex++;
-            //    qDebug() << "Incremented currentIndex to:" << currentIndex;
-            } else {
-                currentIndex--;
-            //    qDebug() << "Decremented currentIndex to:" << currentIndex;
-            }
-            accumulatedDistance = 0;  // Reset accumulated distance
-            if (next.isValid()) {
-                emit coordinateUpdated(next);
-                emit headingUpdated(calculateHeading(current, next));
-                emitNextWaypoint();
-            }
+            currentIndex = nextIndex;
+            legDistance = 0;
+            state.latitude = route.latitudes[nextIndex];
+            state.longitude = route.longitudes[nextIndex];
+            updateDestination();
         } else {
-            if (interpolated.isValid()) {
-                // Update interpolated position
-                emit coordinateUpdated(interpolated);
-                emit headingUpdated(calculateHeading(current, interpolated));
-                //qDebug() << "Interpolated Coordinate:" << interpolated.latitude() << interpolated.longitude();
-            }
+            // Update interpolated position
+            state.latitude = point.latitude;
+            state.longitude = point.longitude;
         }
     } else {
         //qWarning() << "Speed is zero; simulator is not moving."; // Okay for speed to be 0 for pumping out
+        updateDistanceAndTime(state.distanceToDestinationM);
     }
-
-    emit VesselWpBearingChanged(vesselWpBearing);
 }
 
-void AutoPilotSimulator::emitNextWaypoint()
+void AutoPilotSimulator::updateDestination()
 {
-    if (forwardDirection && currentIndex < route.size() - 1) {
-        vesselWpBearing.WaypointName = route[currentIndex + 1].name;
-        vesselWpBearing.DestinationLatitude = route[currentIndex + 1].coordinate.latitude();
-        vesselWpBearing.DestinationLongitude = route[currentIndex + 1].coordinate.longitude();
-        emit nextWaypoint(route[currentIndex + 1].name);
-        waypointPosition = route[currentIndex + 1].coordinate;
-        //qDebug() << "Next Waypoint:" << route[currentIndex + 1].name;
+    int destination = -1;
+    if (forwardDirection && currentIndex < routeSize() - 1) {
+        destination = currentIndex + 1;
     } else if (!forwardDirection && currentIndex > 0) {
-        vesselWpBearing.WaypointName = route[currentIndex - 1].name;
-        vesselWpBearing.DestinationLatitude = route[currentIndex - 1].coordinate.latitude();
-        vesselWpBearing.DestinationLongitude = route[currentIndex - 1].coordinate.longitude();
-        emit nextWaypoint(route[currentIndex - 1].name);
-        waypointPosition = route[currentIndex - 1].coordinate;
-        //qDebug() << "Next Waypoint:" << route[currentIndex - 1].name;
+        destination = currentIndex - 1;
     } else {
         //qDebug() << "No next waypoint available.";
+        return;
     }
-}
 
-double AutoPilotSimulator::calculateHeading(const QGeoCoordinate &from, const QGeoCoordinate &to)
-{
-    double azimuthDegrees = from.azimuthTo(to); // Calculate azimuth in degrees
-    double azimuthRadians = qDegreesToRadians(azimuthDegrees); // Convert to radians
-    vesselWpBearing.BearingPositionToDestinationWaypoint = azimuthRadians;
-    return azimuthRadians;
+    state.originIndex = currentIndex;
+    state.destinationIndex = destination;
+    state.destinationLatitude = route.latitudes[destination];
+    state.destinationLongitude = route.longitudes[destination];
 }
 
-void AutoPilotSimulator::emitDistanceAndTime(const QGeoCoordinate &current, const QGeoCoordinate &next)
+void AutoPilotSimulator::updateDistanceAndTime(double distanceMeters)
 {
-    double distanceMeters = current.distanceTo(next);
-    double timeSeconds = (speed > 0) ? (distanceMeters / speed) : std::numeric_limits<double>::infinity();
-
-    //qDebug() << "Emitting Distance to Next Waypoint:" << distanceMeters << "meters";
-    //qDebug() << "Emitting Time to Next Waypoint:" << timeSeconds << "seconds";
-
-    vesselWpBearing.DistanceToWaypointM = distanceMeters;
-    vesselWpBearing.EtaTimeS = timeSeconds;
-    emit distanceToNextWaypoint(distanceMeters);
-    emit timeToNextWaypoint(timeSeconds);
+    state.distanceToDestinationM = distanceMeters;
+    state.timeToDestinationS = (speed > 0) ? (distanceMeters / speed) : std::numeric_limits<double>::infinity();
 }
 
-void AutoPilotSimulator::updateLatLong(double latitude, double longitude)
+double AutoPilotSimulator::calculateXTE(int leg, const RouteGeometry::Point &position)
 {
-    latitude = Convert::DegreesToRadians(latitude);
-    longitude = Convert::DegreesToRadians(longitude);
-    emit LatLongChanged(latitude, longitude);
+    // Perpendicular distance to the leg's great circle, positive right of the direction of travel
+    double xteMeters = geometry.crossTrackM(leg, position.latitude, position.longitude);
+    if (!forwardDirection) {
+        xteMeters = -xteMeters;
+    }
+    return xteMeters;
 }
 
-double AutoPilotSimulator::calculateXTE(const QGeoCoordinate &currentPosition,
-                                        const QGeoCoordinate &waypointPosition)
+void AutoPilotSimulator::publishState()
 {
-    // Calculate the azimuths (bearing angles) from the previous waypoint to the current position and to the next waypoint
-    if (currentIndex == 0 || currentIndex >= route.size() - 1) {
-        return 0.0; // No previous waypoint to calculate XTE against
+    state.stamp(lastPublished);
+    if (state.changed == 0 && lastPublished.sequence != 0) {
+        // Nothing moved (speed 0), keep the previous snapshot and its sequence
+        state.sequence = lastPublished.sequence;
+        return;
     }
-
-    const QGeoCoordinate &previousWaypoint = route[currentIndex - 1].coordinate;
-
-    // Calculate the bearing from the previous waypoint to the next waypoint (track bearing)
-    double trackBearing = previousWaypoint.azimuthTo(waypointPosition);
-
-    // Calculate the bearing from the previous waypoint to the current position
-    double bearingToCurrent = previousWaypoint.azimuthTo(currentPosition);
-
-    // Calculate the distance from the previous waypoint to the current position
-    double distanceToCurrent = previousWaypoint.distanceTo(currentPosition);
-
-    // The cross-track error (XTE) is the perpendicular distance from the current position to the intended track
-    double angleDifference = bearingToCurrent - trackBearing;
-    double xteMeters = distanceToCurrent * sin(qDegreesToRadians(angleDifference));
-
-    vesselWpBearing.Xte = xteMeters;
-    return xteMeters;
+    lastPublished = state;
+    publishedState.store(state);
+    emit navigationStateChanged(state);
 }
@@ -19,20 +19,14 @@
 #ifndef AUTOPILOTSIMULATOR_H
 #define AUTOPILOTSIMULATOR_H
 
-#include <QElapsedTimer>
-#include <QGeoCoordinate>
 #include <QObject>
-#include <QShowEvent>
 #include <QString>
-#include <QTimer>
-#include <QVector>
 #include "convert.h"
-//#include "nmea0183handler.h" // Access to VesselWpBearing struct
-
-struct Waypoint {
-    QGeoCoordinate coordinate;
-    QString name;
-};
+#include "navigationstate.h"
+#include "routegeometry.h"
+#include "routeloader.h"
+#include "seqlock.h"
+#include "simulationclock.h"
 
 class AutoPilotSimulator : public QObject
 {
@@ -48,51 +42,67 @@ public:
     double getSpeed() const;
 
     void setReverseRoute(bool reverse);
+    bool isRunning() const { return running; }
+    const RouteGeometry &routeGeometry() const { return geometry; }
+    // Loaded points as RouteData columns, names interned
+    const RouteData &routeData() const { return route; }
+    QString waypointName(int index) const;
+
+    // Latest published snapshot, lock-free and safe to call from any thread
+    NavigationState navigationState() const { return publishedState.load(); }
+
+    // Movement follows simulated time; without a shared clock a private real time clock is used
+    void setClock(SimulationClock *simulationClock);
+    SimulationClock *getClock() const { return clock; }
+    // Douglas-Peucker tolerance applied on load, 0 keeps every point
+    void setSimplifyTolerance(double meters) { simplifyToleranceM = meters; }
+    // Compiled routes are kept in RouteCache and reused while the source file is unchanged
+    void setRouteCacheEnabled(bool enabled) { routeCacheEnabled = enabled; }
+    // Simulated time between position updates
+    void setUpdateIntervalMs(int intervalMs) { updateIntervalMs = qMax(1, intervalMs); }
 
 signals:
-    void coordinateUpdated(const QGeoCoordinate &coordinate);
-    void LatLongChanged(double latitude, double longitude);
-    void nextWaypoint(const QString &name);
+    // One per update that changed anything, replaces the former per field signals
+    void navigationStateChanged(const NavigationState &state);
     void routeCompleted();
     void routeLoaded(bool loaded);
-    void headingUpdated(double headingRadians);
     void statusMessage(const QString &message);
-    void distanceToNextWaypoint(double distanceMeters); // New signal for distance in meters
-    void timeToNextWaypoint(double timeSeconds);
     void RunningStateChanged(bool state);
-    void distanceTraveledNM(double distanceNauticalMiles);
-    void timeTraveledSeconds(double totalTimeSeconds);
-    void XTEChanged(double XTE);
-    // TODO Refactor to use VesselWpBearing struct and removed redundant signals
-    void VesselWpBearingChanged(VesselWpBearing vesselWpBearing);
 
 public slots:
     void setSpeed(double speed);
 
+private slots:
+    void onClockTick(qint64 nowMs, qint64 deltaMs);
+
 private:
-    QVector<Waypoint> route;
+    RouteData route;
     int currentIndex;
     int lastIndex = -1;
     double speed; // in meters per second
-    QTimer updateTimer;
-    QElapsedTimer travelTimer;
+    SimulationClock *clock = nullptr;
+    bool running = false;
+    int updateIntervalMs = 1000;
+    double simplifyToleranceM = 0.0;
+    bool routeCacheEnabled = true;
+    qint64 pendingMs = 0;
+    qint64 travelTimeMs = 0;
     bool reverseRoute;
     bool forwardDirection;
-    QGeoCoordinate waypointPosition;
-    VesselWpBearing vesselWpBearing = VesselWpBearing();
+    RouteGeometry geometry;
+    double legDistance = 0.0; // Distance covered on the current leg, meters
+    double totalDistanceTraveled = 0.0; // in meters
+    // Working copy filled during an update, and the last snapshot handed to readers
+    NavigationState state;
+    NavigationState lastPublished;
+    SeqLock<NavigationState> publishedState;
 
-    void loadSettingGeometry();
-    void saveSettingGeometry();
-    bool parseKMLFile(const QString &filePath);
-    bool parseGPXFile(const QString &filePath);
+    int routeSize() const { return static_cast<int>(route.size()); }
     void calculateNextCoordinate();
-    void emitNextWaypoint();
-    double calculateHeading(const QGeoCoordinate &from, const QGeoCoordinate &to);
-    void emitDistanceAndTime(const QGeoCoordinate &current, const QGeoCoordinate &next);
-    void updateLatLong(double latitude, double longitude);
-    double totalDistanceTraveled = 0.0; // in meters
-    double calculateXTE(const QGeoCoordinate &currentPosition,
-                        const QGeoCoordinate &waypointPosition);
+    void updateDestination();
+    void updateDistanceAndTime(double distanceMeters);
+    double calculateXTE(int leg, const RouteGeometry::Point &position);
+    void publishState();
 };
 
 #endif // AUTOPILOTSIMULATOR_H
@@ -0,0 +1,85 @@
+#ifndef CAPTUREFORMAT_H
+#define CAPTUREFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// On disk layout of a bus capture, little endian, every entry starting on an 8 byte boundary:
+//
+//   FileHeader
+//   RecordHeader + payload, padded to 8 bytes             (repeated)
+//   RecordHeader with pgn == IndexMarker + IndexBlock + IndexEntry[pgnCount]
+//                                                        (after every indexInterval records)
+//   ...
+//   Footer                                               (written on close)
+//
+// Index blocks summarize the records since the previous block (time range, offset, and per PGN the
+// count and first offset) and chain backwards, so a reader starts at the footer, collects the block
+// list without touching the records, and seeks by time or PGN with a binary search. A capture cut
+// short (no footer) is still readable by walking the entries once.
+namespace CaptureFormat {
+
+constexpr char Magic[8] = {'R', 'N', 'S', 'C', 'A', 'P', '0', '1'};
+constexpr char FooterMagic[8] = {'R', 'N', 'S', 'C', 'A', 'P', 'I', 'X'};
+constexpr uint32_t Version = 1;
+
+constexpr uint32_t PgnMask = 0x00FFFFFFu;
+constexpr uint32_t TransmitFlag = 0x80000000u;  // In RecordHeader::pgn, sent by us rather than received
+constexpr uint32_t IndexMarker = 0xFFFFFFFFu;   // RecordHeader::pgn of an index block
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int64_t createdUtcUs;
+    uint32_t indexInterval;
+    uint32_t reserved[9];
+};
+
+struct RecordHeader {
+    uint64_t timestampUs;   // UTC microseconds since 1970
+    uint32_t pgn;           // PGN in the low 24 bits, TransmitFlag, or IndexMarker
+    uint8_t priority;
+    uint8_t source;
+    uint8_t destination;
+    uint8_t dataLen;
+};
+
+struct IndexBlock {
+    uint32_t byteSize;              // Whole block including its RecordHeader and entries
+    uint32_t recordCount;
+    uint64_t firstTimestampUs;
+    uint64_t lastTimestampUs;
+    uint64_t firstRecordOffset;
+    uint64_t previousIndexOffset;   // 0 for the first block
+    uint32_t pgnCount;
+    uint32_t reserved;
+};
+
+struct IndexEntry {
+    uint32_t pgn;                   // Including TransmitFlag, so sent and received are separate entries
+    uint32_t count;
+    uint64_t firstOffset;
+};
+
+struct Footer {
+    char magic[8];
+    uint64_t lastIndexOffset;
+    uint64_t recordCount;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader layout");
+static_assert(sizeof(RecordHeader) == 16, "RecordHeader layout");
+static_assert(sizeof(IndexBlock) == 48, "IndexBlock layout");
+static_assert(sizeof(IndexEntry) == 16, "IndexEntry layout");
+static_assert(sizeof(Footer) == 32, "Footer layout");
+
+inline size_t padded(size_t size)
+{
+    return (size + 7) & ~size_t(7);
+}
+
+}
+
+#endif // CAPTUREFORMAT_H
@@ -0,0 +1,319 @@
+#include "capturereader.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace CaptureFormat;
+
+namespace {
+
+constexpr uint64_t NoOffset = std::numeric_limits<uint64_t>::max();
+
+}
+
+void CaptureReader::Record::toMessage(tN2kMsg &N2kMsg) const
+{
+    N2kMsg.Clear();
+    N2kMsg.SetPGN(PGN);
+    N2kMsg.Priority = priority;
+    N2kMsg.Source = source;
+    N2kMsg.Destination = destination;
+    N2kMsg.DataLen = dataLen;
+    N2kMsg.MsgTime = static_cast<unsigned long>(timestampUs / 1000);
+    memcpy(N2kMsg.Data, data, dataLen);
+}
+
+CaptureReader::~CaptureReader()
+{
+    close();
+}
+
+bool CaptureReader::open(const QString &path, QString *error)
+{
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = "Unable to open capture " + path + ": " + file.errorString();
+        }
+        return false;
+    }
+    size = static_cast<uint64_t>(file.size());
+    base = size >= sizeof(FileHeader) ? file.map(0, file.size()) : nullptr;
+#ifdef Q_OS_UNIX
+    if (base) {
+        madvise(const_cast<uint8_t *>(base), size, MADV_SEQUENTIAL);
+    }
+#endif
+
+    FileHeader header;
+    if (base) {
+        memcpy(&header, base, sizeof(header));
+    }
+    if (!base || memcmp(header.magic, Magic, sizeof(header.magic)) != 0 || header.version != Version
+        || header.headerSize < sizeof(FileHeader) || header.headerSize > size) {
+        if (error) {
+            *error = path + " is not a capture file";
+        }
+        close();
+        return false;
+    }
+    createdUs = header.createdUtcUs;
+    dataStart = padded(header.headerSize);
+
+    Footer footer;
+    cleanClose = false;
+    if (size >= dataStart + sizeof(Footer)) {
+        memcpy(&footer, base + size - sizeof(Footer), sizeof(footer));
+        if (memcmp(footer.magic, FooterMagic, sizeof(footer.magic)) == 0) {
+            dataEnd = size - sizeof(Footer);
+            records = footer.recordCount;
+            cleanClose = footer.lastIndexOffset == 0 ? records == 0 : loadIndexChain(footer.lastIndexOffset);
+        }
+    }
+    if (!cleanClose) {
+        rebuildIndex();
+    }
+
+    if (!indexBlocks.empty()) {
+        firstUs = indexBlocks.front().firstTimestampUs;
+        lastUs = indexBlocks.back().lastTimestampUs;
+    }
+    return true;
+}
+
+void CaptureReader::close()
+{
+    if (base) {
+        file.unmap(const_cast<uchar *>(base));
+        base = nullptr;
+    }
+    file.close();
+    indexBlocks.clear();
+    size = dataStart = dataEnd = 0;
+    records = 0;
+    firstUs = lastUs = createdUs = 0;
+}
+
+bool CaptureReader::readHeader(uint64_t offset, RecordHeader &header) const
+{
+    if (offset + sizeof(RecordHeader) > dataEnd) {
+        return false;
+    }
+    memcpy(&header, base + offset, sizeof(header));
+    return true;
+}
+
+bool CaptureReader::readBlock(uint64_t indexOffset, Block &block, uint64_t &previousOffset) const
+{
+    RecordHeader header;
+    if (!readHeader(indexOffset, header) || header.pgn != IndexMarker
+        || indexOffset + sizeof(RecordHeader) + sizeof(IndexBlock) > dataEnd) {
+        return false;
+    }
+    IndexBlock index;
+    memcpy(&index, base + indexOffset + sizeof(RecordHeader), sizeof(index));
+    if (index.byteSize != sizeof(RecordHeader) + sizeof(IndexBlock) + index.pgnCount * sizeof(IndexEntry)
+        || indexOffset + index.byteSize > dataEnd || index.firstRecordOffset > indexOffset) {
+        return false;
+    }
+
+    block.firstRecordOffset = index.firstRecordOffset;
+    block.endOffset = indexOffset;
+    block.firstTimestampUs = static_cast<qint64>(index.firstTimestampUs);
+    block.lastTimestampUs = static_cast<qint64>(index.lastTimestampUs);
+    block.recordCount = index.recordCount;
+    // Entries are 8 byte aligned in the mapping, which is page aligned
+    block.entries = reinterpret_cast<const IndexEntry *>(base + indexOffset + sizeof(RecordHeader) + sizeof(IndexBlock));
+    block.pgnCount = index.pgnCount;
+    previousOffset = index.previousIndexOffset;
+    return true;
+}
+
+bool CaptureReader::loadIndexChain(uint64_t lastIndexOffset)
+{
+    indexBlocks.clear();
+    uint64_t offset = lastIndexOffset;
+    while (offset != 0) {
+        Block block;
+        uint64_t previous;
+        if (!readBlock(offset, block, previous) || (previous != 0 && previous >= offset)) {
+            indexBlocks.clear();
+            return false;
+        }
+        indexBlocks.push_back(block);
+        offset = previous;
+    }
+    std::reverse(indexBlocks.begin(), indexBlocks.end());
+    return true;
+}
+
+void CaptureReader::rebuildIndex()
+{
+    // No usable footer: walk the entries once, keep the index blocks that made it to disk and
+    // cover the records after the last one with a block without PGN entries
+    indexBlocks.clear();
+    records = 0;
+    dataEnd = size;
+
+    uint64_t offset = dataStart;
+    uint64_t tailStart = dataStart;
+    qint64 tailFirstUs = 0, tailLastUs = 0;
+    uint32_t tailRecords = 0;
+    RecordHeader header;
+    while (readHeader(offset, header)) {
+        if (header.pgn == IndexMarker) {
+            Block block;
+            uint64_t previous;
+            if (!readBlock(offset, block, previous)) {
+                break;
+            }
+            indexBlocks.push_back(block);
+            offset += padded(block.pgnCount * sizeof(IndexEntry) + sizeof(RecordHeader) + sizeof(IndexBlock));
+            tailStart = offset;
+            tailRecords = 0;
+            continue;
+        }
+        uint64_t next = offset + padded(sizeof(RecordHeader) + header.dataLen);
+        if (header.dataLen > tN2kMsg::MaxDataLen || next > size) {
+            break;
+        }
+        if (tailRecords == 0) {
+            tailFirstUs = static_cast<qint64>(header.timestampUs);
+        }
+        tailLastUs = static_cast<qint64>(header.timestampUs);
+        tailRecords++;
+        records++;
+        offset = next;
+    }
+    dataEnd = offset;
+
+    if (tailRecords > 0) {
+        Block tail;
+        tail.firstRecordOffset = tailStart;
+        tail.endOffset = dataEnd;
+        tail.firstTimestampUs = tailFirstUs;
+        tail.lastTimestampUs = tailLastUs;
+        tail.recordCount = tailRecords;
+        indexBlocks.push_back(tail);
+    }
+}
+
+bool CaptureReader::next(uint64_t &offset, Record &record) const
+{
+    RecordHeader header;
+    while (readHeader(offset, header)) {
+        if (header.pgn == IndexMarker) {
+            // Same checks as the index chain, a bad size would stall here or jump past the end
+            Block block;
+            uint64_t previous;
+            if (!readBlock(offset, block, previous)) {
+                return false;
+            }
+            offset += padded(sizeof(RecordHeader) + sizeof(IndexBlock) + block.pgnCount * sizeof(IndexEntry));
+            continue;
+        }
+
+        uint64_t following = offset + padded(sizeof(RecordHeader) + header.dataLen);
+        if (header.dataLen > tN2kMsg::MaxDataLen || following > dataEnd) {
+            return false;
+        }
+        record.timestampUs = static_cast<qint64>(header.timestampUs);
+        record.PGN = header.pgn & PgnMask;
+        record.transmitted = (header.pgn & TransmitFlag) != 0;
+        record.priority = header.priority;
+        record.source = header.source;
+        record.destination = header.destination;
+        record.dataLen = header.dataLen;
+        record.data = base + offset + sizeof(RecordHeader);
+        offset = following;
+        return true;
+    }
+    return false;
+}
+
+uint64_t CaptureReader::seekTime(qint64 timestampUs) const
+{
+    // First block that reaches timestampUs, then the first record in it that does
+    auto it = std::lower_bound(indexBlocks.begin(), indexBlocks.end(), timestampUs,
+                               [](const Block &block, qint64 time) { return block.lastTimestampUs < time; });
+    if (it == indexBlocks.end()) {
+        return dataEnd;
+    }
+
+    uint64_t offset = it->firstRecordOffset;
+    Record record;
+    for (uint64_t current = offset; next(offset, record); current = offset) {
+        if (record.timestampUs >= timestampUs) {
+            return current;
+        }
+    }
+    return dataEnd;
+}
+
+void CaptureReader::prefetch(uint64_t offset, uint64_t length) const
+{
+#ifdef Q_OS_UNIX
+    if (!base || offset >= dataEnd) {
+        return;
+    }
+    static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = offset & ~(pageSize - 1);
+    uint64_t end = qMin(offset + length, dataEnd);
+    madvise(const_cast<uint8_t *>(base) + start, end - start, MADV_WILLNEED);
+#else
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+#endif
+}
+
+int CaptureReader::blockFor(uint64_t offset) const
+{
+    auto it = std::upper_bound(indexBlocks.begin(), indexBlocks.end(), offset,
+                               [](uint64_t value, const Block &block) { return value < block.endOffset; });
+    return it == indexBlocks.end() ? -1 : static_cast<int>(it - indexBlocks.begin());
+}
+
+uint64_t CaptureReader::firstPgnOffset(const Block &block, unsigned long PGN) const
+{
+    if (!block.entries) {
+        return block.firstRecordOffset;
+    }
+    uint64_t first = NoOffset;
+    const IndexEntry *end = block.entries + block.pgnCount;
+    for (uint32_t key : {static_cast<uint32_t>(PGN), static_cast<uint32_t>(PGN) | TransmitFlag}) {
+        const IndexEntry *entry = std::lower_bound(block.entries, end, key,
+                                                   [](const IndexEntry &e, uint32_t value) { return e.pgn < value; });
+        if (entry != end && entry->pgn == key) {
+            first = std::min(first, entry->firstOffset);
+        }
+    }
+    return first;
+}
+
+bool CaptureReader::nextWithPgn(uint64_t &offset, unsigned long PGN, Record &record) const
+{
+    for (int b = blockFor(offset); b >= 0 && b < static_cast<int>(indexBlocks.size()); ++b) {
+        const Block &block = indexBlocks[b];
+        uint64_t first = firstPgnOffset(block, PGN);
+        if (first == NoOffset) {
+            offset = qMax(offset, block.endOffset);
+            continue;
+        }
+        offset = qMax(offset, first);
+        while (offset < block.endOffset && next(offset, record)) {
+            if (record.PGN == PGN) {
+                return true;
+            }
+        }
+        offset = qMax(offset, block.endOffset);
+    }
+
+    offset = dataEnd;
+    return false;
+}
@@ -0,0 +1,91 @@
+#ifndef CAPTUREREADER_H
+#define CAPTUREREADER_H
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <vector>
+#include "N2kMsg.h"
+#include "captureformat.h"
+
+// Memory maps a capture written by CaptureWriter. Opening reads only the footer and the chain of
+// index blocks; records are then reached by offset, by time (binary search over the blocks, then a
+// short scan inside one block) or by PGN (blocks without the PGN are skipped, and inside a block the
+// scan starts at the PGN's first record). Record payloads point straight into the mapping.
+class CaptureReader
+{
+public:
+    struct Record {
+        qint64 timestampUs = 0;     // UTC microseconds since 1970
+        unsigned long PGN = 0;
+        uint8_t priority = 0;
+        uint8_t source = 0;
+        uint8_t destination = 0;
+        bool transmitted = false;
+        int dataLen = 0;
+        const unsigned char *data = nullptr;    // Valid while the reader is open
+
+        void toMessage(tN2kMsg &N2kMsg) const;
+    };
+
+    struct Block {
+        uint64_t firstRecordOffset = 0;
+        uint64_t endOffset = 0;     // Offset of the block's index entry, the end of its records
+        qint64 firstTimestampUs = 0;
+        qint64 lastTimestampUs = 0;
+        uint32_t recordCount = 0;
+        const CaptureFormat::IndexEntry *entries = nullptr;  // Sorted by PGN
+        uint32_t pgnCount = 0;
+    };
+
+    CaptureReader() = default;
+    ~CaptureReader();
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    bool open(const QString &path, QString *error = nullptr);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    quint64 recordCount() const { return records; }
+    qint64 firstTimestampUs() const { return firstUs; }
+    qint64 lastTimestampUs() const { return lastUs; }
+    qint64 createdUtcUs() const { return createdUs; }
+    // False when the capture had no footer and its index was rebuilt by walking the file
+    bool wasClosedCleanly() const { return cleanClose; }
+    const std::vector<Block> &blocks() const { return indexBlocks; }
+
+    // Offset of the first record, or of the first record at or after timestampUs
+    uint64_t begin() const { return dataStart; }
+    uint64_t end() const { return dataEnd; }
+    uint64_t seekTime(qint64 timestampUs) const;
+    // Asks the kernel to start reading [offset, offset + length) ahead of use
+    void prefetch(uint64_t offset, uint64_t length) const;
+
+    // Reads the record at offset and moves offset past it, skipping index blocks; false at the end
+    bool next(uint64_t &offset, Record &record) const;
+    // Same, but only records of PGN (either direction), using the index to skip whole blocks
+    bool nextWithPgn(uint64_t &offset, unsigned long PGN, Record &record) const;
+
+private:
+    QFile file;
+    const uint8_t *base = nullptr;
+    uint64_t size = 0;
+    uint64_t dataStart = 0;
+    uint64_t dataEnd = 0;
+    quint64 records = 0;
+    qint64 firstUs = 0;
+    qint64 lastUs = 0;
+    qint64 createdUs = 0;
+    bool cleanClose = false;
+    std::vector<Block> indexBlocks;
+
+    bool loadIndexChain(uint64_t lastIndexOffset);
+    void rebuildIndex();
+    bool readBlock(uint64_t indexOffset, Block &block, uint64_t &previousOffset) const;
+    bool readHeader(uint64_t offset, CaptureFormat::RecordHeader &header) const;
+    int blockFor(uint64_t offset) const;
+    uint64_t firstPgnOffset(const Block &block, unsigned long PGN) const;
+};
+
+#endif // CAPTUREREADER_H
@@ -0,0 +1,266 @@
+#include "capturereplayer.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+qint64 nowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+CaptureReplayer::CaptureReplayer(QObject *parent)
+    : QObject(parent)
+{
+    setOptions(Options());
+}
+
+CaptureReplayer::~CaptureReplayer()
+{
+    stop();
+}
+
+bool CaptureReplayer::open(const QString &path, QString *error)
+{
+    stop();
+    return captureReader.open(path, error);
+}
+
+bool CaptureReplayer::setSink(Sink sink)
+{
+    if (isRunning()) {
+        return false;
+    }
+    messageSink = std::move(sink);
+    return true;
+}
+
+bool CaptureReplayer::setOptions(const Options &options)
+{
+    if (isRunning()) {
+        return false;
+    }
+    replayOptions = options;
+    replayOptions.speed = qBound(0.0, options.speed, MaxSpeed);
+
+    pgnFilter = options.pgns;
+    std::sort(pgnFilter.begin(), pgnFilter.end());
+    sourceFilter.reset();
+    for (uint8_t source : options.sources) {
+        sourceFilter.set(source);
+    }
+    if (options.sources.empty()) {
+        sourceFilter.set();
+    }
+    return true;
+}
+
+bool CaptureReplayer::start()
+{
+    if (isRunning() || !captureReader.isOpen()) {
+        return false;
+    }
+    if (thread) {
+        thread->wait();
+        delete thread;
+        thread = nullptr;
+    }
+
+    frames = 0;
+    filtered = 0;
+    batches = 0;
+    stalls = 0;
+    loops = 0;
+    cursor = captureReader.begin();
+    timingError.reset();
+    stopRequested = false;
+    running = true;
+    startedUs = nowUs();
+
+    thread = QThread::create([this]() { run(); });
+    thread->setObjectName("CaptureReplayer");
+    thread->start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+void CaptureReplayer::stop()
+{
+    if (!thread) {
+        return;
+    }
+    stopRequested = true;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+}
+
+CaptureReplayer::Statistics CaptureReplayer::statistics() const
+{
+    Statistics stats;
+    stats.frames = frames.load(std::memory_order_relaxed);
+    stats.filtered = filtered.load(std::memory_order_relaxed);
+    stats.batches = batches.load(std::memory_order_relaxed);
+    stats.stalls = stalls.load(std::memory_order_relaxed);
+    stats.loops = loops.load(std::memory_order_relaxed);
+    qint64 started = startedUs.load(std::memory_order_relaxed);
+    stats.elapsedUs = started == 0 ? 0 : (isRunning() ? nowUs() : stoppedUs.load(std::memory_order_relaxed)) - started;
+    stats.framesPerSecond = stats.elapsedUs > 0 ? stats.frames * 1e6 / stats.elapsedUs : 0.0;
+
+    uint64_t first = captureReader.begin();
+    uint64_t last = captureReader.end();
+    if (last > first) {
+        stats.progress = static_cast<double>(cursor.load(std::memory_order_relaxed) - first) / (last - first);
+    }
+    stats.timingError = timingError.snapshot();
+    return stats;
+}
+
+bool CaptureReplayer::accepts(const CaptureReader::Record &record) const
+{
+    if (record.transmitted && !replayOptions.transmitted) {
+        return false;
+    }
+    if (!sourceFilter.test(record.source)) {
+        return false;
+    }
+    return pgnFilter.empty() || std::binary_search(pgnFilter.begin(), pgnFilter.end(), record.PGN);
+}
+
+bool CaptureReplayer::deliver(const tN2kMsg *N2kMsgs, int count)
+{
+    int sent = 0;
+    while (sent < count) {
+        int taken = messageSink ? messageSink(N2kMsgs + sent, count - sent) : count - sent;
+        sent += qMax(0, taken);
+        if (sent < count) {
+            stalls.fetch_add(1, std::memory_order_relaxed);
+            if (stopRequested.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            // Give the consumer of the sink a moment to drain
+            QThread::usleep(50);
+        }
+    }
+    frames.fetch_add(static_cast<quint64>(count), std::memory_order_relaxed);
+    batches.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void CaptureReplayer::waitUntil(qint64 dueUs) const
+{
+    // Sleep in short slices so stop() is honoured during long gaps, then spin the last stretch
+    qint64 remaining = dueUs - nowUs();
+    while (remaining > SpinUs && !stopRequested.load(std::memory_order_relaxed)) {
+        QThread::usleep(static_cast<unsigned long>(qMin<qint64>(remaining - SpinUs, 50000)));
+        remaining = dueUs - nowUs();
+    }
+    while (nowUs() < dueUs && !stopRequested.load(std::memory_order_relaxed)) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+void CaptureReplayer::run()
+{
+    const double speed = replayOptions.speed;
+    const bool timed = speed > 0.0;
+
+    uint64_t passStart = captureReader.begin();
+    if (replayOptions.startOffsetUs > 0) {
+        passStart = captureReader.seekTime(captureReader.firstTimestampUs() + replayOptions.startOffsetUs);
+    }
+    uint64_t offset = passStart;
+    captureReader.prefetch(offset, PrefetchBytes);
+    uint64_t prefetched = offset + PrefetchBytes;
+
+    tN2kMsg batch[BatchSize];
+    qint64 due[BatchSize];
+    int batchCount = 0;
+
+    // Wall time a capture time maps to: anchorWallUs + (capture time - anchorCaptureUs) / speed
+    qint64 anchorWallUs = nowUs();
+    qint64 anchorCaptureUs = -1;
+    qint64 lastDueUs = anchorWallUs;
+    quint64 passFrames = 0;
+    quint64 skipped = 0;
+
+    auto sendBatch = [&]() {
+        if (batchCount == 0) {
+            return true;
+        }
+        bool delivered = deliver(batch, batchCount);
+        if (timed) {
+            qint64 sentUs = nowUs();
+            for (int i = 0; i < batchCount; ++i) {
+                timingError.record(static_cast<uint64_t>(qMax<qint64>(0, sentUs - due[i])));
+            }
+        }
+        filtered.fetch_add(skipped, std::memory_order_relaxed);
+        skipped = 0;
+        cursor.store(offset, std::memory_order_relaxed);
+        batchCount = 0;
+        return delivered;
+    };
+
+    CaptureReader::Record record;
+    while (!stopRequested.load(std::memory_order_relaxed)) {
+        if (!captureReader.next(offset, record)) {
+            if (!sendBatch() || !replayOptions.loop || passFrames == 0) {
+                break;
+            }
+            // The next pass starts where this one ended
+            loops.fetch_add(1, std::memory_order_relaxed);
+            offset = passStart;
+            captureReader.prefetch(offset, PrefetchBytes);
+            prefetched = offset + PrefetchBytes;
+            anchorWallUs = lastDueUs;
+            anchorCaptureUs = -1;
+            passFrames = 0;
+            continue;
+        }
+        if (offset + PrefetchBytes > prefetched) {
+            captureReader.prefetch(prefetched, PrefetchStepBytes);
+            prefetched += PrefetchStepBytes;
+        }
+        if (!accepts(record)) {
+            skipped++;
+            continue;
+        }
+
+        qint64 dueUs = 0;
+        if (timed) {
+            if (anchorCaptureUs < 0) {
+                anchorCaptureUs = record.timestampUs;
+            }
+            dueUs = anchorWallUs + static_cast<qint64>((record.timestampUs - anchorCaptureUs) / speed);
+            lastDueUs = dueUs;
+            // Everything due within the window of the batch's first record goes out together
+            if (batchCount > 0 && dueUs - due[0] > BatchWindowUs && !sendBatch()) {
+                break;
+            }
+            if (batchCount == 0) {
+                waitUntil(dueUs);
+            }
+        }
+
+        record.toMessage(batch[batchCount]);
+        due[batchCount] = dueUs;
+        batchCount++;
+        passFrames++;
+        if (batchCount == BatchSize && !sendBatch()) {
+            break;
+        }
+    }
+    if (!stopRequested.load(std::memory_order_relaxed)) {
+        sendBatch();
+    }
+    cursor.store(offset, std::memory_order_relaxed);
+
+    stoppedUs = nowUs();
+    running.store(false, std::memory_order_release);
+    if (!stopRequested.load(std::memory_order_relaxed)) {
+        emit finished();
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef CAPTUREREPLAYER_H
+#define CAPTUREREPLAYER_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <bitset>
+#include <functional>
+#include <vector>
+#include "N2kMsg.h"
+#include "capturereader.h"
+#include "latencyhistogram.h"
+
+// Plays a capture back onto the bus from its own thread. Every record is due at its original offset
+// from the first one divided by the speed; the thread sleeps until shortly before the next due time,
+// spins the rest, and hands everything that is due as one batch to the sink. Speed 0 runs flat out,
+// limited only by how fast the sink takes batches. The capture is memory mapped and the pages ahead
+// of the cursor are requested before they are needed, so the loop never waits on the disk.
+//
+// The sink is called from the replay thread. When it accepts only part of a batch the rest is retried,
+// so a full transmit ring slows the replay down instead of dropping frames; the lateness shows up in
+// the timing error histogram.
+class CaptureReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Returns how many of the messages were taken, like PgnScheduler::Sink
+    using Sink = std::function<int(const tN2kMsg *N2kMsgs, int count)>;
+
+    struct Options {
+        double speed = 1.0;                 // 1 is the original timing, up to MaxSpeed; 0 is flat out
+        bool loop = false;                  // Start over at the end instead of finishing
+        qint64 startOffsetUs = 0;           // Skip this much of the capture, found through the index
+        std::vector<unsigned long> pgns;    // Only these PGNs, empty plays all
+        std::vector<uint8_t> sources;       // Only these sources, empty plays all
+        bool transmitted = true;            // Include the messages we sent while capturing
+    };
+
+    struct Statistics {
+        quint64 frames = 0;             // Handed to the sink
+        quint64 filtered = 0;           // Skipped by the PGN and source filters
+        quint64 batches = 0;
+        quint64 stalls = 0;             // Sink calls that did not take the whole batch
+        quint64 loops = 0;
+        qint64 elapsedUs = 0;
+        double framesPerSecond = 0.0;
+        double progress = 0.0;          // Of the current pass, 0-1
+        LatencyHistogram::Snapshot timingError;    // Send time minus due time, timed playback only
+    };
+
+    static constexpr double MaxSpeed = 1000.0;
+
+    explicit CaptureReplayer(QObject *parent = nullptr);
+    ~CaptureReplayer();
+
+    bool open(const QString &path, QString *error = nullptr);
+    const CaptureReader &reader() const { return captureReader; }
+
+    // Both are read by the replay thread without locking, so they are refused (false) while a
+    // replay runs; changes take effect on the next start()
+    bool setSink(Sink sink);
+    bool setOptions(const Options &options);
+    const Options &options() const { return replayOptions; }
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+
+    Statistics statistics() const;
+
+signals:
+    // Emitted from the replay thread when the capture ran out and looping is off
+    void finished();
+
+private:
+    static constexpr int BatchSize = 64;
+    static constexpr qint64 SpinUs = 1000;             // Wake up this early and spin to the due time
+    static constexpr qint64 BatchWindowUs = 100;       // Records due this soon go out with the batch
+    static constexpr uint64_t PrefetchBytes = 8 << 20;
+    static constexpr uint64_t PrefetchStepBytes = 1 << 20;
+
+    CaptureReader captureReader;
+    Sink messageSink;
+    Options replayOptions;
+    std::bitset<256> sourceFilter;
+    std::vector<unsigned long> pgnFilter;   // Sorted
+    QThread *thread = nullptr;
+    std::atomic<bool> running{false};
+    std::atomic<bool> stopRequested{false};
+
+    std::atomic<quint64> frames{0};
+    std::atomic<quint64> filtered{0};
+    std::atomic<quint64> batches{0};
+    std::atomic<quint64> stalls{0};
+    std::atomic<quint64> loops{0};
+    std::atomic<qint64> startedUs{0};
+    std::atomic<qint64> stoppedUs{0};
+    std::atomic<uint64_t> cursor{0};
+    LatencyHistogram timingError;
+
+    void run();
+    bool accepts(const CaptureReader::Record &record) const;
+    bool deliver(const tN2kMsg *N2kMsgs, int count);
+    void waitUntil(qint64 dueUs) const;
+};
+
+#endif // CAPTUREREPLAYER_H
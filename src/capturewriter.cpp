@@ -0,0 +1,201 @@
+#include "capturewriter.h"
+#include <QDateTime>
+#include <algorithm>
+#include <cstring>
+
+using namespace CaptureFormat;
+
+CaptureWriter::CaptureWriter(int indexInterval, int bufferBytes)
+    : buffer(static_cast<size_t>(qMax(64 * 1024, bufferBytes)))
+    , indexInterval(qMax(1, indexInterval))
+{
+    pgnSlotsUsed.reserve(PgnTableLimit);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(const QString &path, QString *error)
+{
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        if (error) {
+            *error = "Unable to create capture " + path + ": " + file.errorString();
+        }
+        return false;
+    }
+
+    used = 0;
+    flushedBytes = 0;
+    stats = Statistics();
+    blockRecords = 0;
+    lastIndexOffset = 0;
+
+    FileHeader header = {};
+    memcpy(header.magic, Magic, sizeof(header.magic));
+    header.version = Version;
+    header.headerSize = sizeof(FileHeader);
+    header.createdUtcUs = QDateTime::currentMSecsSinceEpoch() * 1000;
+    header.indexInterval = static_cast<uint32_t>(indexInterval);
+    append(&header, sizeof(header));
+    return true;
+}
+
+void CaptureWriter::close()
+{
+    if (!file.isOpen()) {
+        return;
+    }
+
+    if (blockRecords > 0) {
+        writeIndexBlock();
+    }
+    Footer footer = {};
+    memcpy(footer.magic, FooterMagic, sizeof(footer.magic));
+    footer.lastIndexOffset = lastIndexOffset;
+    footer.recordCount = stats.records;
+    append(&footer, sizeof(footer));
+
+    flush();
+    file.close();
+}
+
+void CaptureWriter::write(const tN2kMsg &N2kMsg, qint64 timestampUs, bool transmitted)
+{
+    if (!file.isOpen() || N2kMsg.DataLen < 0 || N2kMsg.DataLen > tN2kMsg::MaxDataLen) {
+        return;
+    }
+
+    const uint64_t recordOffset = offset();
+    const size_t size = padded(sizeof(RecordHeader) + N2kMsg.DataLen);
+    uint8_t *out = reserve(size);
+
+    RecordHeader header;
+    header.timestampUs = static_cast<uint64_t>(timestampUs);
+    header.pgn = (N2kMsg.PGN & PgnMask) | (transmitted ? TransmitFlag : 0);
+    header.priority = N2kMsg.Priority;
+    header.source = N2kMsg.Source;
+    header.destination = N2kMsg.Destination;
+    header.dataLen = static_cast<uint8_t>(N2kMsg.DataLen);
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), N2kMsg.Data, N2kMsg.DataLen);
+    // Padding is zeroed so captures are reproducible byte for byte
+    memset(out + sizeof(header) + N2kMsg.DataLen, 0, size - sizeof(header) - N2kMsg.DataLen);
+
+    if (blockRecords == 0) {
+        blockFirstTimestampUs = header.timestampUs;
+        blockFirstOffset = recordOffset;
+    }
+    blockLastTimestampUs = header.timestampUs;
+    blockRecords++;
+    stats.records++;
+    countPgn(header.pgn, recordOffset);
+
+    if (blockRecords >= static_cast<uint32_t>(indexInterval) || pgnSlotsUsed.size() >= PgnTableLimit) {
+        writeIndexBlock();
+    }
+}
+
+void CaptureWriter::countPgn(uint32_t pgn, uint64_t recordOffset)
+{
+    uint32_t slot = (pgn * 0x9E3779B1u) >> 23;  // Top 9 bits, PgnTableSize entries
+    while (true) {
+        PgnSlot &entry = pgnTable[slot];
+        if (entry.count == 0) {
+            entry.pgn = pgn;
+            entry.count = 1;
+            entry.firstOffset = recordOffset;
+            pgnSlotsUsed.push_back(static_cast<uint16_t>(slot));
+            return;
+        }
+        if (entry.pgn == pgn) {
+            entry.count++;
+            return;
+        }
+        slot = (slot + 1) & (PgnTableSize - 1);
+    }
+}
+
+void CaptureWriter::writeIndexBlock()
+{
+    const uint64_t indexOffset = offset();
+    const uint32_t pgnCount = static_cast<uint32_t>(pgnSlotsUsed.size());
+    const size_t size = sizeof(RecordHeader) + sizeof(IndexBlock) + pgnCount * sizeof(IndexEntry);
+
+    RecordHeader header = {};
+    header.timestampUs = blockLastTimestampUs;
+    header.pgn = IndexMarker;
+    append(&header, sizeof(header));
+
+    IndexBlock block = {};
+    block.byteSize = static_cast<uint32_t>(size);
+    block.recordCount = blockRecords;
+    block.firstTimestampUs = blockFirstTimestampUs;
+    block.lastTimestampUs = blockLastTimestampUs;
+    block.firstRecordOffset = blockFirstOffset;
+    block.previousIndexOffset = lastIndexOffset;
+    block.pgnCount = pgnCount;
+    append(&block, sizeof(block));
+
+    // Sorted by PGN so readers can binary search the entries of a block
+    std::sort(pgnSlotsUsed.begin(), pgnSlotsUsed.end(), [this](uint16_t a, uint16_t b) {
+        return pgnTable[a].pgn < pgnTable[b].pgn;
+    });
+    for (uint16_t slot : pgnSlotsUsed) {
+        IndexEntry entry;
+        entry.pgn = pgnTable[slot].pgn;
+        entry.count = pgnTable[slot].count;
+        entry.firstOffset = pgnTable[slot].firstOffset;
+        append(&entry, sizeof(entry));
+        pgnTable[slot] = PgnSlot();
+    }
+    pgnSlotsUsed.clear();
+
+    lastIndexOffset = indexOffset;
+    blockRecords = 0;
+    stats.indexBlocks++;
+}
+
+uint8_t *CaptureWriter::reserve(size_t size)
+{
+    if (used + size > buffer.size()) {
+        flush();
+    }
+    uint8_t *out = buffer.data() + used;
+    used += size;
+    stats.bytes += size;
+    return out;
+}
+
+void CaptureWriter::append(const void *data, size_t size)
+{
+    // Index blocks and headers are all multiples of 8 bytes, entries stay aligned
+    const uint8_t *in = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        if (used == buffer.size()) {
+            flush();
+        }
+        size_t chunk = std::min(size, buffer.size() - used);
+        memcpy(buffer.data() + used, in, chunk);
+        used += chunk;
+        stats.bytes += chunk;
+        in += chunk;
+        size -= chunk;
+    }
+}
+
+void CaptureWriter::flush()
+{
+    if (used == 0 || !file.isOpen()) {
+        return;
+    }
+    if (file.write(reinterpret_cast<const char *>(buffer.data()), static_cast<qint64>(used)) != static_cast<qint64>(used)) {
+        stats.writeErrors++;
+    }
+    flushedBytes += used;
+    used = 0;
+}
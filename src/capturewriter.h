@@ -0,0 +1,76 @@
+#ifndef CAPTUREWRITER_H
+#define CAPTUREWRITER_H
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <vector>
+#include "N2kMsg.h"
+#include "captureformat.h"
+
+// Appends messages to a capture file (see captureformat.h). Records are copied into a large
+// buffer that is written out when full, and the index block is maintained on the side in a small
+// fixed hash table, so the cost per message is a copy of its bytes. Not thread safe: write from the
+// one thread that receives the messages.
+class CaptureWriter
+{
+public:
+    struct Statistics {
+        quint64 records = 0;
+        quint64 bytes = 0;          // Written to the file so far, including buffered bytes
+        quint64 indexBlocks = 0;
+        quint64 writeErrors = 0;
+    };
+
+    static constexpr int DefaultIndexInterval = 4096;
+    static constexpr int DefaultBufferBytes = 1 << 20;
+
+    explicit CaptureWriter(int indexInterval = DefaultIndexInterval, int bufferBytes = DefaultBufferBytes);
+    ~CaptureWriter();
+
+    bool open(const QString &path, QString *error = nullptr);
+    // Writes the last index block and the footer
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    QString fileName() const { return file.fileName(); }
+
+    // timestampUs is UTC microseconds and must not go backwards
+    void write(const tN2kMsg &N2kMsg, qint64 timestampUs, bool transmitted = false);
+    void flush();
+
+    Statistics statistics() const { return stats; }
+
+private:
+    struct PgnSlot {
+        uint32_t pgn = 0;
+        uint32_t count = 0;
+        uint64_t firstOffset = 0;
+    };
+
+    // Open addressing table of the PGNs in the current block; the block is closed early at the load limit
+    static constexpr int PgnTableSize = 512;
+    static constexpr int PgnTableLimit = 384;
+
+    QFile file;
+    std::vector<uint8_t> buffer;
+    size_t used = 0;
+    uint64_t flushedBytes = 0;
+    int indexInterval;
+    Statistics stats;
+
+    uint32_t blockRecords = 0;
+    uint64_t blockFirstTimestampUs = 0;
+    uint64_t blockLastTimestampUs = 0;
+    uint64_t blockFirstOffset = 0;
+    uint64_t lastIndexOffset = 0;
+    PgnSlot pgnTable[PgnTableSize];
+    std::vector<uint16_t> pgnSlotsUsed;
+
+    uint64_t offset() const { return flushedBytes + used; }
+    uint8_t *reserve(size_t size);
+    void append(const void *data, size_t size);
+    void countPgn(uint32_t pgn, uint64_t recordOffset);
+    void writeIndexBlock();
+};
+
+#endif // CAPTUREWRITER_H
@@ -699,18 +699,6 @@ double Convert::QDateTimeToUnixTimestamp(const QDateTime &date)
     return std::floor(static_cast<double>(diff));
 }
 
-double Convert::RadiansToDegrees(double radians)
-{
-    double degrees = (180 / 3.141592653589793) * radians;
-    return degrees;
-}
-
-double Convert::DegreesToRadians(double degrees)
-{
-    double radians = degrees * (3.141592653589793 / 180);
-    return radians;
-}
-
 double Convert::MetersToNauticalMiles(double meters)
 {
     return meters * 0.00053995680;
@@ -73,8 +73,8 @@ public:
     static QDateTime Nmea0183TimeToLocalDateTime(const QString &timeUTC, int localOffset);
     static QString SkTimeToLocalTimeFormatted(QString skTime, int localOffset);
     // Navigation
-    static double RadiansToDegrees(double radians);
-    static double DegreesToRadians(double degrees);
+    static double RadiansToDegrees(double radians) { return radians * (180 / 3.141592653589793); }
+    static double DegreesToRadians(double degrees) { return degrees * (3.141592653589793 / 180); }
     static double MagneticToTrue(double degrees, double variation);
     static double MagneticToTrueHeading(double magneticHeading, double magneticVariation, bool isVariationEast);
     static double TrueToMagentic(double degrees, double variation);
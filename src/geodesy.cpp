@@ -0,0 +1,224 @@
+#include "geodesy.h"
+#include <cmath>
+
+// The loops only vectorize when sqrt may skip errno and selects may evaluate both sides, see the
+// -fno-math-errno -fno-trapping-math flags in simcore.pri.
+//
+// Function multiversioning needs GCC with ifunc support; elsewhere the kernels are built once for the
+// baseline target (which already includes NEON on AArch64)
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define GEODESY_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define GEODESY_CLONES
+#endif
+
+#if defined(__GNUC__)
+#define GEODESY_INLINE inline __attribute__((always_inline))
+#define GEODESY_SIMD _Pragma("omp simd")
+#else
+#define GEODESY_INLINE inline
+#define GEODESY_SIMD
+#endif
+
+namespace {
+
+constexpr double Pi = 3.141592653589793;
+constexpr double DegToRad = Pi / 180.0;
+constexpr double RadToDeg = 180.0 / Pi;
+
+// floor for |value| < 2^20 through a truncating conversion, which vectorizes without SSE4.1
+GEODESY_INLINE double fastFloor(double value)
+{
+    return static_cast<double>(static_cast<int>(value + 1048576.0) - 1048576);
+}
+
+// sin and cos of x with |x| up to a few thousand radians, about 1 ulp on [-pi/4, pi/4]
+GEODESY_INLINE void fastSinCos(double x, double &sinOut, double &cosOut)
+{
+    // Reduce by multiples of pi/2 in two parts to keep the low bits
+    const double k = fastFloor(x * (2.0 / Pi) + 0.5);
+    const double r = (x - k * 1.57079632673412561417e+00) - k * 6.07710050650619224932e-11;
+    const double z = r * r;
+
+    const double s = r + r * z * (((((1.58962301576546568060e-10 * z - 2.50507477628578072866e-8) * z
+                                     + 2.75573136213857245213e-6) * z - 1.98412698295895385996e-4) * z
+                                   + 8.33333333332211858878e-3) * z - 1.66666666666666307295e-1);
+    const double c = 1.0 - 0.5 * z + z * z * (((((-1.13585365213876817300e-11 * z + 2.08757008419747316778e-9) * z
+                                                 - 2.75573141792967388112e-7) * z + 2.48015872888517045348e-5) * z
+                                               - 1.38888888888730564116e-3) * z + 4.16666666666665929218e-2);
+
+    // Quadrant selects and negates, written as selects so the loop stays branch-free
+    const int quadrant = static_cast<int>(k) & 3;
+    const double sinBase = (quadrant & 1) ? c : s;
+    const double cosBase = (quadrant & 1) ? s : c;
+    sinOut = (quadrant & 2) ? -sinBase : sinBase;
+    cosOut = ((quadrant + 1) & 2) ? -cosBase : cosBase;
+}
+
+// atan of t in [0, 1], Cephes rational approximation
+GEODESY_INLINE double fastAtanUnit(double t)
+{
+    const bool upper = t > 0.66;
+    // Divisions are unconditional and only their operands selected, so the loop can be if-converted
+    const double x = (upper ? t - 1.0 : t) / (upper ? t + 1.0 : 1.0);
+    const double z = x * x;
+    const double p = (((-8.750608600031904122785e-1 * z - 1.615753718733365076637e1) * z
+                       - 7.500855792314704667340e1) * z - 1.228866684490136173410e2) * z - 6.485021904942025371773e1;
+    const double q = ((((z + 2.485846490142306297962e1) * z + 1.650270098316988542046e2) * z
+                       + 4.328810604912902668951e2) * z + 4.853903996359136964868e2) * z + 1.945506571482613964425e2;
+    const double a = x + x * z * p / q;
+    return upper ? a + (Pi / 4.0 + 0.5 * 6.123233995736765886130e-17) : a;
+}
+
+GEODESY_INLINE double fastAtan2(double y, double x)
+{
+    const double ay = std::fabs(y);
+    const double ax = std::fabs(x);
+    const double high = ax > ay ? ax : ay;
+    const double low = ax > ay ? ay : ax;
+    double a = fastAtanUnit(low / (high > 0.0 ? high : 1.0));
+    a = ay > ax ? Pi / 2.0 - a : a;
+    a = x < 0.0 ? Pi - a : a;
+    return y < 0.0 ? -a : a;
+}
+
+GEODESY_INLINE double clampUnit(double value)
+{
+    return value < -1.0 ? -1.0 : (value > 1.0 ? 1.0 : value);
+}
+
+} // namespace
+
+GEODESY_CLONES
+void Geodesy::distance(const double *lat1, const double *lon1, const double *lat2, const double *lon2,
+                       double *distanceM, size_t count)
+{
+    GEODESY_SIMD
+    for (size_t i = 0; i < count; i++) {
+        double sinLat1, cosLat1, sinLat2, cosLat2, sinHalfLat, cosHalfLat, sinHalfLon, cosHalfLon;
+        fastSinCos(lat1[i] * DegToRad, sinLat1, cosLat1);
+        fastSinCos(lat2[i] * DegToRad, sinLat2, cosLat2);
+        fastSinCos((lat2[i] - lat1[i]) * (0.5 * DegToRad), sinHalfLat, cosHalfLat);
+        fastSinCos((lon2[i] - lon1[i]) * (0.5 * DegToRad), sinHalfLon, cosHalfLon);
+
+        double h = sinHalfLat * sinHalfLat + cosLat1 * cosLat2 * sinHalfLon * sinHalfLon;
+        h = h > 1.0 ? 1.0 : h;
+        distanceM[i] = 2.0 * EarthRadiusM * fastAtan2(std::sqrt(h), std::sqrt(1.0 - h));
+    }
+}
+
+GEODESY_CLONES
+void Geodesy::initialBearing(const double *lat1, const double *lon1, const double *lat2, const double *lon2,
+                             double *bearing, size_t count)
+{
+    GEODESY_SIMD
+    for (size_t i = 0; i < count; i++) {
+        double sinLat1, cosLat1, sinLat2, cosLat2, sinDLon, cosDLon;
+        fastSinCos(lat1[i] * DegToRad, sinLat1, cosLat1);
+        fastSinCos(lat2[i] * DegToRad, sinLat2, cosLat2);
+        fastSinCos((lon2[i] - lon1[i]) * DegToRad, sinDLon, cosDLon);
+
+        double b = fastAtan2(sinDLon * cosLat2, cosLat1 * sinLat2 - sinLat1 * cosLat2 * cosDLon);
+        bearing[i] = b < 0.0 ? b + 2.0 * Pi : b;
+    }
+}
+
+GEODESY_CLONES
+void Geodesy::destination(const double *lat, const double *lon, const double *bearing, const double *distanceM,
+                          double *latOut, double *lonOut, size_t count)
+{
+    GEODESY_SIMD
+    for (size_t i = 0; i < count; i++) {
+        double sinLat, cosLat, sinBearing, cosBearing, sinAngle, cosAngle;
+        fastSinCos(lat[i] * DegToRad, sinLat, cosLat);
+        fastSinCos(bearing[i], sinBearing, cosBearing);
+        fastSinCos(distanceM[i] / EarthRadiusM, sinAngle, cosAngle);
+
+        double sinLat2 = clampUnit(sinLat * cosAngle + cosLat * sinAngle * cosBearing);
+        double lat2 = fastAtan2(sinLat2, std::sqrt(1.0 - sinLat2 * sinLat2));
+        double dLon = fastAtan2(sinBearing * sinAngle * cosLat, cosAngle - sinLat * sinLat2);
+
+        double lon2 = lon[i] + dLon * RadToDeg;
+        latOut[i] = lat2 * RadToDeg;
+        lonOut[i] = lon2 - 360.0 * fastFloor((lon2 + 180.0) * (1.0 / 360.0));
+    }
+}
+
+GEODESY_CLONES
+void Geodesy::crossTrack(const double *lat, const double *lon, size_t count,
+                         double startLat, double startLon, double endLat, double endLon, double *xteM)
+{
+    // Unit normal of the track plane, pointing left of start -> end
+    const double sLat = startLat * DegToRad, sLon = startLon * DegToRad;
+    const double eLat = endLat * DegToRad, eLon = endLon * DegToRad;
+    const double ax = std::cos(sLat) * std::cos(sLon), ay = std::cos(sLat) * std::sin(sLon), az = std::sin(sLat);
+    const double bx = std::cos(eLat) * std::cos(eLon), by = std::cos(eLat) * std::sin(eLon), bz = std::sin(eLat);
+    double nx = ay * bz - az * by, ny = az * bx - ax * bz, nz = ax * by - ay * bx;
+    const double norm = std::sqrt(nx * nx + ny * ny + nz * nz);
+    const double inv = norm > 0.0 ? 1.0 / norm : 0.0;
+    nx *= inv;
+    ny *= inv;
+    nz *= inv;
+
+    GEODESY_SIMD
+    for (size_t i = 0; i < count; i++) {
+        double sinLat, cosLat, sinLon, cosLon;
+        fastSinCos(lat[i] * DegToRad, sinLat, cosLat);
+        fastSinCos(lon[i] * DegToRad, sinLon, cosLon);
+
+        double side = clampUnit(cosLat * cosLon * nx + cosLat * sinLon * ny + sinLat * nz);
+        xteM[i] = -EarthRadiusM * fastAtan2(side, std::sqrt(1.0 - side * side));
+    }
+}
+
+void Geodesy::Reference::distance(const double *lat1, const double *lon1, const double *lat2, const double *lon2,
+                                  double *distanceM, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        double phi1 = lat1[i] * DegToRad, phi2 = lat2[i] * DegToRad;
+        double sinHalfLat = std::sin((phi2 - phi1) / 2.0);
+        double sinHalfLon = std::sin((lon2[i] - lon1[i]) * DegToRad / 2.0);
+        double h = sinHalfLat * sinHalfLat + std::cos(phi1) * std::cos(phi2) * sinHalfLon * sinHalfLon;
+        distanceM[i] = 2.0 * EarthRadiusM * std::asin(std::sqrt(std::fmin(1.0, h)));
+    }
+}
+
+void Geodesy::Reference::initialBearing(const double *lat1, const double *lon1, const double *lat2, const double *lon2,
+                                        double *bearing, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        double phi1 = lat1[i] * DegToRad, phi2 = lat2[i] * DegToRad;
+        double dLon = (lon2[i] - lon1[i]) * DegToRad;
+        double b = std::atan2(std::sin(dLon) * std::cos(phi2),
+                              std::cos(phi1) * std::sin(phi2) - std::sin(phi1) * std::cos(phi2) * std::cos(dLon));
+        bearing[i] = b < 0.0 ? b + 2.0 * Pi : b;
+    }
+}
+
+void Geodesy::Reference::destination(const double *lat, const double *lon, const double *bearing, const double *distanceM,
+                                     double *latOut, double *lonOut, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        double phi = lat[i] * DegToRad;
+        double angle = distanceM[i] / EarthRadiusM;
+        double sinLat2 = clampUnit(std::sin(phi) * std::cos(angle) + std::cos(phi) * std::sin(angle) * std::cos(bearing[i]));
+        double lat2 = std::asin(sinLat2);
+        double dLon = std::atan2(std::sin(bearing[i]) * std::sin(angle) * std::cos(phi), std::cos(angle) - std::sin(phi) * sinLat2);
+        double lon2 = lon[i] + dLon * RadToDeg;
+        latOut[i] = lat2 * RadToDeg;
+        lonOut[i] = lon2 - 360.0 * std::floor((lon2 + 180.0) / 360.0);
+    }
+}
+
+void Geodesy::Reference::crossTrack(const double *lat, const double *lon, size_t count,
+                                    double startLat, double startLon, double endLat, double endLon, double *xteM)
+{
+    // Classic formulation: angular distance and bearings from the start point
+    for (size_t i = 0; i < count; i++) {
+        double d13, theta13, theta12;
+        distance(&startLat, &startLon, &lat[i], &lon[i], &d13, 1);
+        initialBearing(&startLat, &startLon, &lat[i], &lon[i], &theta13, 1);
+        initialBearing(&startLat, &startLon, &endLat, &endLon, &theta12, 1);
+        xteM[i] = std::asin(std::sin(d13 / EarthRadiusM) * std::sin(theta13 - theta12)) * EarthRadiusM;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef GEODESY_H
+#define GEODESY_H
+
+#include <cstddef>
+
+// Batch geodesy on a spherical earth (same radius as QGeoCoordinate) over structure of arrays
+// latitude/longitude columns in degrees. The batch kernels use branch-free polynomial sin, cos and
+// atan2 so the compiler can vectorize the loops (AVX2 clone on x86-64 GCC, NEON on AArch64); the
+// Reference functions are the same formulas through <cmath> and serve as the accuracy baseline.
+// Input and output arrays may not overlap, except where noted.
+class Geodesy
+{
+public:
+    static constexpr double EarthRadiusM = 6371007.2;
+
+    // Great circle (haversine) distance between point pairs, meters
+    static void distance(const double *lat1, const double *lon1, const double *lat2, const double *lon2,
+                         double *distanceM, size_t count);
+    // Initial bearing from point 1 to point 2, radians in [0, 2 pi)
+    static void initialBearing(const double *lat1, const double *lon1, const double *lat2, const double *lon2,
+                               double *bearing, size_t count);
+    // Point reached from (lat, lon) after distanceM on the initial bearing (radians)
+    static void destination(const double *lat, const double *lon, const double *bearing, const double *distanceM,
+                            double *latOut, double *lonOut, size_t count);
+    // Distance of every point to the great circle through start and end, positive right of start -> end
+    static void crossTrack(const double *lat, const double *lon, size_t count,
+                           double startLat, double startLon, double endLat, double endLon, double *xteM);
+
+    struct Reference {
+        static void distance(const double *lat1, const double *lon1, const double *lat2, const double *lon2,
+                             double *distanceM, size_t count);
+        static void initialBearing(const double *lat1, const double *lon1, const double *lat2, const double *lon2,
+                                   double *bearing, size_t count);
+        static void destination(const double *lat, const double *lon, const double *bearing, const double *distanceM,
+                                double *latOut, double *lonOut, size_t count);
+        static void crossTrack(const double *lat, const double *lon, size_t count,
+                               double startLat, double startLon, double endLat, double endLon, double *xteM);
+    };
+};
+
+#endif // GEODESY_H
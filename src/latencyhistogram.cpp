@@ -0,0 +1,62 @@
+#include "latencyhistogram.h"
+
+int LatencyHistogram::bucketFor(uint64_t latencyUs)
+{
+    int bucket = 0;
+    while (latencyUs != 0 && bucket < BucketCount - 1) {
+        latencyUs >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void LatencyHistogram::record(uint64_t latencyUs)
+{
+    buckets[bucketFor(latencyUs)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalUs.fetch_add(latencyUs, std::memory_order_relaxed);
+
+    uint64_t currentMax = maxUs.load(std::memory_order_relaxed);
+    while (latencyUs > currentMax
+           && !maxUs.compare_exchange_weak(currentMax, latencyUs, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot result;
+    for (int i = 0; i < BucketCount; i++) {
+        result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    result.count = count.load(std::memory_order_relaxed);
+    result.totalUs = totalUs.load(std::memory_order_relaxed);
+    result.maxUs = maxUs.load(std::memory_order_relaxed);
+    return result;
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    totalUs.store(0, std::memory_order_relaxed);
+    maxUs.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::percentileUs(double percentile) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(count * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += buckets[i];
+        if (seen > target) {
+            return i == 0 ? 1 : (uint64_t(1) << i);
+        }
+    }
+    return maxUs;
+}
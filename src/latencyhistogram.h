@@ -0,0 +1,40 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Log2 bucketed latency histogram in microseconds. Recording is a couple of relaxed atomic adds so
+// it can sit on the I/O path; any thread may read a snapshot.
+class LatencyHistogram
+{
+public:
+    // Bucket i counts samples in [2^(i-1), 2^i) us, bucket 0 is everything below 1 us
+    static constexpr int BucketCount = 32;
+
+    struct Snapshot {
+        std::array<uint64_t, BucketCount> buckets{};
+        uint64_t count = 0;
+        uint64_t totalUs = 0;
+        uint64_t maxUs = 0;
+
+        double meanUs() const { return count ? static_cast<double>(totalUs) / count : 0.0; }
+        // Upper bound of the bucket holding the given percentile (0-100)
+        uint64_t percentileUs(double percentile) const;
+    };
+
+    void record(uint64_t latencyUs);
+    Snapshot snapshot() const;
+    void reset();
+
+    static int bucketFor(uint64_t latencyUs);
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalUs{0};
+    std::atomic<uint64_t> maxUs{0};
+};
+
+#endif // LATENCYHISTOGRAM_H
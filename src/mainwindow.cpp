@@ -18,7 +18,7 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , nmea2000Handler(new Nmea2000Handler(this))
+    , simulationEngine(new SimulationEngine(this))
 {
     ui->setupUi(this);
 
@@ -94,8 +94,9 @@ void MainWindow::saveSettings() {}
 
 void MainWindow::initilizeOthers()
 {
-    // Initialize the Nmea2000Handler
-    nmea2000Handler->InitializeActisense("COM6");
+    // Transport, scheduler and autopilot live in the headless engine; port and route come from settings
+    QSettings settings(APP_COMPANY, APP_NAME);
+    simulationEngine->start(SimulationEngine::Config::load(settings));
 }
 
 void MainWindow::initilizeUnits() {}
@@ -114,6 +115,6 @@ void MainWindow::on_actionSend_Test_129026_triggered()
     double cog = Convert::DegreesToRadians(45.0);
     double sog = Convert::MphToMetersPerSecond(20);
 
-    nmea2000Handler->SendPgn129026(cog, sog);
+    simulationEngine->handler().SendPgn129026(cog, sog);
 }
 
@@ -7,7 +7,7 @@
 #include "convert.h"
 #include "dataenums.h"
 #include "dialogsetup.h"
-#include "nmea2000handler.h"
+#include "simulationengine.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -37,7 +37,7 @@ public slots:
 
 private:
     Ui::MainWindow *ui;
-    Nmea2000Handler *nmea2000Handler;
+    SimulationEngine *simulationEngine;
     DialogSetup *dialogSetup;
 
     QTimer *pollTimer = new QTimer(this);
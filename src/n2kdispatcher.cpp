@@ -0,0 +1,92 @@
+#include "n2kdispatcher.h"
+#include <algorithm>
+
+void N2kDispatcher::registerHandler(unsigned long PGN, Handler handler)
+{
+    if (PGN > MaxPGN || !handler) {
+        return;
+    }
+    registrations.push_back({PGN, std::move(handler)});
+    rebuild();
+}
+
+void N2kDispatcher::unregisterAll(unsigned long PGN)
+{
+    registrations.erase(std::remove_if(registrations.begin(), registrations.end(),
+                                       [PGN](const Registration &r) { return r.PGN == PGN; }),
+                        registrations.end());
+    rebuild();
+}
+
+void N2kDispatcher::clear()
+{
+    registrations.clear();
+    rebuild();
+}
+
+void N2kDispatcher::rebuild()
+{
+    // Stable so handlers for one PGN run in registration order
+    std::vector<Registration> sorted = registrations;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Registration &a, const Registration &b) { return a.PGN < b.PGN; });
+
+    pgns.clear();
+    firstHandler.clear();
+    handlers.clear();
+    std::fill(filter.begin(), filter.end(), 0);
+
+    for (const Registration &r : sorted) {
+        if (pgns.empty() || pgns.back() != r.PGN) {
+            pgns.push_back(r.PGN);
+            firstHandler.push_back(static_cast<uint32_t>(handlers.size()));
+            filter[r.PGN >> 6] |= uint64_t(1) << (r.PGN & 63);
+        }
+        handlers.push_back(r.handler);
+    }
+    firstHandler.push_back(static_cast<uint32_t>(handlers.size()));
+}
+
+int N2kDispatcher::indexOf(unsigned long PGN) const
+{
+    // Branch-free lower bound, the table is small and hot
+    const unsigned long *base = pgns.data();
+    size_t n = pgns.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        base = (base[half] <= PGN) ? base + half : base;
+        n -= half;
+    }
+    return (n == 1 && *base == PGN) ? static_cast<int>(base - pgns.data()) : -1;
+}
+
+bool N2kDispatcher::dispatch(const tN2kMsg &N2kMsg)
+{
+    if (!isSubscribed(N2kMsg.PGN)) {
+        stats.rejected++;
+        return false;
+    }
+
+    int index = indexOf(N2kMsg.PGN);
+    if (index < 0) {
+        stats.rejected++;
+        return false;
+    }
+
+    for (uint32_t i = firstHandler[index]; i < firstHandler[index + 1]; i++) {
+        handlers[i](N2kMsg);
+    }
+    stats.dispatched++;
+    return true;
+}
+
+size_t N2kDispatcher::dispatch(const tN2kMsg *N2kMsgs, size_t count)
+{
+    size_t delivered = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (dispatch(N2kMsgs[i])) {
+            delivered++;
+        }
+    }
+    return delivered;
+}
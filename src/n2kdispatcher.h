@@ -0,0 +1,68 @@
+#ifndef N2KDISPATCHER_H
+#define N2KDISPATCHER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "N2kMsg.h"
+
+// Routes received messages to handlers registered per PGN. Registration happens at startup and
+// rebuilds a flat sorted PGN table plus a one bit per PGN filter, so dispatching a message nobody
+// subscribed to is a single bit test and a subscribed one is a binary search over a small array.
+class N2kDispatcher
+{
+public:
+    using Handler = std::function<void(const tN2kMsg &)>;
+
+    // Largest PGN: 18 bits including the data page bit
+    static constexpr unsigned long MaxPGN = 0x3FFFF;
+
+    struct Statistics {
+        uint64_t dispatched = 0;
+        uint64_t rejected = 0;
+    };
+
+    template<unsigned long PGN>
+    void registerHandler(Handler handler)
+    {
+        static_assert(PGN <= MaxPGN, "PGN out of range");
+        registerHandler(PGN, std::move(handler));
+    }
+    void registerHandler(unsigned long PGN, Handler handler);
+    void unregisterAll(unsigned long PGN);
+    void clear();
+
+    bool isSubscribed(unsigned long PGN) const
+    {
+        return PGN <= MaxPGN && (filter[PGN >> 6] >> (PGN & 63)) & 1;
+    }
+
+    // Returns true if at least one handler saw the message
+    bool dispatch(const tN2kMsg &N2kMsg);
+    size_t dispatch(const tN2kMsg *N2kMsgs, size_t count);
+
+    std::vector<unsigned long> subscribedPGNs() const { return pgns; }
+    size_t handlerCount() const { return handlers.size(); }
+    const Statistics &statistics() const { return stats; }
+
+private:
+    struct Registration {
+        unsigned long PGN;
+        Handler handler;
+    };
+
+    std::vector<Registration> registrations;
+
+    // Built from registrations: pgns is sorted and unique, handlers for pgns[i] are
+    // handlers[firstHandler[i] .. firstHandler[i + 1])
+    std::vector<unsigned long> pgns;
+    std::vector<uint32_t> firstHandler;
+    std::vector<Handler> handlers;
+    std::vector<uint64_t> filter = std::vector<uint64_t>((MaxPGN + 1) / 64, 0);
+    Statistics stats;
+
+    void rebuild();
+    int indexOf(unsigned long PGN) const;
+};
+
+#endif // N2KDISPATCHER_H
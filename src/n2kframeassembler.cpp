@@ -0,0 +1,448 @@
+#include "n2kframeassembler.h"
+#include <cstring>
+
+namespace {
+
+// Standard PGNs transmitted as fast packets (NMEA 2000 appendix B, as listed by canboat)
+const unsigned long DefaultFastPacketPGNs[] = {
+    65240L, 126208L, 126464L, 126710L, 126711L, 126712L, 126713L, 126714L, 126720L, 126983L, 126984L,
+    126985L, 126986L, 126987L, 126988L, 126996L, 126998L, 127233L, 127237L, 127489L, 127490L, 127491L,
+    127494L, 127495L, 127496L, 127497L, 127498L, 127503L, 127504L, 127506L, 127507L, 127509L, 127510L,
+    127511L, 127512L, 127513L, 127514L, 128275L, 128520L, 128538L, 129029L, 129038L, 129039L, 129040L,
+    129041L, 129044L, 129045L, 129284L, 129285L, 129301L, 129302L, 129538L, 129540L, 129541L, 129542L,
+    129545L, 129547L, 129549L, 129551L, 129556L, 129792L, 129793L, 129794L, 129795L, 129796L, 129797L,
+    129798L, 129799L, 129800L, 129801L, 129802L, 129803L, 129804L, 129805L, 129806L, 129807L, 129808L,
+    129809L, 129810L, 130052L, 130053L, 130054L, 130060L, 130061L, 130064L, 130065L, 130066L, 130067L,
+    130068L, 130069L, 130070L, 130071L, 130072L, 130073L, 130074L, 130320L, 130321L, 130322L, 130323L,
+    130324L, 130330L, 130560L, 130561L, 130562L, 130563L, 130564L, 130565L, 130566L, 130567L, 130569L,
+    130570L, 130571L, 130572L, 130573L, 130574L, 130577L, 130578L, 130579L, 130580L, 130581L, 130582L,
+    130583L, 130584L, 130585L, 130586L
+};
+
+// Transport protocol connection management control bytes
+constexpr unsigned char TpRequestToSend = 16;
+constexpr unsigned char TpBroadcastAnnounce = 32;
+constexpr unsigned char TpAbort = 255;
+
+constexpr uint64_t FastPacketKey = 1ULL << 40;
+constexpr uint64_t TransportKey = 2ULL << 40;
+
+inline uint64_t fastPacketKey(unsigned char source, unsigned long PGN, unsigned char sequence)
+{
+    return FastPacketKey | (uint64_t(source) << 32) | (uint64_t(PGN) << 8) | sequence;
+}
+
+inline uint64_t transportKey(unsigned char source, unsigned char destination)
+{
+    return TransportKey | (uint64_t(source) << 8) | destination;
+}
+
+}
+
+N2kFrameAssembler::N2kFrameAssembler(int slotCount, int timeoutMs)
+    : pool(static_cast<size_t>(qMax(1, slotCount)))
+    , timeout(qMax(1, timeoutMs))
+{
+    for (unsigned long PGN : DefaultFastPacketPGNs) {
+        fastPacketPGNs.set(PGN);
+    }
+    // Proprietary fast packet ranges
+    for (unsigned long PGN = 126720L; PGN <= 126975L; PGN++) {
+        fastPacketPGNs.set(PGN);
+    }
+    for (unsigned long PGN = 130816L; PGN <= 131071L; PGN++) {
+        fastPacketPGNs.set(PGN);
+    }
+}
+
+void N2kFrameAssembler::parseCanId(unsigned long canId, unsigned char &priority, unsigned long &PGN,
+                                   unsigned char &source, unsigned char &destination)
+{
+    priority = static_cast<unsigned char>((canId >> 26) & 0x7);
+    source = static_cast<unsigned char>(canId & 0xFF);
+    unsigned char PF = static_cast<unsigned char>(canId >> 16);
+    unsigned char PS = static_cast<unsigned char>(canId >> 8);
+    unsigned long DP = (canId >> 24) & 0x3;
+    if (PF < 240) {
+        // PDU1, addressed: PS is the destination
+        destination = PS;
+        PGN = (DP << 16) | (static_cast<unsigned long>(PF) << 8);
+    } else {
+        destination = 0xFF;
+        PGN = (DP << 16) | (static_cast<unsigned long>(PF) << 8) | PS;
+    }
+}
+
+unsigned long N2kFrameAssembler::canId(unsigned char priority, unsigned long PGN, unsigned char source, unsigned char destination)
+{
+    unsigned long id = (static_cast<unsigned long>(priority & 0x7) << 26) | ((PGN & MaxPGN) << 8) | source;
+    if (((PGN >> 8) & 0xFF) < 240) {
+        id = (id & ~0xFF00UL) | (static_cast<unsigned long>(destination) << 8);
+    }
+    return id;
+}
+
+int N2kFrameAssembler::fragment(const tN2kMsg &N2kMsg, unsigned char sequence, Frame *frames, bool recording) const
+{
+    const int length = N2kMsg.DataLen;
+    if (length < 0 || length > tN2kMsg::MaxDataLen) {
+        return 0;
+    }
+    const unsigned char source = N2kMsg.Source;
+    const unsigned char destination = N2kMsg.Destination;
+    int count = 0;
+
+    auto addFrame = [&](unsigned long id, const unsigned char *head, int headLen, const unsigned char *data, int dataLen) {
+        Frame &frame = frames[count++];
+        frame.canId = id;
+        frame.len = 8;
+        memcpy(frame.data, head, headLen);
+        memcpy(frame.data + headLen, data, dataLen);
+        memset(frame.data + headLen + dataLen, 0xFF, 8 - headLen - dataLen);
+    };
+
+    if (isFastPacket(N2kMsg.PGN)) {
+        const unsigned long id = canId(N2kMsg.Priority, N2kMsg.PGN, source, destination);
+        const unsigned char counter = static_cast<unsigned char>((sequence & 0x7) << 5);
+        unsigned char head[2] = {counter, static_cast<unsigned char>(length)};
+        int offset = qMin(6, length);
+        addFrame(id, head, 2, N2kMsg.Data, offset);
+        for (unsigned char frame = 1; offset < length; frame++) {
+            head[0] = counter | frame;
+            int chunk = qMin(7, length - offset);
+            addFrame(id, head, 1, N2kMsg.Data + offset, chunk);
+            offset += chunk;
+        }
+        return count;
+    }
+
+    if (length <= 8) {
+        Frame &frame = frames[count++];
+        frame.canId = canId(N2kMsg.Priority, N2kMsg.PGN, source, destination);
+        frame.len = static_cast<unsigned char>(length);
+        memcpy(frame.data, N2kMsg.Data, length);
+        return count;
+    }
+
+    // RTS/CTS is a conversation with the receiver, only BAM can go out in one piece
+    const bool broadcast = destination == 0xFF;
+    if (!broadcast && !recording) {
+        return 0;
+    }
+    const unsigned char packets = static_cast<unsigned char>((length + 6) / 7);
+    const unsigned char announce[8] = {
+        broadcast ? TpBroadcastAnnounce : TpRequestToSend, static_cast<unsigned char>(length & 0xFF),
+        static_cast<unsigned char>(length >> 8), packets, 0xFF, static_cast<unsigned char>(N2kMsg.PGN & 0xFF),
+        static_cast<unsigned char>((N2kMsg.PGN >> 8) & 0xFF), static_cast<unsigned char>((N2kMsg.PGN >> 16) & 0xFF)};
+    addFrame(canId(N2kMsg.Priority, TransportControlPGN, source, destination), announce, 8, N2kMsg.Data, 0);
+
+    const unsigned long dataId = canId(N2kMsg.Priority, TransportDataPGN, source, destination);
+    for (int packet = 1; packet <= packets; packet++) {
+        const unsigned char number = static_cast<unsigned char>(packet);
+        const int offset = (packet - 1) * 7;
+        addFrame(dataId, &number, 1, N2kMsg.Data + offset, qMin(7, length - offset));
+    }
+    return count;
+}
+
+void N2kFrameAssembler::setFastPacket(unsigned long PGN, bool fastPacket)
+{
+    if (PGN <= MaxPGN) {
+        fastPacketPGNs.set(PGN, fastPacket);
+    }
+}
+
+bool N2kFrameAssembler::addFrame(unsigned long canId, unsigned char len, const unsigned char *buf, qint64 nowMs, tN2kMsg &N2kMsg)
+{
+    if (len > 8) {
+        return false;
+    }
+    stats.frames++;
+    if (firstFrameMs < 0) {
+        firstFrameMs = nowMs;
+    }
+    lastFrameMs = nowMs;
+
+    unsigned char priority, source, destination;
+    unsigned long PGN;
+    parseCanId(canId, priority, PGN, source, destination);
+
+    if (PGN == TransportControlPGN) {
+        addTransportControl(priority, source, destination, len, buf, nowMs);
+        return false;
+    }
+    if (PGN == TransportDataPGN) {
+        return addTransportData(source, destination, len, buf, nowMs, N2kMsg);
+    }
+    if (isFastPacket(PGN)) {
+        return addFastPacketFrame(priority, PGN, source, destination, len, buf, nowMs, N2kMsg);
+    }
+
+    N2kMsg.Clear();
+    N2kMsg.SetPGN(PGN);
+    N2kMsg.Priority = priority;
+    N2kMsg.Source = source;
+    N2kMsg.Destination = destination;
+    N2kMsg.DataLen = len;
+    memcpy(N2kMsg.Data, buf, len);
+    stats.singleFrames++;
+    return true;
+}
+
+bool N2kFrameAssembler::addFastPacketFrame(unsigned char priority, unsigned long PGN, unsigned char source,
+                                           unsigned char destination, unsigned char len, const unsigned char *buf,
+                                           qint64 nowMs, tN2kMsg &N2kMsg)
+{
+    if (len < 1) {
+        stats.sequenceErrors++;
+        return false;
+    }
+    // Three bit sequence counter tells interleaved messages apart, five bit frame counter orders frames
+    const unsigned char sequence = buf[0] >> 5;
+    const unsigned char frame = buf[0] & 0x1F;
+    const uint64_t key = fastPacketKey(source, PGN, sequence);
+
+    Slot *slot = find(key, nowMs);
+    if (frame == 0 && slot && (slot->received & 1u)) {
+        // A new first frame restarts a message whose remaining frames never came
+        stats.sequenceErrors++;
+        release(*slot);
+        slot = nullptr;
+    }
+    if (!slot) {
+        slot = &allocate(key, nowMs);
+        slot->priority = priority;
+        slot->PGN = PGN;
+        slot->destination = destination;
+    }
+
+    int offset, count;
+    if (frame == 0) {
+        if (len < 2 || buf[1] > tN2kMsg::MaxDataLen) {
+            stats.sequenceErrors++;
+            release(*slot);
+            return false;
+        }
+        slot->length = buf[1];
+        slot->frameCount = static_cast<uint8_t>(slot->length <= 6 ? 1 : 1 + (slot->length - 6 + 6) / 7);
+        offset = 0;
+        count = qMin(6, len - 2);
+        buf += 2;
+    } else {
+        offset = 6 + (frame - 1) * 7;
+        count = len - 1;
+        buf += 1;
+    }
+
+    const uint32_t bit = 1u << frame;
+    if ((slot->received & bit) || (slot->length != UnknownLength && frame >= slot->frameCount)) {
+        stats.sequenceErrors++;
+        return false;
+    }
+    count = qMin(count, static_cast<int>(tN2kMsg::MaxDataLen) - offset);
+    if (count > 0) {
+        memcpy(slot->data + offset, buf, count);
+    }
+    slot->received |= bit;
+    slot->lastFrameMs = nowMs;
+
+    // Frames may arrive out of order; done once the length is known and every frame is in
+    if (slot->length == UnknownLength || slot->received != (slot->frameCount == 32 ? ~0u : (1u << slot->frameCount) - 1)) {
+        return false;
+    }
+    complete(*slot, source, N2kMsg);
+    stats.fastPackets++;
+    return true;
+}
+
+void N2kFrameAssembler::addTransportControl(unsigned char priority, unsigned char source, unsigned char destination,
+                                            unsigned char len, const unsigned char *buf, qint64 nowMs)
+{
+    if (len < 8) {
+        return;
+    }
+    const unsigned char control = buf[0];
+
+    if (control == TpAbort) {
+        // Either side may abort, so drop the session in both directions
+        for (uint64_t key : {transportKey(source, destination), transportKey(destination, source)}) {
+            if (Slot *slot = find(key, nowMs)) {
+                release(*slot);
+                stats.sequenceErrors++;
+            }
+        }
+        return;
+    }
+    if (control != TpRequestToSend && control != TpBroadcastAnnounce) {
+        // CTS and end of message acknowledgements carry nothing to reassemble
+        return;
+    }
+
+    const uint16_t size = static_cast<uint16_t>(buf[1] | (buf[2] << 8));
+    const uint8_t packets = buf[3];
+    const unsigned long PGN = buf[5] | (static_cast<unsigned long>(buf[6]) << 8) | (static_cast<unsigned long>(buf[7]) << 16);
+    const uint64_t key = transportKey(source, control == TpBroadcastAnnounce ? 0xFF : destination);
+
+    Slot *slot = find(key, nowMs);
+    if (slot) {
+        // A new announcement replaces an unfinished session
+        stats.sequenceErrors++;
+        release(*slot);
+    }
+    if (size > tN2kMsg::MaxDataLen) {
+        stats.oversize++;
+        return;
+    }
+    if (size < 9 || packets != (size + 6) / 7) {
+        stats.sequenceErrors++;
+        return;
+    }
+
+    Slot &session = allocate(key, nowMs);
+    session.priority = priority;
+    session.PGN = PGN;
+    session.destination = control == TpBroadcastAnnounce ? 0xFF : destination;
+    session.length = size;
+    session.frameCount = packets;
+}
+
+bool N2kFrameAssembler::addTransportData(unsigned char source, unsigned char destination, unsigned char len,
+                                         const unsigned char *buf, qint64 nowMs, tN2kMsg &N2kMsg)
+{
+    Slot *slot = find(transportKey(source, destination), nowMs);
+    if (!slot) {
+        stats.orphanFrames++;
+        return false;
+    }
+    if (len < 2) {
+        stats.sequenceErrors++;
+        return false;
+    }
+
+    // Packets are numbered from 1
+    const int packet = buf[0];
+    if (packet < 1 || packet > slot->frameCount || (slot->received & (1u << (packet - 1)))) {
+        stats.sequenceErrors++;
+        return false;
+    }
+    const int offset = (packet - 1) * 7;
+    const int count = qMin(len - 1, slot->length - offset);
+    memcpy(slot->data + offset, buf + 1, count);
+    slot->received |= 1u << (packet - 1);
+    slot->lastFrameMs = nowMs;
+
+    if (slot->received != (slot->frameCount == 32 ? ~0u : (1u << slot->frameCount) - 1)) {
+        return false;
+    }
+    complete(*slot, source, N2kMsg);
+    stats.transportMessages++;
+    return true;
+}
+
+N2kFrameAssembler::Slot *N2kFrameAssembler::find(uint64_t key, qint64 nowMs)
+{
+    if (used == 0) {
+        return nullptr;
+    }
+    for (Slot &slot : pool) {
+        if (slot.key != key) {
+            continue;
+        }
+        if (nowMs - slot.lastFrameMs > timeout) {
+            stats.timeouts++;
+            release(slot);
+            return nullptr;
+        }
+        return &slot;
+    }
+    return nullptr;
+}
+
+N2kFrameAssembler::Slot &N2kFrameAssembler::allocate(uint64_t key, qint64 nowMs)
+{
+    if (used == static_cast<int>(pool.size())) {
+        expire(nowMs);
+    }
+
+    Slot *target = nullptr;
+    for (Slot &slot : pool) {
+        if (slot.key == 0) {
+            target = &slot;
+            break;
+        }
+        if (!target || slot.lastFrameMs < target->lastFrameMs) {
+            target = &slot;
+        }
+    }
+    if (target->key != 0) {
+        // Still full after expiry: the least recently fed partial message goes
+        stats.evictions++;
+        release(*target);
+    }
+
+    target->key = key;
+    target->lastFrameMs = nowMs;
+    target->received = 0;
+    target->length = UnknownLength;
+    target->frameCount = 0;
+    used++;
+    return *target;
+}
+
+void N2kFrameAssembler::release(Slot &slot)
+{
+    if (slot.key != 0) {
+        slot.key = 0;
+        used--;
+    }
+}
+
+void N2kFrameAssembler::complete(Slot &slot, unsigned char source, tN2kMsg &N2kMsg)
+{
+    N2kMsg.Clear();
+    N2kMsg.SetPGN(slot.PGN);
+    N2kMsg.Priority = slot.priority;
+    N2kMsg.Source = source;
+    N2kMsg.Destination = slot.destination;
+    N2kMsg.DataLen = slot.length;
+    memcpy(N2kMsg.Data, slot.data, slot.length);
+    release(slot);
+}
+
+void N2kFrameAssembler::expire(qint64 nowMs)
+{
+    if (used == 0) {
+        return;
+    }
+    for (Slot &slot : pool) {
+        if (slot.key != 0 && nowMs - slot.lastFrameMs > timeout) {
+            stats.timeouts++;
+            release(slot);
+        }
+    }
+}
+
+void N2kFrameAssembler::clear()
+{
+    for (Slot &slot : pool) {
+        release(slot);
+    }
+}
+
+N2kFrameAssembler::Statistics N2kFrameAssembler::statistics() const
+{
+    Statistics result = stats;
+    result.slotsInUse = used;
+    qint64 spanMs = lastFrameMs - firstFrameMs;
+    if (firstFrameMs >= 0 && spanMs > 0) {
+        result.reassembledPerSecond = (stats.fastPackets + stats.transportMessages) * 1000.0 / spanMs;
+    }
+    return result;
+}
+
+void N2kFrameAssembler::resetStatistics()
+{
+    stats = Statistics();
+    firstFrameMs = -1;
+    lastFrameMs = 0;
+}
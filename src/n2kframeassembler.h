@@ -0,0 +1,110 @@
+#ifndef N2KFRAMEASSEMBLER_H
+#define N2KFRAMEASSEMBLER_H
+
+#include <QtGlobal>
+#include <bitset>
+#include <cstdint>
+#include <vector>
+#include "N2kMsg.h"
+
+// Turns raw 29 bit CAN frames back into NMEA2000 messages: single frames directly, fast packets
+// (up to 223 bytes in 32 frames) and ISO 11783-3 transport protocol sessions (BAM broadcasts and
+// RTS/CTS transfers, observed passively) through a fixed pool of reassembly slots. Slots are keyed
+// by source, PGN and fast packet sequence (or source and destination for transport sessions), are
+// allocated once, and are reclaimed after a timeout or, when the pool is full, oldest first.
+class N2kFrameAssembler
+{
+public:
+    struct Statistics {
+        quint64 frames = 0;
+        quint64 singleFrames = 0;
+        quint64 fastPackets = 0;        // Messages completed from fast packet frames
+        quint64 transportMessages = 0;  // Messages completed from transport protocol sessions
+        quint64 timeouts = 0;           // Partial messages dropped after timeoutMs without a frame
+        quint64 evictions = 0;          // Partial messages dropped because the pool was full
+        quint64 sequenceErrors = 0;     // Duplicate frames, frames past the message end, aborts
+        quint64 orphanFrames = 0;       // Transport data without a session
+        quint64 oversize = 0;           // Transport sessions longer than tN2kMsg::MaxDataLen
+        int slotsInUse = 0;
+        double reassembledPerSecond = 0.0;  // Between the first and the last frame seen
+    };
+
+    struct Frame {
+        unsigned long canId;
+        unsigned char len;
+        unsigned char data[8];
+    };
+
+    // A transport session of the largest message: the announcement plus 32 data packets
+    static constexpr int MaxFrames = 33;
+    static constexpr int DefaultSlotCount = 64;
+    static constexpr int DefaultTimeoutMs = 750;
+
+    explicit N2kFrameAssembler(int slotCount = DefaultSlotCount, int timeoutMs = DefaultTimeoutMs);
+
+    // Returns true when the frame completed a message, which is then in N2kMsg
+    bool addFrame(unsigned long canId, unsigned char len, const unsigned char *buf, qint64 nowMs, tN2kMsg &N2kMsg);
+    // Drops partial messages older than the timeout
+    void expire(qint64 nowMs);
+    void clear();
+
+    // PGNs that are sent as fast packets when longer than 8 bytes; the standard set is preloaded
+    void setFastPacket(unsigned long PGN, bool fastPacket);
+    bool isFastPacket(unsigned long PGN) const { return PGN <= MaxPGN && fastPacketPGNs.test(PGN); }
+
+    // The reverse of addFrame: splits a message into a single frame, fast packet frames numbered with
+    // the three bit sequence, or a BAM transport session when broadcast. An addressed transfer needs the
+    // receiver's CTS before each block and is not sent, so a message longer than 8 bytes that is neither
+    // a fast packet nor broadcast gives 0. Log writers pass recording to get it as it appears on the
+    // bus instead, RTS plus all data packets. frames must hold MaxFrames; returns the number written,
+    // 0 for an invalid or unsendable message.
+    int fragment(const tN2kMsg &N2kMsg, unsigned char sequence, Frame *frames, bool recording = false) const;
+
+    void setTimeoutMs(int timeoutMs) { timeout = qMax(1, timeoutMs); }
+    Statistics statistics() const;
+    void resetStatistics();
+
+    static void parseCanId(unsigned long canId, unsigned char &priority, unsigned long &PGN,
+                           unsigned char &source, unsigned char &destination);
+    static unsigned long canId(unsigned char priority, unsigned long PGN, unsigned char source, unsigned char destination);
+
+private:
+    static constexpr unsigned long MaxPGN = 0x1FFFF;
+    static constexpr unsigned long TransportControlPGN = 60416L;   // TP.CM
+    static constexpr unsigned long TransportDataPGN = 60160L;      // TP.DT
+    static constexpr uint16_t UnknownLength = 0xFFFF;
+
+    struct Slot {
+        uint64_t key = 0;               // 0 marks a free slot
+        qint64 lastFrameMs = 0;
+        uint32_t received = 0;          // One bit per frame or packet
+        uint16_t length = UnknownLength;
+        uint8_t frameCount = 0;         // Frames needed once the length is known
+        uint8_t priority = 6;
+        uint8_t destination = 0xFF;
+        unsigned long PGN = 0;
+        unsigned char data[tN2kMsg::MaxDataLen];
+    };
+
+    std::vector<Slot> pool;
+    std::bitset<MaxPGN + 1> fastPacketPGNs;
+    int timeout;
+    int used = 0;
+    Statistics stats;
+    qint64 firstFrameMs = -1;
+    qint64 lastFrameMs = 0;
+
+    bool addFastPacketFrame(unsigned char priority, unsigned long PGN, unsigned char source, unsigned char destination,
+                            unsigned char len, const unsigned char *buf, qint64 nowMs, tN2kMsg &N2kMsg);
+    void addTransportControl(unsigned char priority, unsigned char source, unsigned char destination,
+                             unsigned char len, const unsigned char *buf, qint64 nowMs);
+    bool addTransportData(unsigned char source, unsigned char destination, unsigned char len,
+                          const unsigned char *buf, qint64 nowMs, tN2kMsg &N2kMsg);
+
+    Slot *find(uint64_t key, qint64 nowMs);
+    Slot &allocate(uint64_t key, qint64 nowMs);
+    void release(Slot &slot);
+    void complete(Slot &slot, unsigned char source, tN2kMsg &N2kMsg);
+};
+
+#endif // N2KFRAMEASSEMBLER_H
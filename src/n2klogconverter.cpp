@@ -0,0 +1,390 @@
+#include "n2klogconverter.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QtConcurrent>
+#include <unordered_map>
+#include "capturereader.h"
+#include "capturewriter.h"
+
+using Type = N2kLogFormat::Type;
+using Entry = N2kLogFormat::Entry;
+
+namespace {
+
+struct Chunk {
+    size_t begin = 0;               // Byte range of the input, record offsets for captures
+    size_t end = 0;
+    std::vector<Entry> entries;
+    std::vector<N2kLogFormat::CanFrame> frames;
+    quint64 skipped = 0;
+    qint64 lastTimestampUs = -1;    // Last EBL timestamp record, it also covers the next chunk
+    quint64 framesWritten = 0;
+    QByteArray output;
+};
+
+// Hands out the input in rounds of chunks that start and end on record boundaries
+class LogInput
+{
+public:
+    quint64 frames = 0;
+
+    bool open(const QString &path, Type inputType, int chunkBytes, QString *error)
+    {
+        type = inputType;
+        chunkSize = static_cast<size_t>(qMax(64 * 1024, chunkBytes));
+        if (type == Type::Capture) {
+            if (!reader.open(path, error)) {
+                return false;
+            }
+            inputSize = QFile(path).size();
+            return true;
+        }
+
+        file.setFileName(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            *error = "Unable to open " + path + ": " + file.errorString();
+            return false;
+        }
+        inputSize = static_cast<size_t>(file.size());
+        data = inputSize > 0 ? file.map(0, file.size()) : nullptr;
+        if (inputSize > 0 && !data) {
+            *error = "Unable to map " + path + ": " + file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    quint64 size() const { return inputSize; }
+
+    bool nextRound(std::vector<Chunk> &round, int maxChunks)
+    {
+        round.clear();
+        while (static_cast<int>(round.size()) < maxChunks) {
+            Chunk chunk;
+            if (type == Type::Capture) {
+                const std::vector<CaptureReader::Block> &blocks = reader.blocks();
+                if (block >= blocks.size()) {
+                    break;
+                }
+                chunk.begin = blocks[block].firstRecordOffset;
+                while (block < blocks.size() && blocks[block].endOffset - chunk.begin < chunkSize) {
+                    block++;
+                }
+                chunk.end = blocks[qMin(block, blocks.size() - 1)].endOffset;
+                block = qMin(block + 1, blocks.size());
+            } else {
+                if (position >= inputSize) {
+                    break;
+                }
+                chunk.begin = position;
+                chunk.end = N2kLogFormat::nextRecord(type, data, inputSize, qMin(position + chunkSize, inputSize));
+                position = chunk.end;
+            }
+            round.push_back(std::move(chunk));
+        }
+        return !round.empty();
+    }
+
+    // Any thread
+    void parse(Chunk &chunk) const
+    {
+        const uint8_t *begin = type == Type::Capture ? nullptr : data + chunk.begin;
+        const size_t length = chunk.end - chunk.begin;
+        switch (type) {
+        case Type::Capture: {
+            CaptureReader::Record record;
+            uint64_t offset = chunk.begin;
+            while (offset < chunk.end && reader.next(offset, record)) {
+                chunk.entries.emplace_back();
+                Entry &entry = chunk.entries.back();
+                record.toMessage(entry.N2kMsg);
+                entry.timestampUs = record.timestampUs;
+                entry.transmitted = record.transmitted;
+            }
+            break;
+        }
+        case Type::ActisenseEbl:
+            chunk.skipped = N2kLogFormat::parseEbl(begin, length, chunk.entries, chunk.lastTimestampUs);
+            break;
+        case Type::Candump:
+            chunk.skipped = N2kLogFormat::parseCandump(begin, length, chunk.frames);
+            break;
+        case Type::CanboatText:
+            chunk.skipped = N2kLogFormat::parseCanboat(begin, length, chunk.entries);
+            break;
+        }
+    }
+
+    // Calling thread, chunks in log order: what depends on the records before
+    void order(std::vector<Chunk> &round)
+    {
+        for (Chunk &chunk : round) {
+            if (!chunk.frames.empty()) {
+                frames += chunk.frames.size();
+                Entry entry;
+                for (const N2kLogFormat::CanFrame &frame : chunk.frames) {
+                    const qint64 timestampUs = frame.timestampUs >= 0 ? frame.timestampUs : lastTimestampUs;
+                    if (assembler.addFrame(frame.frame.canId, frame.frame.len, frame.frame.data, timestampUs / 1000, entry.N2kMsg)) {
+                        entry.timestampUs = timestampUs;
+                        chunk.entries.push_back(entry);
+                    }
+                    lastTimestampUs = timestampUs;
+                }
+                chunk.frames = std::vector<N2kLogFormat::CanFrame>();
+            }
+            // Records before the first timestamp of a chunk belong to the last one of the chunk before
+            for (Entry &entry : chunk.entries) {
+                if (entry.timestampUs < 0) {
+                    entry.timestampUs = lastTimestampUs;
+                }
+                lastTimestampUs = entry.timestampUs;
+            }
+            if (chunk.lastTimestampUs >= 0) {
+                lastTimestampUs = chunk.lastTimestampUs;
+            }
+        }
+    }
+
+private:
+    Type type = Type::Capture;
+    size_t chunkSize = 0;
+    QFile file;
+    const uint8_t *data = nullptr;
+    size_t inputSize = 0;
+    size_t position = 0;
+    CaptureReader reader;
+    size_t block = 0;
+    N2kFrameAssembler assembler{256};
+    qint64 lastTimestampUs = 0;
+};
+
+class LogOutput
+{
+public:
+    quint64 frames = 0;
+
+    bool open(const QString &path, Type outputType, QString *error)
+    {
+        type = outputType;
+        if (type == Type::Capture) {
+            return capture.open(path, error);
+        }
+        file.setFileName(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            *error = "Unable to create " + path + ": " + file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    // Calling thread: fast packet sequence numbers run on per source and PGN across the whole log
+    void sequence(std::vector<Chunk> &round)
+    {
+        if (!N2kLogFormat::isFrameBased(type)) {
+            return;
+        }
+        for (Chunk &chunk : round) {
+            for (Entry &entry : chunk.entries) {
+                if (framer.isFastPacket(entry.N2kMsg.PGN)) {
+                    uint8_t &next = sequences[(uint32_t(entry.N2kMsg.Source) << 24) | entry.N2kMsg.PGN];
+                    entry.sequence = next;
+                    next = (next + 1) & 0x7;
+                }
+            }
+        }
+    }
+
+    // Any thread
+    void format(Chunk &chunk) const
+    {
+        const Entry *entries = chunk.entries.data();
+        const size_t count = chunk.entries.size();
+        switch (type) {
+        case Type::Capture:
+            break;
+        case Type::ActisenseEbl:
+            N2kLogFormat::writeEbl(entries, count, chunk.output);
+            break;
+        case Type::Candump:
+            chunk.framesWritten = N2kLogFormat::writeCandump(entries, count, framer, chunk.output);
+            break;
+        case Type::CanboatText:
+            N2kLogFormat::writeCanboat(entries, count, chunk.output);
+            break;
+        }
+    }
+
+    // Calling thread, chunks in log order
+    bool write(std::vector<Chunk> &round, QString *error)
+    {
+        for (Chunk &chunk : round) {
+            if (type == Type::Capture) {
+                for (const Entry &entry : chunk.entries) {
+                    capture.write(entry.N2kMsg, entry.timestampUs, entry.transmitted);
+                }
+                continue;
+            }
+            frames += chunk.framesWritten;
+            if (file.write(chunk.output) != chunk.output.size()) {
+                *error = "Unable to write " + file.fileName() + ": " + file.errorString();
+                return false;
+            }
+            bytes += static_cast<quint64>(chunk.output.size());
+        }
+        return true;
+    }
+
+    bool close(QString *error)
+    {
+        if (type == Type::Capture) {
+            capture.close();
+            bytes = capture.statistics().bytes;
+            if (capture.statistics().writeErrors > 0) {
+                *error = "Unable to write " + capture.fileName();
+                return false;
+            }
+            return true;
+        }
+        file.close();
+        return true;
+    }
+
+    quint64 size() const { return bytes; }
+
+private:
+    Type type = Type::Capture;
+    QFile file;
+    CaptureWriter capture;
+    N2kFrameAssembler framer{1};
+    std::unordered_map<uint32_t, uint8_t> sequences;
+    quint64 bytes = 0;
+};
+
+// Fields every format keeps. A PDU2 PGN has no destination on the bus, and EBL stores messages we
+// sent (0x94) without their source, so those are left out for the formats that lose them.
+uint64_t messageHash(const Entry &entry, Type type)
+{
+    const tN2kMsg &N2kMsg = entry.N2kMsg;
+    const bool pdu1 = ((N2kMsg.PGN >> 8) & 0xFF) < 240;
+    const bool sourceKept = !(entry.transmitted && type == Type::ActisenseEbl);
+    uint8_t fields[7] = {static_cast<uint8_t>(N2kMsg.PGN), static_cast<uint8_t>(N2kMsg.PGN >> 8),
+                         static_cast<uint8_t>(N2kMsg.PGN >> 16), N2kMsg.Priority,
+                         static_cast<uint8_t>(sourceKept ? N2kMsg.Source : 0),
+                         static_cast<uint8_t>(pdu1 ? N2kMsg.Destination : 0xFF), static_cast<uint8_t>(N2kMsg.DataLen)};
+
+    // FNV-1a over the fields and the payload, then a 64 bit finalizer to spread it
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto add = [&hash](const uint8_t *bytes, int length) {
+        for (int i = 0; i < length; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+        }
+    };
+    add(fields, sizeof(fields));
+    add(N2kMsg.Data, N2kMsg.DataLen);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+template<typename Function>
+void forEachChunk(std::vector<Chunk> &round, bool parallel, Function function)
+{
+    if (parallel && round.size() > 1) {
+        QtConcurrent::blockingMap(round, function);
+    } else {
+        for (Chunk &chunk : round) {
+            function(chunk);
+        }
+    }
+}
+
+// digestType is the format whose limits the digest follows: the output's, also when reading it back
+N2kLogConverter::Result run(const QString &inputPath, Type inputType, LogOutput *output, Type digestType,
+                            const N2kLogConverter::Options &options)
+{
+    N2kLogConverter::Result result;
+    QElapsedTimer timer;
+    timer.start();
+
+    LogInput input;
+    if (!input.open(inputPath, inputType, options.chunkBytes, &result.error)) {
+        return result;
+    }
+    result.inputBytes = input.size();
+
+    const int threads = options.threads > 0 ? options.threads : QThread::idealThreadCount();
+    const bool parallel = threads > 1;
+    // A couple of chunks per thread keeps every core busy while the slowest chunk finishes
+    const int chunksPerRound = qMax(1, threads * 2);
+
+    std::vector<Chunk> round;
+    while (input.nextRound(round, chunksPerRound)) {
+        forEachChunk(round, parallel, [&input](Chunk &chunk) { input.parse(chunk); });
+        input.order(round);
+        for (const Chunk &chunk : round) {
+            result.messages += chunk.entries.size();
+            result.skipped += chunk.skipped;
+            for (const Entry &entry : chunk.entries) {
+                result.digest = result.digest * 0x9E3779B97F4A7C15ULL + messageHash(entry, digestType);
+            }
+        }
+        if (!output) {
+            continue;
+        }
+        output->sequence(round);
+        forEachChunk(round, parallel, [output](Chunk &chunk) { output->format(chunk); });
+        if (!output->write(round, &result.error)) {
+            return result;
+        }
+    }
+
+    result.frames = input.frames;
+    if (output) {
+        if (!output->close(&result.error)) {
+            return result;
+        }
+        result.outputBytes = output->size();
+        result.frames += output->frames;
+    }
+    result.elapsedUs = timer.nsecsElapsed() / 1000;
+    result.ok = true;
+    return result;
+}
+
+}
+
+N2kLogConverter::Result N2kLogConverter::convert(const QString &inputPath, Type inputType,
+                                                 const QString &outputPath, Type outputType, const Options &options)
+{
+    LogOutput output;
+    Result result;
+    if (!output.open(outputPath, outputType, &result.error)) {
+        return result;
+    }
+    result = run(inputPath, inputType, &output, outputType, options);
+    if (!result.ok || !options.verify) {
+        return result;
+    }
+
+    Result readBack = count(outputPath, outputType, options);
+    result.verifiedMessages = readBack.messages;
+    if (!readBack.ok) {
+        result.ok = false;
+        result.error = readBack.error;
+    } else if (readBack.messages != result.messages || readBack.skipped != 0) {
+        result.ok = false;
+        result.error = QString("Round trip mismatch: wrote %1 messages, read back %2 (%3 skipped)")
+                           .arg(result.messages).arg(readBack.messages).arg(readBack.skipped);
+    } else if (readBack.digest != result.digest) {
+        result.ok = false;
+        result.error = QString("Round trip mismatch: the %1 messages read back differ from those written").arg(result.messages);
+    }
+    return result;
+}
+
+N2kLogConverter::Result N2kLogConverter::count(const QString &path, Type type, const Options &options)
+{
+    return run(path, type, nullptr, type, options);
+}
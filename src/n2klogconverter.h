@@ -0,0 +1,45 @@
+#ifndef N2KLOGCONVERTER_H
+#define N2KLOGCONVERTER_H
+
+#include <QString>
+#include "n2klogformat.h"
+
+// Converts between captures and the field log formats of N2kLogFormat. The input is memory mapped
+// and cut into chunks on record boundaries (index blocks for captures); a round of chunks is parsed
+// on all cores, the steps that need the order of the log (fast packet reassembly, carrying EBL
+// timestamps forward, fast packet sequence numbers) run over the round in one pass, and the chunks
+// are then formatted in parallel and written in order. With verify set, the output is read back
+// through the same pipeline and both its message count and a digest of the messages (PGN, priority,
+// source, destination and payload, in order) are compared with what was written.
+class N2kLogConverter
+{
+public:
+    struct Options {
+        int threads = 0;                // 0 uses QThread::idealThreadCount, 1 stays on the calling thread
+        int chunkBytes = 4 << 20;
+        bool verify = true;
+    };
+
+    struct Result {
+        bool ok = false;
+        QString error;
+        quint64 inputBytes = 0;
+        quint64 outputBytes = 0;
+        quint64 messages = 0;           // Written to the output
+        quint64 frames = 0;             // CAN frames read or written by frame based formats
+        quint64 skipped = 0;            // Records that could not be read or were not N2K messages
+        quint64 verifiedMessages = 0;   // Read back from the output
+        quint64 digest = 0;             // Of the messages read, or written by convert
+        qint64 elapsedUs = 0;           // Conversion only, without the verification
+
+        double megabytesPerSecond() const { return elapsedUs > 0 ? inputBytes / (elapsedUs / 1e6) / 1e6 : 0.0; }
+    };
+
+    static Result convert(const QString &inputPath, N2kLogFormat::Type inputType,
+                          const QString &outputPath, N2kLogFormat::Type outputType, const Options &options);
+    // Reads a log through the pipeline without writing anything; messages, frames, skipped and digest
+    // are filled in
+    static Result count(const QString &path, N2kLogFormat::Type type, const Options &options);
+};
+
+#endif // N2KLOGCONVERTER_H
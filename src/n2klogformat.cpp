@@ -0,0 +1,587 @@
+#include "n2klogformat.h"
+#include <QFile>
+#include <QFileInfo>
+#include <cstring>
+#include "captureformat.h"
+#include "nmea2000_actisense.h"
+
+namespace {
+
+// Microseconds between the Windows file time epoch (1601) and the Unix epoch
+constexpr qint64 FileTimeOffsetUs = 11644473600000000LL;
+constexpr qint64 UsPerDay = 86400000000LL;
+
+const char HexDigits[] = "0123456789abcdef";
+const char UpperHexDigits[] = "0123456789ABCDEF";
+
+inline int hexValue(uint8_t c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// Line reading helpers: p moves forward, false when the expected text is not there
+bool readDecimal(const uint8_t *&p, const uint8_t *end, qint64 &value, int maxDigits = 18)
+{
+    const uint8_t *start = p;
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9' && p - start < maxDigits) {
+        value = value * 10 + (*p++ - '0');
+    }
+    return p > start;
+}
+
+bool readHex(const uint8_t *&p, const uint8_t *end, unsigned long &value, int &digits)
+{
+    value = 0;
+    digits = 0;
+    int v;
+    while (p < end && digits < 8 && (v = hexValue(*p)) >= 0) {
+        value = (value << 4) | static_cast<unsigned long>(v);
+        p++;
+        digits++;
+    }
+    return digits > 0;
+}
+
+bool expect(const uint8_t *&p, const uint8_t *end, char c)
+{
+    if (p < end && *p == static_cast<uint8_t>(c)) {
+        p++;
+        return true;
+    }
+    return false;
+}
+
+void skipSpaces(const uint8_t *&p, const uint8_t *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+}
+
+// Next line of [pos, size) without the line break; pos moves past it
+bool nextLine(const uint8_t *data, size_t size, size_t &pos, const uint8_t *&begin, const uint8_t *&end)
+{
+    if (pos >= size) {
+        return false;
+    }
+    begin = data + pos;
+    const void *eol = memchr(begin, '\n', size - pos);
+    end = eol ? static_cast<const uint8_t *>(eol) : data + size;
+    pos = static_cast<size_t>(end - data) + (eol ? 1 : 0);
+    if (end > begin && end[-1] == '\r') {
+        end--;
+    }
+    return true;
+}
+
+// Proleptic Gregorian calendar conversions, days relative to 1970-01-01
+qint64 daysFromCivil(qint64 y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const qint64 era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<qint64>(doe) - 719468;
+}
+
+void civilFromDays(qint64 z, int &y, unsigned &m, unsigned &d)
+{
+    z += 719468;
+    const qint64 era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int>(static_cast<qint64>(yoe) + era * 400 + (m <= 2));
+}
+
+// "2011-11-24-22:42:04.388", also with 'T' or ' ' before the time and a trailing 'Z'
+bool readCanboatTime(const uint8_t *&p, const uint8_t *end, qint64 &timestampUs)
+{
+    qint64 year, month, day, hour, minute, second;
+    if (!readDecimal(p, end, year, 4) || !expect(p, end, '-') || !readDecimal(p, end, month, 2) || !expect(p, end, '-')
+        || !readDecimal(p, end, day, 2) || p >= end || (*p != '-' && *p != 'T' && *p != ' ')) {
+        return false;
+    }
+    p++;
+    if (!readDecimal(p, end, hour, 2) || !expect(p, end, ':') || !readDecimal(p, end, minute, 2) || !expect(p, end, ':')
+        || !readDecimal(p, end, second, 2)) {
+        return false;
+    }
+    qint64 fractionUs = 0;
+    if (expect(p, end, '.')) {
+        qint64 scale = 100000;
+        while (p < end && *p >= '0' && *p <= '9') {
+            fractionUs += (*p++ - '0') * scale;
+            scale /= 10;
+        }
+    }
+    expect(p, end, 'Z');
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+    timestampUs = daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * UsPerDay
+                  + ((hour * 60 + minute) * 60 + second) * 1000000 + fractionUs;
+    return true;
+}
+
+inline char *putHexByte(char *out, uint8_t value)
+{
+    *out++ = HexDigits[value >> 4];
+    *out++ = HexDigits[value & 0xF];
+    return out;
+}
+
+inline char *putDecimal(char *out, unsigned long value, int minDigits = 1)
+{
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0 || count < minDigits);
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+}
+
+bool N2kLogFormat::typeFromName(const QString &name, Type &type)
+{
+    const QString lower = name.toLower();
+    if (lower == "capture") {
+        type = Type::Capture;
+    } else if (lower == "ebl") {
+        type = Type::ActisenseEbl;
+    } else if (lower == "candump") {
+        type = Type::Candump;
+    } else if (lower == "canboat") {
+        type = Type::CanboatText;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString N2kLogFormat::typeName(Type type)
+{
+    switch (type) {
+    case Type::Capture:
+        return "capture";
+    case Type::ActisenseEbl:
+        return "ebl";
+    case Type::Candump:
+        return "candump";
+    case Type::CanboatText:
+        return "canboat";
+    }
+    return QString();
+}
+
+bool N2kLogFormat::typeForFile(const QString &path, Type &type)
+{
+    QFile file(path);
+    char magic[sizeof(CaptureFormat::Magic)];
+    if (file.open(QIODevice::ReadOnly) && file.read(magic, sizeof(magic)) == sizeof(magic)
+        && memcmp(magic, CaptureFormat::Magic, sizeof(magic)) == 0) {
+        type = Type::Capture;
+        return true;
+    }
+
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "ebl") {
+        type = Type::ActisenseEbl;
+    } else if (suffix == "log" || suffix == "candump") {
+        type = Type::Candump;
+    } else if (suffix == "txt" || suffix == "csv" || suffix == "n2k") {
+        type = Type::CanboatText;
+    } else if (suffix == "rnscap" || suffix == "cap") {
+        type = Type::Capture;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+size_t N2kLogFormat::nextRecord(Type type, const uint8_t *data, size_t size, size_t offset)
+{
+    if (offset == 0 || offset >= size) {
+        return qMin(offset, size);
+    }
+
+    if (type != Type::ActisenseEbl) {
+        // Text formats: the line after the one offset falls into
+        const void *eol = memchr(data + offset - 1, '\n', size - offset + 1);
+        return eol ? static_cast<size_t>(static_cast<const uint8_t *>(eol) - data) + 1 : size;
+    }
+
+    // ESC SOH starts a record unless its ESC is the second half of an escaped ESC, which an odd
+    // run of ESC bytes before it gives away
+    for (size_t i = offset; i + 1 < size; i++) {
+        if (data[i] != EblEscape || data[i + 1] != EblStart) {
+            continue;
+        }
+        size_t run = 0;
+        while (run < i && data[i - run - 1] == EblEscape) {
+            run++;
+        }
+        if (run % 2 == 0) {
+            return i;
+        }
+    }
+    return size;
+}
+
+quint64 N2kLogFormat::parseEbl(const uint8_t *data, size_t size, std::vector<Entry> &entries, qint64 &lastTimestampUs)
+{
+    quint64 bad = 0;
+    qint64 &timestampUs = lastTimestampUs;
+    timestampUs = -1;
+    uint8_t record[NMEA2000_Actisense::MaxBodyLen + 16];
+    size_t i = 0;
+
+    while (i + 1 < size) {
+        if (data[i] != EblEscape || data[i + 1] != EblStart) {
+            i++;
+            continue;
+        }
+        i += 2;
+
+        // Unescape up to ESC LF; runs without ESC are copied in one go
+        int length = 0;
+        bool complete = false;
+        bool valid = true;
+        while (i < size) {
+            const void *escape = memchr(data + i, EblEscape, size - i);
+            size_t run = (escape ? static_cast<size_t>(static_cast<const uint8_t *>(escape) - data) : size) - i;
+            if (length + run > sizeof(record)) {
+                valid = false;
+                run = qMin(run, sizeof(record) - length);
+            }
+            memcpy(record + length, data + i, run);
+            length += static_cast<int>(run);
+            i = escape ? static_cast<size_t>(static_cast<const uint8_t *>(escape) - data) + 1 : size;
+            if (!escape || i >= size) {
+                break;
+            }
+            const uint8_t next = data[i];
+            if (next == EblEscape && length < static_cast<int>(sizeof(record))) {
+                record[length++] = EblEscape;
+                i++;
+            } else if (next == EblEnd) {
+                i++;
+                complete = true;
+                break;
+            } else {
+                // Anything else, including the start of the next record, ends this one unfinished
+                i--;
+                break;
+            }
+        }
+        if (!complete || !valid || length < 1) {
+            bad++;
+            continue;
+        }
+
+        if (record[0] == EblTimestamp && length == 9) {
+            uint64_t fileTime = 0;
+            for (int b = 8; b >= 1; b--) {
+                fileTime = (fileTime << 8) | record[b];
+            }
+            timestampUs = static_cast<qint64>(fileTime / 10) - FileTimeOffsetUs;
+            continue;
+        }
+        if (!NMEA2000_Actisense::isN2kBody(record[0]) || length < 2) {
+            bad++;
+            continue;
+        }
+        entries.emplace_back();
+        Entry &entry = entries.back();
+        if (!NMEA2000_Actisense::decodeMessage(record, length, entry.N2kMsg)) {
+            entries.pop_back();
+            bad++;
+            continue;
+        }
+        entry.timestampUs = timestampUs;
+        entry.transmitted = NMEA2000_Actisense::isSentBody(record[0]);
+    }
+    return bad;
+}
+
+void N2kLogFormat::writeEbl(const Entry *entries, size_t count, QByteArray &out)
+{
+    uint8_t body[NMEA2000_Actisense::MaxBodyLen + 16];
+    qint64 lastTimestampUs = -1;
+
+    auto writeRecord = [&out](const uint8_t *record, int length) {
+        char escaped[2 * sizeof(body) + 4];
+        int pos = 0;
+        escaped[pos++] = EblEscape;
+        escaped[pos++] = EblStart;
+        for (int i = 0; i < length; i++) {
+            escaped[pos++] = static_cast<char>(record[i]);
+            if (record[i] == EblEscape) {
+                escaped[pos++] = EblEscape;
+            }
+        }
+        escaped[pos++] = EblEscape;
+        escaped[pos++] = EblEnd;
+        out.append(escaped, pos);
+    };
+
+    for (size_t i = 0; i < count; i++) {
+        const Entry &entry = entries[i];
+        const qint64 timestampUs = qMax<qint64>(0, entry.timestampUs);
+        // Each chunk opens with a timestamp so it does not depend on the one before
+        if (i == 0 || timestampUs != lastTimestampUs) {
+            const uint64_t fileTime = static_cast<uint64_t>(timestampUs + FileTimeOffsetUs) * 10;
+            body[0] = EblTimestamp;
+            for (int b = 0; b < 8; b++) {
+                body[1 + b] = static_cast<uint8_t>(fileTime >> (8 * b));
+            }
+            writeRecord(body, 9);
+            lastTimestampUs = timestampUs;
+        }
+        int length = NMEA2000_Actisense::encodeBody(entry.N2kMsg, !entry.transmitted,
+                                                    static_cast<uint32_t>(timestampUs / 1000), body, sizeof(body));
+        if (length > 0) {
+            writeRecord(body, length);
+        }
+    }
+}
+
+quint64 N2kLogFormat::parseCanboat(const uint8_t *data, size_t size, std::vector<Entry> &entries)
+{
+    quint64 bad = 0;
+    size_t pos = 0;
+    const uint8_t *p, *end;
+
+    while (nextLine(data, size, pos, p, end)) {
+        skipSpaces(p, end);
+        if (p == end || *p == '#') {
+            continue;
+        }
+
+        qint64 timestampUs, priority, PGN, source, destination, length;
+        if (!readCanboatTime(p, end, timestampUs) || !expect(p, end, ',')
+            || !readDecimal(p, end, priority, 2) || !expect(p, end, ',')
+            || !readDecimal(p, end, PGN, 7) || !expect(p, end, ',')
+            || !readDecimal(p, end, source, 3) || !expect(p, end, ',')
+            || !readDecimal(p, end, destination, 3) || !expect(p, end, ',')
+            || !readDecimal(p, end, length, 3) || length > tN2kMsg::MaxDataLen || priority > 7 || PGN > 0x3FFFF
+            || source > 255 || destination > 255) {
+            bad++;
+            continue;
+        }
+
+        entries.emplace_back();
+        Entry &entry = entries.back();
+        tN2kMsg &N2kMsg = entry.N2kMsg;
+        N2kMsg.Clear();
+        N2kMsg.SetPGN(static_cast<unsigned long>(PGN));
+        N2kMsg.Priority = static_cast<unsigned char>(priority);
+        N2kMsg.Source = static_cast<unsigned char>(source);
+        N2kMsg.Destination = static_cast<unsigned char>(destination);
+        N2kMsg.DataLen = static_cast<int>(length);
+        entry.timestampUs = timestampUs;
+
+        bool valid = true;
+        for (int i = 0; i < N2kMsg.DataLen && valid; i++) {
+            int high, low;
+            valid = expect(p, end, ',') && p + 1 < end && (high = hexValue(p[0])) >= 0 && (low = hexValue(p[1])) >= 0;
+            if (valid) {
+                N2kMsg.Data[i] = static_cast<unsigned char>((high << 4) | low);
+                p += 2;
+            }
+        }
+        if (!valid) {
+            entries.pop_back();
+            bad++;
+        }
+    }
+    return bad;
+}
+
+void N2kLogFormat::writeCanboat(const Entry *entries, size_t count, QByteArray &out)
+{
+    // Timestamp, five numbers and up to 223 ",xx"
+    char line[32 + 5 * 8 + 3 * tN2kMsg::MaxDataLen];
+    qint64 lastDay = -1;
+    int year = 1970;
+    unsigned month = 1, day = 1;
+
+    for (size_t i = 0; i < count; i++) {
+        const Entry &entry = entries[i];
+        const tN2kMsg &N2kMsg = entry.N2kMsg;
+        const qint64 timestampUs = qMax<qint64>(0, entry.timestampUs);
+        const qint64 days = timestampUs / UsPerDay;
+        if (days != lastDay) {
+            civilFromDays(days, year, month, day);
+            lastDay = days;
+        }
+        const qint64 msOfDay = (timestampUs % UsPerDay) / 1000;
+
+        char *p = line;
+        p = putDecimal(p, static_cast<unsigned long>(year), 4);
+        *p++ = '-';
+        p = putDecimal(p, month, 2);
+        *p++ = '-';
+        p = putDecimal(p, day, 2);
+        *p++ = '-';
+        p = putDecimal(p, static_cast<unsigned long>(msOfDay / 3600000), 2);
+        *p++ = ':';
+        p = putDecimal(p, static_cast<unsigned long>(msOfDay / 60000 % 60), 2);
+        *p++ = ':';
+        p = putDecimal(p, static_cast<unsigned long>(msOfDay / 1000 % 60), 2);
+        *p++ = '.';
+        p = putDecimal(p, static_cast<unsigned long>(msOfDay % 1000), 3);
+        for (unsigned long value : {static_cast<unsigned long>(N2kMsg.Priority), N2kMsg.PGN, static_cast<unsigned long>(N2kMsg.Source),
+                                    static_cast<unsigned long>(N2kMsg.Destination), static_cast<unsigned long>(N2kMsg.DataLen)}) {
+            *p++ = ',';
+            p = putDecimal(p, value);
+        }
+        for (int b = 0; b < N2kMsg.DataLen; b++) {
+            *p++ = ',';
+            p = putHexByte(p, N2kMsg.Data[b]);
+        }
+        *p++ = '\n';
+        out.append(line, static_cast<int>(p - line));
+    }
+}
+
+quint64 N2kLogFormat::parseCandump(const uint8_t *data, size_t size, std::vector<CanFrame> &frames)
+{
+    quint64 bad = 0;
+    size_t pos = 0;
+    const uint8_t *p, *end;
+
+    while (nextLine(data, size, pos, p, end)) {
+        skipSpaces(p, end);
+        if (p == end || *p == '#') {
+            continue;
+        }
+
+        CanFrame frame;
+        frame.timestampUs = -1;
+        if (expect(p, end, '(')) {
+            qint64 seconds, fraction = 0;
+            if (!readDecimal(p, end, seconds) || !expect(p, end, '.')) {
+                bad++;
+                continue;
+            }
+            const uint8_t *fractionStart = p;
+            readDecimal(p, end, fraction, 6);
+            for (qint64 digits = p - fractionStart; digits < 6; digits++) {
+                fraction *= 10;
+            }
+            while (p < end && *p >= '0' && *p <= '9') {
+                p++;
+            }
+            if (!expect(p, end, ')')) {
+                bad++;
+                continue;
+            }
+            frame.timestampUs = seconds * 1000000 + fraction;
+            skipSpaces(p, end);
+        }
+
+        // Interface name, then the identifier; NMEA2000 only uses 29 bit identifiers (8 digits)
+        while (p < end && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        skipSpaces(p, end);
+        unsigned long id;
+        int digits;
+        if (!readHex(p, end, id, digits) || digits != 8) {
+            bad++;
+            continue;
+        }
+        frame.frame.canId = id & 0x1FFFFFFFUL;
+
+        int len = 0;
+        bool valid = true;
+        if (expect(p, end, '#')) {
+            // candump -l: bytes run together after '#'
+            int high, low;
+            while (p + 1 < end && len < 8 && (high = hexValue(p[0])) >= 0 && (low = hexValue(p[1])) >= 0) {
+                frame.frame.data[len++] = static_cast<unsigned char>((high << 4) | low);
+                p += 2;
+            }
+            valid = p == end || *p == ' ' || *p == '\t';
+        } else {
+            // Plain candump: "[len]" and space separated bytes
+            qint64 count;
+            skipSpaces(p, end);
+            valid = expect(p, end, '[') && readDecimal(p, end, count, 1) && expect(p, end, ']') && count <= 8;
+            for (int i = 0; valid && i < count; i++) {
+                int high, low;
+                skipSpaces(p, end);
+                valid = p + 1 < end && (high = hexValue(p[0])) >= 0 && (low = hexValue(p[1])) >= 0;
+                if (valid) {
+                    frame.frame.data[len++] = static_cast<unsigned char>((high << 4) | low);
+                    p += 2;
+                }
+            }
+        }
+        if (!valid) {
+            bad++;
+            continue;
+        }
+        frame.frame.len = static_cast<unsigned char>(len);
+        frames.push_back(frame);
+    }
+    return bad;
+}
+
+quint64 N2kLogFormat::writeCandump(const Entry *entries, size_t count, const N2kFrameAssembler &framer, QByteArray &out)
+{
+    N2kFrameAssembler::Frame frames[N2kFrameAssembler::MaxFrames];
+    // "(seconds.micros) can0 XXXXXXXX#" and 16 digits
+    char line[64];
+    quint64 written = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const Entry &entry = entries[i];
+        const qint64 timestampUs = qMax<qint64>(0, entry.timestampUs);
+        const int frameCount = framer.fragment(entry.N2kMsg, entry.sequence, frames, true);
+
+        char prefix[40];
+        char *p = prefix;
+        *p++ = '(';
+        p = putDecimal(p, static_cast<unsigned long>(timestampUs / 1000000));
+        *p++ = '.';
+        p = putDecimal(p, static_cast<unsigned long>(timestampUs % 1000000), 6);
+        memcpy(p, ") can0 ", 7);
+        p += 7;
+        const int prefixLen = static_cast<int>(p - prefix);
+
+        for (int f = 0; f < frameCount; f++) {
+            const N2kFrameAssembler::Frame &frame = frames[f];
+            memcpy(line, prefix, prefixLen);
+            p = line + prefixLen;
+            for (int shift = 28; shift >= 0; shift -= 4) {
+                *p++ = UpperHexDigits[(frame.canId >> shift) & 0xF];
+            }
+            *p++ = '#';
+            for (int b = 0; b < frame.len; b++) {
+                const uint8_t value = frame.data[b];
+                *p++ = UpperHexDigits[value >> 4];
+                *p++ = UpperHexDigits[value & 0xF];
+            }
+            *p++ = '\n';
+            out.append(line, static_cast<int>(p - line));
+        }
+        written += static_cast<quint64>(frameCount);
+    }
+    return written;
+}
@@ -0,0 +1,67 @@
+#ifndef N2KLOGFORMAT_H
+#define N2KLOGFORMAT_H
+
+#include <QByteArray>
+#include <QString>
+#include <cstdint>
+#include <vector>
+#include "N2kMsg.h"
+#include "n2kframeassembler.h"
+
+// Field log formats besides our own captures, read and written in chunks that start on a record
+// boundary so several threads can work on one file:
+//
+//   ActisenseEbl   Binary log of the Actisense tools: records ESC SOH <type> <payload> ESC LF, with
+//                  ESC (0x1B) doubled inside. Type 0x03 is a timestamp (64 bit Windows file time)
+//                  for the records that follow; 0x93 and 0x94 records hold the BST N2K message
+//                  without escaping or checksum, decoded by NMEA2000_Actisense::decodeMessage.
+//   Candump        SocketCAN candump, raw 29 bit frames: "(1436509052.249713) can0 09F80102#01FF..." as
+//                  written by candump -l, and the columns of plain candump ("can0  09F80102   [8]  01 FF ...").
+//   CanboatText    CANboat plain text, one message per line:
+//                  "2011-11-24-22:42:04.388,2,127251,36,255,8,7d,0b,7d,02,00,ff,ff,ff"
+class N2kLogFormat
+{
+public:
+    enum class Type { Capture, ActisenseEbl, Candump, CanboatText };
+
+    struct Entry {
+        qint64 timestampUs = -1;    // UTC microseconds, -1 when the log has none for this record
+        bool transmitted = false;
+        unsigned char sequence = 0; // Fast packet sequence used when the entry is written as frames
+        tN2kMsg N2kMsg;
+    };
+
+    struct CanFrame {
+        qint64 timestampUs;
+        N2kFrameAssembler::Frame frame;
+    };
+
+    // Captures by their magic, the others by extension: .ebl, .log/.candump, .txt/.csv/.n2k
+    static bool typeForFile(const QString &path, Type &type);
+    static bool typeFromName(const QString &name, Type &type);
+    static QString typeName(Type type);
+    // Whether entries go through CAN frames, which need reassembly on read and fragmenting on write
+    static bool isFrameBased(Type type) { return type == Type::Candump; }
+
+    // Offset of the first record starting at or after offset, size if there is none
+    static size_t nextRecord(Type type, const uint8_t *data, size_t size, size_t offset);
+
+    // Parse one chunk, return the number of records that could not be read. EBL timestamps apply to
+    // the records after them, so the last one of the chunk is handed back for the next (-1 if none).
+    static quint64 parseEbl(const uint8_t *data, size_t size, std::vector<Entry> &entries, qint64 &lastTimestampUs);
+    static quint64 parseCanboat(const uint8_t *data, size_t size, std::vector<Entry> &entries);
+    static quint64 parseCandump(const uint8_t *data, size_t size, std::vector<CanFrame> &frames);
+
+    // Append entries; every chunk is self contained so chunks can be written in parallel
+    static void writeEbl(const Entry *entries, size_t count, QByteArray &out);
+    static void writeCanboat(const Entry *entries, size_t count, QByteArray &out);
+    static quint64 writeCandump(const Entry *entries, size_t count, const N2kFrameAssembler &framer, QByteArray &out);
+
+private:
+    static constexpr uint8_t EblEscape = 0x1B;
+    static constexpr uint8_t EblStart = 0x01;
+    static constexpr uint8_t EblEnd = 0x0A;
+    static constexpr uint8_t EblTimestamp = 0x03;
+};
+
+#endif // N2KLOGFORMAT_H
@@ -0,0 +1,29 @@
+#ifndef N2KTRANSPORT_H
+#define N2KTRANSPORT_H
+
+#include <QObject>
+#include "N2kMsg.h"
+
+// What ActisenseLink drives on its I/O thread: the NGT-1 over a serial port (NMEA2000_Actisense) or a
+// CAN interface through SocketCAN (SocketCanTransport). Sending only queues, each transport decides
+// when its batch goes out; received messages come back in batches through nmea2000MessagesReceived.
+class N2kTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    using QObject::QObject;
+
+    // False if the message was not queued (backlog full, not open)
+    virtual bool SendMessage(const tN2kMsg &N2kMsg) = 0;
+    virtual bool SendMessages(const tN2kMsg *N2kMsgs, int count) = 0;
+    // Writes whatever is still queued, called before the transport is closed
+    virtual void Flush() = 0;
+
+signals:
+    // All messages decoded from one read pass. The span is only valid during the emission,
+    // so connect directly and copy what you keep.
+    void nmea2000MessagesReceived(const tN2kMsg *N2kMsgs, int count);
+};
+
+#endif // N2KTRANSPORT_H
@@ -0,0 +1,264 @@
+#include "navigationn2kbridge.h"
+#include <QDateTime>
+#include <QtMath>
+#include <cmath>
+#include "N2kMessages.h"
+#include "autopilotsimulator.h"
+#include "pgnscheduler.h"
+
+namespace {
+
+constexpr qint64 MsPerDay = 24 * 3600 * 1000LL;
+
+double normalizedBearing(double radians)
+{
+    radians = std::fmod(radians, 2.0 * M_PI);
+    return radians < 0.0 ? radians + 2.0 * M_PI : radians;
+}
+
+}
+
+quint64 NavigationN2kBridge::Statistics::totalGenerated() const
+{
+    quint64 total = 0;
+    for (quint64 count : generated) {
+        total += count;
+    }
+    return total;
+}
+
+quint64 NavigationN2kBridge::Statistics::totalEncoded() const
+{
+    quint64 total = 0;
+    for (quint64 count : encoded) {
+        total += count;
+    }
+    return total;
+}
+
+NavigationN2kBridge::NavigationN2kBridge(AutoPilotSimulator &autoPilot, PgnScheduler &scheduler)
+    : autoPilot(autoPilot)
+    , scheduler(scheduler)
+    , epochMs(QDateTime::currentMSecsSinceEpoch())
+    , routeName("Route")
+{
+    messages[PositionRapid].fields = NavigationState::Position;
+    messages[CogSogRapid].fields = NavigationState::Course | NavigationState::Speed;
+    // Carries the time of day, so it is encoded on every transmission
+    messages[GnssPosition].fields = NavigationState::AllFields;
+    messages[VesselHeading].fields = NavigationState::Course;
+    messages[CrossTrackError].fields = NavigationState::CrossTrack | NavigationState::Running;
+    messages[NavigationData].fields = NavigationState::Waypoint | NavigationState::WaypointProgress;
+    messages[RouteInformation].fields = NavigationState::Waypoint;
+
+    setPeriods(Periods());
+
+    // Streams exist for the bridge's lifetime and are only enabled while it runs
+    for (int message = 0; message < MessageCount; ++message) {
+        PgnScheduler::StreamOptions options;
+        options.periodMs = messages[message].periodMs > 0 ? messages[message].periodMs : 1000;
+        Message id = static_cast<Message>(message);
+        messages[message].stream = scheduler.registerStream(pgn(id), options, [this, id](tN2kMsg &N2kMsg) {
+            return generate(id, N2kMsg);
+        });
+        scheduler.setStreamEnabled(messages[message].stream, false);
+    }
+}
+
+NavigationN2kBridge::~NavigationN2kBridge()
+{
+    for (Slot &slot : messages) {
+        scheduler.unregisterStream(slot.stream);
+    }
+}
+
+unsigned long NavigationN2kBridge::pgn(Message message)
+{
+    switch (message) {
+    case PositionRapid:
+        return 129025L;
+    case CogSogRapid:
+        return 129026L;
+    case GnssPosition:
+        return 129029L;
+    case VesselHeading:
+        return 127250L;
+    case CrossTrackError:
+        return 129283L;
+    case NavigationData:
+        return 129284L;
+    case RouteInformation:
+        return 129285L;
+    default:
+        return 0;
+    }
+}
+
+void NavigationN2kBridge::setPeriods(const Periods &periods)
+{
+    setPeriod(PositionRapid, periods.positionMs);
+    setPeriod(CogSogRapid, periods.cogSogMs);
+    setPeriod(GnssPosition, periods.gnssMs);
+    setPeriod(VesselHeading, periods.headingMs);
+    setPeriod(CrossTrackError, periods.crossTrackMs);
+    setPeriod(NavigationData, periods.navigationMs);
+    setPeriod(RouteInformation, periods.routeMs);
+}
+
+void NavigationN2kBridge::setPeriod(Message message, int periodMs)
+{
+    if (message < 0 || message >= MessageCount) {
+        return;
+    }
+    messages[message].periodMs = qMax(0, periodMs);
+    applyPeriod(message);
+}
+
+void NavigationN2kBridge::setRouteName(const QString &name)
+{
+    routeName = name.toUtf8();
+    messages[RouteInformation].encodedSequence = 0;
+}
+
+void NavigationN2kBridge::start()
+{
+    running = true;
+    for (Slot &slot : messages) {
+        slot.encodedSequence = 0;
+    }
+    for (int message = 0; message < MessageCount; ++message) {
+        applyPeriod(static_cast<Message>(message));
+    }
+}
+
+void NavigationN2kBridge::stop()
+{
+    running = false;
+    for (Slot &slot : messages) {
+        scheduler.setStreamEnabled(slot.stream, false);
+    }
+}
+
+void NavigationN2kBridge::applyPeriod(Message message)
+{
+    const Slot &slot = messages[message];
+    if (slot.stream < 0) {
+        return;
+    }
+    if (slot.periodMs > 0) {
+        scheduler.setStreamPeriod(slot.stream, slot.periodMs);
+    }
+    scheduler.setStreamEnabled(slot.stream, running && slot.periodMs > 0);
+}
+
+bool NavigationN2kBridge::generate(Message message, tN2kMsg &N2kMsg)
+{
+    NavigationState state = autoPilot.navigationState();
+    if (!state.hasPosition()) {
+        return false;
+    }
+
+    Slot &slot = messages[message];
+    bool fresh = slot.encodedSequence == 0 || message == GnssPosition
+                 || (state.changedSince(slot.encodedSequence) & slot.fields) != 0;
+    if (fresh) {
+        if (!encode(message, state, slot.cached)) {
+            return false;
+        }
+        slot.encodedSequence = state.sequence;
+        stats.encoded[message]++;
+    }
+    N2kMsg = slot.cached;
+    stats.generated[message]++;
+    return true;
+}
+
+bool NavigationN2kBridge::encode(Message message, const NavigationState &state, tN2kMsg &N2kMsg) const
+{
+    // Messages encoded from the same snapshot share its sequence identifier
+    unsigned char SID = static_cast<unsigned char>(state.sequence % 253);
+    N2kMsg.Clear();
+
+    switch (message) {
+    case PositionRapid:
+        SetN2kPGN129025(N2kMsg, state.latitude, state.longitude);
+        return true;
+
+    case CogSogRapid:
+        SetN2kPGN129026(N2kMsg, SID, N2khr_true, state.courseRadians, state.speed);
+        return true;
+
+    case GnssPosition: {
+        uint16_t days;
+        double seconds;
+        dateAndTime(autoPilot.getClock()->nowMs(), days, seconds);
+        SetN2kPGN129029(N2kMsg, SID, days, seconds, state.latitude, state.longitude, 0.0,
+                        N2kGNSSt_GPS, N2kGNSSm_GNSSfix, 12, 0.8, 1.5, 0.0);
+        return true;
+    }
+
+    case VesselHeading:
+        SetN2kPGN127250(N2kMsg, SID, state.courseRadians, N2kDoubleNA, N2kDoubleNA, N2khr_true);
+        return true;
+
+    case CrossTrackError:
+        SetN2kPGN129283(N2kMsg, SID, N2kxtem_Autonomous, !state.running, state.xteM);
+        return true;
+
+    case NavigationData: {
+        if (state.destinationIndex < 0) {
+            return false;
+        }
+        const RouteGeometry &geometry = autoPilot.routeGeometry();
+        int leg = qMin(state.originIndex, state.destinationIndex);
+        bool forward = state.destinationIndex > state.originIndex;
+        double originBearing = forward ? geometry.initialBearing(leg)
+                                       : normalizedBearing(geometry.pointAt(leg, geometry.length(leg)).bearing + M_PI);
+
+        double etaTime = N2kDoubleNA;
+        int16_t etaDate = N2kInt16NA;
+        if (std::isfinite(state.timeToDestinationS)) {
+            uint16_t days;
+            dateAndTime(state.timeMs + static_cast<qint64>(state.timeToDestinationS * 1000.0), days, etaTime);
+            etaDate = static_cast<int16_t>(days);
+        }
+
+        SetN2kPGN129284(N2kMsg, SID, state.distanceToDestinationM, N2khr_true, false,
+                        state.distanceToDestinationM <= ArrivalCircleM, N2kdct_GreatCircle, etaTime, etaDate,
+                        originBearing, state.bearingToDestinationRadians,
+                        static_cast<uint32_t>(state.originIndex), static_cast<uint32_t>(state.destinationIndex),
+                        state.destinationLatitude, state.destinationLongitude, state.closingVelocity);
+        return true;
+    }
+
+    case RouteInformation: {
+        if (state.destinationIndex < 0) {
+            return false;
+        }
+        // From the leg's origin onwards in the direction of travel, as many waypoints as fit the fast packet
+        const RouteData &route = autoPilot.routeData();
+        const int count = static_cast<int>(route.size());
+        int step = state.destinationIndex > state.originIndex ? 1 : -1;
+        SetN2kPGN129285(N2kMsg, static_cast<uint16_t>(state.originIndex), 0, 0,
+                        step > 0 ? N2kdir_forward : N2kdir_reverse, routeName.constData(), N2kDD002_No);
+        for (int index = state.originIndex; index >= 0 && index < count; index += step) {
+            QByteArray name = route.nameAt(static_cast<size_t>(index)).toUtf8();
+            if (!AppendN2kPGN129285(N2kMsg, static_cast<uint16_t>(index), name.constData(),
+                                    route.latitudes[index], route.longitudes[index])) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+void NavigationN2kBridge::dateAndTime(qint64 timeMs, uint16_t &daysSince1970, double &secondsSinceMidnight) const
+{
+    qint64 utcMs = epochMs + timeMs;
+    daysSince1970 = static_cast<uint16_t>(utcMs / MsPerDay);
+    secondsSinceMidnight = (utcMs % MsPerDay) / 1000.0;
+}
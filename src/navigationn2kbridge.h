@@ -0,0 +1,97 @@
+#ifndef NAVIGATIONN2KBRIDGE_H
+#define NAVIGATIONN2KBRIDGE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+#include "N2kMsg.h"
+#include "navigationstate.h"
+
+class AutoPilotSimulator;
+class PgnScheduler;
+
+// Puts the autopilot on the bus: position rapid (129025), COG/SOG rapid (129026), GNSS position
+// (129029), vessel heading (127250), cross track error (129283), navigation data (129284) and
+// route/waypoint information (129285), each as its own PgnScheduler stream with its own period.
+// Every stream reads the latest NavigationState snapshot and keeps its encoded message; the message
+// is only encoded again when a field it carries has changed since, otherwise the cached bytes are
+// copied into the scheduler's batch.
+class NavigationN2kBridge
+{
+public:
+    enum Message {
+        PositionRapid,      // 129025
+        CogSogRapid,        // 129026
+        GnssPosition,       // 129029
+        VesselHeading,      // 127250
+        CrossTrackError,    // 129283
+        NavigationData,     // 129284
+        RouteInformation,   // 129285
+        MessageCount
+    };
+
+    // Transmission periods, 0 disables a message
+    struct Periods {
+        int positionMs = 100;
+        int cogSogMs = 250;
+        int gnssMs = 1000;
+        int headingMs = 100;
+        int crossTrackMs = 1000;
+        int navigationMs = 1000;
+        int routeMs = 5000;
+    };
+
+    struct Statistics {
+        quint64 generated[MessageCount] = {};   // Messages handed to the scheduler
+        quint64 encoded[MessageCount] = {};     // Of those, freshly encoded instead of copied
+        quint64 totalGenerated() const;
+        quint64 totalEncoded() const;
+    };
+
+    NavigationN2kBridge(AutoPilotSimulator &autoPilot, PgnScheduler &scheduler);
+    ~NavigationN2kBridge();
+
+    void setPeriods(const Periods &periods);
+    void setPeriod(Message message, int periodMs);
+    int period(Message message) const { return messages[message].periodMs; }
+    // UTC time of simulated time 0, for the GNSS and ETA date and time fields
+    void setEpochMs(qint64 utcMsSinceEpoch) { epochMs = utcMsSinceEpoch; }
+    // Name sent in 129285
+    void setRouteName(const QString &name);
+
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    Statistics statistics() const { return stats; }
+    void resetStatistics() { stats = Statistics(); }
+
+    static unsigned long pgn(Message message);
+
+private:
+    struct Slot {
+        int stream = -1;
+        int periodMs = 0;
+        uint32_t fields = 0;            // Snapshot fields the message carries
+        quint64 encodedSequence = 0;    // Snapshot the cached message was encoded from
+        tN2kMsg cached;
+    };
+
+    // Arrival circle reported in 129284
+    static constexpr double ArrivalCircleM = 50.0;
+
+    AutoPilotSimulator &autoPilot;
+    PgnScheduler &scheduler;
+    Slot messages[MessageCount];
+    qint64 epochMs = 0;
+    QByteArray routeName;
+    bool running = false;
+    Statistics stats;
+
+    bool generate(Message message, tN2kMsg &N2kMsg);
+    bool encode(Message message, const NavigationState &state, tN2kMsg &N2kMsg) const;
+    void applyPeriod(Message message);
+    void dateAndTime(qint64 timeMs, uint16_t &daysSince1970, double &secondsSinceMidnight) const;
+};
+
+#endif // NAVIGATIONN2KBRIDGE_H
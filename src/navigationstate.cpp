@@ -0,0 +1,68 @@
+#include "navigationstate.h"
+
+namespace {
+
+// NaN before the first fix must not count as a change on every update
+inline bool differs(double a, double b)
+{
+    return a != b && (a == a || b == b);
+}
+
+}
+
+uint32_t NavigationState::changedSince(quint64 seenSequence) const
+{
+    if (seenSequence == 0) {
+        return AllFields;
+    }
+    uint32_t mask = 0;
+    for (int field = 0; field < FieldCount; ++field) {
+        if (fieldSequence[field] > seenSequence) {
+            mask |= 1u << field;
+        }
+    }
+    return mask;
+}
+
+void NavigationState::stamp(const NavigationState &previous)
+{
+    // Exact comparisons on purpose: any new value is a change, an unchanged one is bit identical
+    uint32_t mask = 0;
+    if (differs(latitude, previous.latitude) || differs(longitude, previous.longitude)) {
+        mask |= Position;
+    }
+    if (courseRadians != previous.courseRadians) {
+        mask |= Course;
+    }
+    if (speed != previous.speed) {
+        mask |= Speed;
+    }
+    if (xteM != previous.xteM) {
+        mask |= CrossTrack;
+    }
+    if (originIndex != previous.originIndex || destinationIndex != previous.destinationIndex
+        || destinationLatitude != previous.destinationLatitude || destinationLongitude != previous.destinationLongitude) {
+        mask |= Waypoint;
+    }
+    if (bearingToDestinationRadians != previous.bearingToDestinationRadians
+        || distanceToDestinationM != previous.distanceToDestinationM
+        || timeToDestinationS != previous.timeToDestinationS || closingVelocity != previous.closingVelocity) {
+        mask |= WaypointProgress;
+    }
+    if (distanceTraveledM != previous.distanceTraveledM || timeTraveledS != previous.timeTraveledS) {
+        mask |= Traveled;
+    }
+    if (running != previous.running) {
+        mask |= Running;
+    }
+    // The first snapshot reports everything
+    if (previous.sequence == 0) {
+        mask = AllFields;
+    }
+
+    sequence = previous.sequence + 1;
+    changed = mask;
+    for (int field = 0; field < FieldCount; ++field) {
+        fieldSequence[field] = (mask & (1u << field)) ? sequence : previous.fieldSequence[field];
+    }
+}
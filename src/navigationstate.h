@@ -0,0 +1,60 @@
+#ifndef NAVIGATIONSTATE_H
+#define NAVIGATIONSTATE_H
+
+#include <QMetaType>
+#include <cstdint>
+#include <limits>
+
+// Immutable snapshot of the autopilot after an update: position, motion, the active leg and the
+// progress along the route. One snapshot replaces the per field signals; consumers look at the
+// change mask (or changedSince() when they skip snapshots) and only redo work for fields that
+// moved. Angles in radians, distances in meters, positions in degrees.
+struct NavigationState {
+    enum Field : uint32_t {
+        Position = 1u << 0,         // latitude, longitude
+        Course = 1u << 1,           // courseRadians
+        Speed = 1u << 2,            // speed
+        CrossTrack = 1u << 3,       // xteM
+        Waypoint = 1u << 4,         // origin and destination indices and coordinates
+        WaypointProgress = 1u << 5, // bearing, distance, time and closing velocity to the destination
+        Traveled = 1u << 6,         // distanceTraveledM, timeTraveledS
+        Running = 1u << 7           // running
+    };
+    static constexpr int FieldCount = 8;
+    static constexpr uint32_t AllFields = (1u << FieldCount) - 1;
+
+    quint64 sequence = 0;           // 0 until the first snapshot, then one more per snapshot
+    qint64 timeMs = 0;              // Simulated time of the update
+    uint32_t changed = 0;           // Fields that differ from the previous snapshot
+
+    bool running = false;
+    double latitude = std::numeric_limits<double>::quiet_NaN();
+    double longitude = std::numeric_limits<double>::quiet_NaN();
+    double courseRadians = 0.0;     // True, direction of travel
+    double speed = 0.0;             // m/s
+    double xteM = 0.0;              // Positive right of the leg in the direction of travel
+
+    int originIndex = -1;           // Route indices, -1 without an active leg
+    int destinationIndex = -1;
+    double destinationLatitude = 0.0;
+    double destinationLongitude = 0.0;
+    double bearingToDestinationRadians = 0.0;
+    double distanceToDestinationM = 0.0;
+    double timeToDestinationS = std::numeric_limits<double>::infinity();   // Infinite when stopped
+    double closingVelocity = 0.0;   // m/s towards the destination
+
+    double distanceTraveledM = 0.0;
+    double timeTraveledS = 0.0;
+
+    // Sequence of the snapshot in which each field last changed
+    quint64 fieldSequence[FieldCount] = {};
+
+    bool hasPosition() const { return latitude == latitude && longitude == longitude; }
+    // Fields that changed after the snapshot with the given sequence, all of them for 0
+    uint32_t changedSince(quint64 seenSequence) const;
+    // Numbers this snapshot as the successor of previous and fills changed and fieldSequence
+    void stamp(const NavigationState &previous);
+};
+Q_DECLARE_METATYPE(NavigationState)
+
+#endif // NAVIGATIONSTATE_H
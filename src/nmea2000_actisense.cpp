@@ -1,12 +1,16 @@
 #include "nmea2000_actisense.h"
+#include "actisensecodec.h"
 #include <QDebug>
 
 NMEA2000_Actisense::NMEA2000_Actisense(QSerialPort &serialPort, QObject *parent)
-    : QObject(parent)
+    : N2kTransport(parent)
     , tNMEA2000()
     , serialPort(serialPort)
+    , txQueue(serialPort, this)
+    , rxBatch(64)
 {
     connect(&serialPort, &QSerialPort::readyRead, this, &NMEA2000_Actisense::onSerialDataAvailable);
+    frameClock.start();
 
     // Initialize product information, example values
     productInformation.N2kVersion = 1300;  // Example value
@@ -31,47 +35,35 @@ bool NMEA2000_Actisense::CANOpen() {
 }
 
 bool NMEA2000_Actisense::CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent) {
-    QByteArray frame;
-    frame.append(reinterpret_cast<const char*>(&id), sizeof(id));  // Append ID
-    frame.append(reinterpret_cast<const char*>(&len), sizeof(len));  // Append length
-    frame.append(reinterpret_cast<const char*>(buf), len);  // Append data
-
-    // Debug: Print the frame content to verify before writing
-    qDebug() << "Frame to send (size " << frame.size() << "):" << frame.toHex();
-    // Write frame to the serial port
-    qint64 bytesWritten = serialPort.write(frame);
-    if (bytesWritten != frame.size()) {
-        qDebug() << "Failed to write the complete frame to the serial port.";
+    Q_UNUSED(wait_sent);
+
+    if (len > 8) {
         return false;
     }
-
-    // Flush the serial port to ensure data is sent
-    serialPort.flush();
-
-    qDebug() << "Successfully sent frame.";
-    return true;
+    // Fast packet and transport frames are collected until the message is complete, then the whole
+    // message goes out as one BST frame with the others queued for the next flush
+    if (!frameAssembler.addFrame(id, len, buf, frameClock.elapsed(), assembledMsg)) {
+        return true;
+    }
+    return txQueue.enqueue(assembledMsg);
 }
 
 bool NMEA2000_Actisense::SendMessage(const tN2kMsg &N2kMsg)
 {
-    QByteArray message = encodeMessage(N2kMsg);
-    qint64 bytesWritten = serialPort.write(message);
-    if (bytesWritten != message.size()) {
-        qDebug() << "Failed to write the complete message to the serial port.";
-        return false;
-    }
-    serialPort.flush();
-    return true;
+    return txQueue.enqueue(N2kMsg);
+}
+
+bool NMEA2000_Actisense::SendMessages(const tN2kMsg *N2kMsgs, int count)
+{
+    return txQueue.enqueue(N2kMsgs, count) == count;
 }
 
 bool NMEA2000_Actisense::CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf) {
-    QByteArray frame = serialPort.readAll();
-    if (frame.size() >= 8) {  // Minimum size of a CAN frame
-        id = *reinterpret_cast<const unsigned long*>(frame.data());
-        len = frame[sizeof(id)];
-        memcpy(buf, frame.data() + sizeof(id) + sizeof(len), len);
-        return true;
-    }
+    Q_UNUSED(id);
+    Q_UNUSED(len);
+    Q_UNUSED(buf);
+    // The NGT-1 delivers complete messages through the BST parser; reading the port here would
+    // steal bytes from it
     return false;
 }
 
@@ -180,209 +172,191 @@ void NMEA2000_Actisense::SetN2kPGN126993(tN2kMsg &N2kMsg, uint32_t timeInterval_
     N2kMsg.AddByte(0xff);  // Reserved
     N2kMsg.Add4ByteUInt(0xffffffff);  // Reserved
 }
+#endif
 
 void NMEA2000_Actisense::onSerialDataAvailable()
 {
-    // Append new data from the serial port to the readBuffer
-    readBuffer.append(serialPort.readAll());
-
-    // Process the buffer until we find valid NMEA2000 packets
-    while (readBuffer.size() >= (NMEA2000HeaderLen + 2)) { // Minimum size of a packet
-        // Find the start of the packet (Escape, StartOfText)
-        int startIdx = readBuffer.indexOf(QByteArray::fromRawData("\x10\x02", 2)); // Escape (0x10), StartOfText (0x02)
-
-        // If start of a packet is not found, clear the buffer and return
-        if (startIdx == -1) {
-            readBuffer.clear();
-            return;
-        }
-
-        // Check if we have a valid message type (MsgTypeN2kData or MsgTypeN2kRequest)
-        if (readBuffer.size() < startIdx + NMEA2000HeaderLen) {
-            // Not enough data for the header, wait for more data
-            return;
-        }
-
-        char messageType = readBuffer[startIdx + NMEA2000HeaderLen - 1];
-        if (messageType != MsgTypeN2kRx && messageType != MsgTypeN2kTx) {
-            // Invalid message type, remove everything before this position
-            readBuffer.remove(0, startIdx + 1);
-            continue;
-        }
-
-        // Find the end of the packet (Escape, EndOfText)
-        int endIdx = readBuffer.indexOf(QByteArray::fromRawData("\x10\x03", 2), startIdx + NMEA2000HeaderLen);
-        if (endIdx == -1) {
-            // No complete packet found yet, wait for more data
-            return;
-        }
-
-        // Extract the full packet
-        QByteArray packet = readBuffer.mid(startIdx, endIdx - startIdx + 2); // Include the EndOfText (0x10 0x03)
-        //qDebug() << "Rcvd packet:" << packet.toHex(' ').toUpper();
-
-        // Remove the processed data from the buffer
-        readBuffer.remove(0, endIdx + 2);
-
-        // Now extract the message data (excluding the header and footer)
-        QByteArray messageData = packet.mid(2, packet.size() - 4); // Remove 2 bytes from start and 2 bytes from end
-        //qDebug() << "Rcvd af remove:" << messageData.toHex(' ').toUpper();
-
-        // Get the checksum (last byte of messageData)
-        quint8 receivedChecksum = static_cast<quint8>(messageData[messageData.size() - 1]);
-
-        // Remove the checksum from the messageData
-        messageData.chop(1);
+    // Everything decoded in this pass is collected in rxBatch and delivered with one signal
+    int batchCount = 0;
+
+    // Drain the port through a fixed chunk; the parser keeps its state between chunks so frames
+    // split across reads are reassembled without buffering the raw stream
+    qint64 bytesRead;
+    while ((bytesRead = serialPort.read(reinterpret_cast<char *>(readChunk), ReadChunkSize)) > 0) {
+        bstParser.feed(readChunk, static_cast<int>(bytesRead), [this, &batchCount](const ActisenseBstParser::Frame &frame) {
+            if (frame.command() != MsgTypeN2kRx && frame.command() != MsgTypeN2kTx) {
+                return;
+            }
+            if (batchCount == static_cast<int>(rxBatch.size())) {
+                rxBatch.resize(rxBatch.size() * 2);
+            }
+            tN2kMsg &N2kMsg = rxBatch[batchCount];
+            if (!decodeMessage(frame.data, frame.length, N2kMsg)) {
+                return;
+            }
+            batchCount++;
+            if (perMessageDelivery) {
+                emit nmea2000MessageReceived(N2kMsg);
+            }
+        });
+    }
 
-        // Calculate the expected checksum
-        uint8_t calculatedChecksum = calculateChecksum(messageData);
+    if (batchCount > 0) {
+        emit nmea2000MessagesReceived(rxBatch.data(), batchCount);
+    }
+}
 
-        // Validate checksum
-        if (calculatedChecksum != receivedChecksum) {
-            qWarning() << "Checksum mismatch: received" << receivedChecksum << "expected" << calculatedChecksum;
-            continue; // Ignore the packet if checksum is incorrect
+namespace {
+// Forward-only BST writer: escapes and sums each byte as it is stored
+struct BstWriter {
+    uint8_t *out;
+    int pos;
+    uint8_t sum;
+
+    inline void put(uint8_t byte)
+    {
+        out[pos++] = byte;
+        sum += byte;
+        if (byte == ActisenseCodec::Dle) {
+            out[pos++] = ActisenseCodec::Dle;
         }
-
-        //qDebug() << "Rcvd valid packet:" << messageData.toHex(' ').toUpper();
-        // Pass the valid messageData for further processing
-        decodeMessage(messageData);
     }
+};
 }
 
-uint8_t NMEA2000_Actisense::calculateChecksum(const QByteArray &data)
+int NMEA2000_Actisense::encodeMessage(const tN2kMsg &N2kMsg, uint8_t *buffer, int bufferSize)
 {
-    int byteSum = 0;
+    if (N2kMsg.DataLen < 0 || N2kMsg.DataLen > tN2kMsg::MaxDataLen) {
+        return 0;
+    }
 
-    // Sum all the bytes in the data
-    for (char byte : data) {
-        byteSum += static_cast<uint8_t>(byte);
+    // Message length is known up front (priority, PGN, destination, data length, payload),
+    // so the frame is written in one pass without prepending anything
+    const int length = 6 + N2kMsg.DataLen;
+    if (bufferSize < ActisenseCodec::maxEncodedLength(2 + length)) {
+        return 0;
     }
 
-    // The checksum is calculated as 256 - (byteSum % 256), and then reduced modulo 256
-    return static_cast<uint8_t>(256 - (byteSum % 256));
+    buffer[0] = ActisenseCodec::Dle;
+    buffer[1] = ActisenseCodec::Stx;
+    BstWriter writer{buffer, 2, 0};
+
+    writer.put(MsgTypeN2kTx);
+    writer.put(static_cast<uint8_t>(length));
+    writer.put(N2kMsg.Priority);
+    writer.put(N2kMsg.PGN & 0xFF);
+    writer.put((N2kMsg.PGN >> 8) & 0xFF);
+    writer.put((N2kMsg.PGN >> 16) & 0xFF);
+    writer.put(N2kMsg.Destination);
+    // Source and timestamp are left out, the NGT-1 does not use them on transmit
+    writer.put(static_cast<uint8_t>(N2kMsg.DataLen));
+
+    // Payload is the only long run, escape it in bulk
+    writer.sum += ActisenseCodec::byteSum(N2kMsg.Data, N2kMsg.DataLen);
+    writer.pos += ActisenseCodec::escape(N2kMsg.Data, N2kMsg.DataLen, buffer + writer.pos);
+
+    writer.put(static_cast<uint8_t>(-writer.sum));
+    buffer[writer.pos++] = ActisenseCodec::Dle;
+    buffer[writer.pos++] = ActisenseCodec::Etx;
+
+    return writer.pos;
 }
 
-void NMEA2000_Actisense::addChecksum(QByteArray &data)
+int NMEA2000_Actisense::encodeMessages(const tN2kMsg *N2kMsgs, int count, uint8_t *buffer, int bufferSize, int &encodedCount)
 {
-    // Calculate checksum for the data
-    uint8_t checksum = calculateChecksum(data);
-
-    // Append the checksum to the data
-    data.append(static_cast<char>(checksum));
-
-    // Escape the checksum if necessary (e.g., if it matches the Escape character)
-    if (checksum == Escape) {
-        data.append(static_cast<char>(checksum)); // Double escape if necessary
+    int written = 0;
+    encodedCount = 0;
+
+    while (encodedCount < count) {
+        int frameLen = encodeMessage(N2kMsgs[encodedCount], buffer + written, bufferSize - written);
+        if (frameLen == 0) {
+            // Invalid message is skipped, a full buffer ends the batch
+            if (bufferSize - written >= MaxEncodedMessageLen) {
+                encodedCount++;
+                continue;
+            }
+            break;
+        }
+        written += frameLen;
+        encodedCount++;
     }
-}
 
-void NMEA2000_Actisense::AppendByteEscaped(unsigned char byteToAppend, QByteArray &message)
-{
-    message.append(static_cast<char>(byteToAppend));
-
-    if (byteToAppend == 0x10) { // Escape character
-        message.append(static_cast<char>(0x10)); // Double the escape if necessary
-    }
+    return written;
 }
 
-QByteArray NMEA2000_Actisense::encodeMessage(const tN2kMsg &N2kMsg)
+int NMEA2000_Actisense::encodeBody(const tN2kMsg &N2kMsg, bool received, uint32_t timestampMs, uint8_t *buffer, int bufferSize)
 {
-    QByteArray message;
-
-    // Add Priority
-    message.append(static_cast<char>(N2kMsg.Priority));
-
-    // Add PGN (3 bytes)
-    message.append(static_cast<char>(N2kMsg.PGN & 0xFF));         // First byte of PGN
-    message.append(static_cast<char>((N2kMsg.PGN >> 8) & 0xFF));  // Second byte of PGN
-    message.append(static_cast<char>((N2kMsg.PGN >> 16) & 0xFF)); // Third byte of PGN
-
-    // Add Destination
-    message.append(static_cast<char>(N2kMsg.Destination));
-
-/*  // Commented out Source and Timestamp, Actisense NGT-1 does not use them
-    // Add Source
-    //message.append(static_cast<char>(N2kMsg.Source));
-    message.append(static_cast<char>(0x00));
-
-    // Add Timestamp (for now we can use 0 for simplicity)
-    quint32 msgTime = 0; // Use appropriate value or keep as 0
-    message.append(static_cast<char>(msgTime & 0xFF));
-    message.append(static_cast<char>((msgTime >> 8) & 0xFF));
-    message.append(static_cast<char>((msgTime >> 16) & 0xFF));
-    message.append(static_cast<char>((msgTime >> 24) & 0xFF));
-*/
-
-    // Add Data Length
-    message.append(static_cast<char>(N2kMsg.DataLen));
-
-    // Add Payload (NMEA2000 PGN data)
-    for (int i = 0; i < N2kMsg.DataLen; i++) {
-        message.append(static_cast<char>(N2kMsg.Data[i]));
+    if (N2kMsg.DataLen < 0 || N2kMsg.DataLen > tN2kMsg::MaxDataLen) {
+        return 0;
+    }
+    const int length = (received ? 11 : 6) + N2kMsg.DataLen;
+    if (bufferSize < 2 + length) {
+        return 0;
     }
 
-    // Get size of the message
-    uint8_t length = static_cast<uint8_t>(message.size());
-    message.prepend(static_cast<char>(length));
-
-    // Add message type
-    message.prepend(MsgTypeN2kTx); // Message type (0x93)
-
-    // Add checksum
-    addChecksum(message);
-
-    // Add PreAmble and PostAmble
-    message.prepend(StartOfText); // Start of text (0x02)
-    message.prepend(Escape);      // Escape character (0x10)
-    message.append(Escape);       // Escape character (0x10)
-    message.append(EndOfText);    // End of text (0x03)
-
-    return message;
+    int pos = 0;
+    buffer[pos++] = received ? MsgTypeN2kRx : MsgTypeN2kTx;
+    buffer[pos++] = static_cast<uint8_t>(length);
+    buffer[pos++] = N2kMsg.Priority;
+    buffer[pos++] = N2kMsg.PGN & 0xFF;
+    buffer[pos++] = (N2kMsg.PGN >> 8) & 0xFF;
+    buffer[pos++] = (N2kMsg.PGN >> 16) & 0xFF;
+    buffer[pos++] = N2kMsg.Destination;
+    if (received) {
+        buffer[pos++] = N2kMsg.Source;
+        for (int shift = 0; shift < 32; shift += 8) {
+            buffer[pos++] = static_cast<uint8_t>(timestampMs >> shift);
+        }
+    }
+    buffer[pos++] = static_cast<uint8_t>(N2kMsg.DataLen);
+    memcpy(buffer + pos, N2kMsg.Data, N2kMsg.DataLen);
+    return pos + N2kMsg.DataLen;
 }
 
-tN2kMsg NMEA2000_Actisense::decodeMessage(const QByteArray &message)
+bool NMEA2000_Actisense::decodeMessage(const uint8_t *message, int length, tN2kMsg &N2kMsg)
 {
-    //qDebug() << "Decoding message:" << message.toHex(' ').toUpper();
-
-    tN2kMsg N2kMsg;
-    int idx = 2; // Index to track the position in the byte array
+    N2kMsg.Clear();
+    const bool isRx = (message[0] == MsgTypeN2kRx);
+    // Rx frames carry source and a 4 byte timestamp after the destination, Tx echoes do not
+    const int headerLen = isRx ? 11 : 6;
+    int idx = 2; // Skip message type and length
+
+    if (length < idx + headerLen) {
+        qWarning() << "Actisense frame too short:" << length << "bytes";
+        return false;
+    }
 
     // Extract Priority
-    N2kMsg.Priority = static_cast<uint8_t>(message[idx++]);
-    //qDebug() << "Priority:" << N2kMsg.Priority;
+    N2kMsg.Priority = message[idx++];
 
     // Extract PGN (3 bytes)
-    N2kMsg.PGN = static_cast<uint8_t>(message[idx++]);
-    N2kMsg.PGN |= static_cast<uint8_t>(message[idx++]) << 8;
-    N2kMsg.PGN |= static_cast<uint8_t>(message[idx++]) << 16;
-    //qDebug() << "PGN:" << N2kMsg.PGN;
+    N2kMsg.PGN = message[idx++];
+    N2kMsg.PGN |= static_cast<unsigned long>(message[idx++]) << 8;
+    N2kMsg.PGN |= static_cast<unsigned long>(message[idx++]) << 16;
 
     // Extract Destination
-    N2kMsg.Destination = static_cast<uint8_t>(message[idx++]);
-    //qDebug() << "Destination:" << N2kMsg.Destination;
+    N2kMsg.Destination = message[idx++];
 
-    // Extract Source
-    N2kMsg.Source = static_cast<uint8_t>(message[idx++]);
-    //qDebug() << "Source:" << N2kMsg.Source;
+    if (isRx) {
+        // Extract Source
+        N2kMsg.Source = message[idx++];
 
-    // Skip Timestamp (4 bytes)
-    idx += 4;
+        // Skip Timestamp (4 bytes)
+        idx += 4;
+    } else {
+        N2kMsg.Source = DefaultSource;
+    }
 
     // Extract Data Length
-    N2kMsg.DataLen = static_cast<uint8_t>(message[idx++]);
-    //qDebug() << "Data Length:" << N2kMsg.DataLen;
-
-    // Extract Payload (NMEA2000 PGN data)
-    for (int i = 0; i < N2kMsg.DataLen; i++) {
-        N2kMsg.Data[i] = static_cast<uint8_t>(message[idx++]);
+    N2kMsg.DataLen = message[idx++];
+    if (N2kMsg.DataLen > tN2kMsg::MaxDataLen || idx + N2kMsg.DataLen > length) {
+        qWarning() << "Actisense frame data length" << N2kMsg.DataLen << "exceeds frame size" << length;
+        N2kMsg.Clear();
+        return false;
     }
-    //qDebug() << "Data:" << QByteArray(reinterpret_cast<const char *>(N2kMsg.Data), N2kMsg.DataLen).toHex(' ').toUpper();
 
-    //qDebug() << "Decoded N2kMsg with PGN:" << N2kMsg.PGN << "Data:" << N2kMsg.DataLen << "bytes";
-    // Handle the decoded message
-    emit nmea2000MessageReceived(N2kMsg); // Signal to your Nmea2000Handler class
+    // Extract Payload (NMEA2000 PGN data)
+    memcpy(N2kMsg.Data, message + idx, N2kMsg.DataLen);
 
-    return N2kMsg;
+    return true;
 }
-
-#endif
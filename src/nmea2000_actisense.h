@@ -1,23 +1,45 @@
 #ifndef NMEA2000_ACTISENSE_H
 #define NMEA2000_ACTISENSE_H
 
+#include <QElapsedTimer>
 #include <QSerialPort>
+#include <vector>
+#include "actisensebstparser.h"
+#include "n2kframeassembler.h"
+#include "n2ktransport.h"
+#include "serialtxqueue.h"
 #include "NMEA2000.h"
 #include "N2kMsg.h"
 #include "N2kMessages.h"
 
-class NMEA2000_Actisense : public QObject, public tNMEA2000
+class NMEA2000_Actisense : public N2kTransport, public tNMEA2000
 {
     Q_OBJECT
 
 public:
     explicit NMEA2000_Actisense(QSerialPort &serialPort, QObject *parent = nullptr);
 
-    // CAN functions
+    // CAN functions. The NGT-1 speaks whole messages, not frames: frames from the library are
+    // reassembled and queued as one message, and receiving happens in onSerialDataAvailable.
     bool CANOpen();
     bool CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent);
     bool CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf);
-    bool SendMessage(const tN2kMsg &N2kMsg);
+    bool SendMessage(const tN2kMsg &N2kMsg) override;
+    bool SendMessages(const tN2kMsg *N2kMsgs, int count) override;
+    void Flush() override { txQueue.flush(); }
+
+    // BST encoding into caller supplied buffers, returns bytes written or 0 if the buffer is too small
+    static constexpr int MaxEncodedMessageLen = 512;
+    static int encodeMessage(const tN2kMsg &N2kMsg, uint8_t *buffer, int bufferSize);
+    static int encodeMessages(const tN2kMsg *N2kMsgs, int count, uint8_t *buffer, int bufferSize, int &encodedCount);
+
+    // Unframed BST N2K message (command, length, fields, payload; no escaping or checksum) as log files
+    // store it. Received (0x93) messages carry the source and a millisecond timestamp, sent (0x94) ones neither.
+    static constexpr int MaxBodyLen = 2 + 11 + 223;
+    static int encodeBody(const tN2kMsg &N2kMsg, bool received, uint32_t timestampMs, uint8_t *buffer, int bufferSize);
+    static bool isN2kBody(uint8_t command) { return command == MsgTypeN2kRx || command == MsgTypeN2kTx; }
+    static bool isSentBody(uint8_t command) { return command == MsgTypeN2kTx; }
+    static bool decodeMessage(const uint8_t *message, int length, tN2kMsg &N2kMsg);
 
     // Product information methods
     unsigned short GetN2kVersion() const;
@@ -32,6 +54,18 @@ public:
     // NMEA2000 message handling
     void HandleMsg(const tN2kMsg &N2kMsg);
 
+    // Transmit queue, for coalescing window, backlog limit and counters
+    SerialTxQueue &GetTxQueue() { return txQueue; }
+
+    // Received messages are delivered once per readyRead through nmea2000MessagesReceived.
+    // Enable this to additionally get nmea2000MessageReceived for every single message.
+    void SetPerMessageDelivery(bool enable) { perMessageDelivery = enable; }
+
+    // Receive path statistics
+    const ActisenseBstParser::Statistics &GetParserStatistics() const { return bstParser.statistics(); }
+    // Reassembly of frames handed to CANSendFrame
+    N2kFrameAssembler::Statistics GetFrameAssemblerStatistics() const { return frameAssembler.statistics(); }
+
     // New methods from NMEA2000.cpp
     void HandleCommandedAddress(uint64_t CommandedName, unsigned char NewAddress, int iDev);
     void HandleCommandedAddress(const tN2kMsg &N2kMsg);
@@ -52,33 +86,35 @@ private slots:
     void onSerialDataAvailable();
 
 signals:
+    // Next to N2kTransport::nmea2000MessagesReceived, which carries all messages of one readyRead
     void nmea2000MessageReceived(tN2kMsg &N2kMsg);
 
 private:
     QSerialPort &serialPort;
-    QByteArray readBuffer;
+    SerialTxQueue txQueue;
+    ActisenseBstParser bstParser;
+    N2kFrameAssembler frameAssembler;
+    QElapsedTimer frameClock;
+    tN2kMsg assembledMsg;
+    static constexpr int ReadChunkSize = 4096;
+    uint8_t readChunk[ReadChunkSize];
+    std::vector<tN2kMsg> rxBatch;
+    bool perMessageDelivery = false;
     bool AddressChanged = false;
     bool DeviceInformationChanged = false;
 
     tProductInformation productInformation;  // Use this for product information
 
-    uint8_t calculateChecksum(const QByteArray &data);
-    void addChecksum(QByteArray &data);
-
-    void AppendByteEscaped(unsigned char byteToAppend, QByteArray &message);
-    QByteArray encodeMessage(const tN2kMsg &N2kMsg);
-    tN2kMsg decodeMessage(const QByteArray &message);
-
-    const char Escape = 0x10;
-    const char StartOfText = 0x02;
-    const char EndOfText = 0x03;
-    const int NMEA2000DataLenOffset = 2;
-    const int NMEA2000HeaderLen = 3;
-    const char MsgTypeN2kRx = 0x93;
-    const char MsgTypeN2kTx = 0x94;
-    const char BTS = 0xD0;
-    const char MaxDataLen = 223;
-    const char DefaultSource = 0;
+    static constexpr uint8_t Escape = 0x10;
+    static constexpr uint8_t StartOfText = 0x02;
+    static constexpr uint8_t EndOfText = 0x03;
+    static constexpr int NMEA2000DataLenOffset = 2;
+    static constexpr int NMEA2000HeaderLen = 3;
+    static constexpr uint8_t MsgTypeN2kRx = 0x93;
+    static constexpr uint8_t MsgTypeN2kTx = 0x94;
+    static constexpr uint8_t BTS = 0xD0;
+    static constexpr uint8_t MaxDataLen = 223;
+    static constexpr uint8_t DefaultSource = 0;
 };
 
 #endif // NMEA2000_ACTISENSE_H
@@ -1,38 +1,69 @@
 #include "nmea2000handler.h"
 #include <QDebug>
-#include <QThread>
-#include "N2kMessages.h"
-
-extern NMEA2000_Actisense nmea2000Actisense;
+#include <QMetaObject>
 
 Nmea2000Handler::Nmea2000Handler(QObject *parent)
     : QObject(parent)
-    , nmea2000Actisense(nullptr)
-{}
+    , actisenseLink(new ActisenseLink())
+    , rxBatch(256)
+{
+    // The serial port, BST parser and codec all run on the I/O thread
+    ioThread.setObjectName("NGT-1 I/O");
+    actisenseLink->moveToThread(&ioThread);
+    connect(&ioThread, &QThread::finished, actisenseLink, &QObject::deleteLater);
+    connect(actisenseLink, &ActisenseLink::rxAvailable, this, &Nmea2000Handler::onRxAvailable, Qt::QueuedConnection);
+    ioThread.start(QThread::HighPriority);
+}
+
+Nmea2000Handler::~Nmea2000Handler()
+{
+    QMetaObject::invokeMethod(actisenseLink, "close", Qt::BlockingQueuedConnection);
+    ioThread.quit();
+    ioThread.wait();
+}
 
 void Nmea2000Handler::InitializeActisense(const QString &portName, QSerialPort::BaudRate baudRate)
 {
-    // Set up the serial port for Actisense NGT-1
-    serialPort.setPortName(portName);
-    serialPort.setBaudRate(baudRate);
-    serialPort.setDataBits(QSerialPort::Data8);
-    serialPort.setParity(QSerialPort::NoParity);
-    serialPort.setStopBits(QSerialPort::OneStop);
-    serialPort.setFlowControl(QSerialPort::NoFlowControl);
-
-    QThread::msleep(10);
-    // Create the NMEA2000_Actisense object
-    nmea2000Actisense = new NMEA2000_Actisense(serialPort);
-    QThread::msleep(10);
-    nmea2000Actisense->SetMode(tNMEA2000::N2km_ListenAndNode, 44);
-    QThread::msleep(10);
-
-    // Open the NMEA2000 connection
-    if (nmea2000Actisense->Open()) {
-        qInfo() << "NGT-1 connected";
-    } else {
-        qWarning() << "Failed to connect to NGT-1";
+    // Set up the serial port for Actisense NGT-1 on the I/O thread
+    QMetaObject::invokeMethod(actisenseLink, "open", Qt::QueuedConnection,
+                              Q_ARG(QString, portName), Q_ARG(int, static_cast<int>(baudRate)));
+}
+
+void Nmea2000Handler::InitializeSocketCan(const QString &interfaceName, bool kernelFilter)
+{
+    std::vector<unsigned long> pgns;
+    if (kernelFilter) {
+        pgns = dispatcher.subscribedPGNs();
     }
+    ActisenseLink *link = actisenseLink;
+    QMetaObject::invokeMethod(actisenseLink, [link, interfaceName, pgns]() {
+        link->openSocketCan(interfaceName, pgns);
+    }, Qt::QueuedConnection);
+}
+
+bool Nmea2000Handler::SendMessage(const tN2kMsg &N2kMsg)
+{
+    return actisenseLink->post(N2kMsg);
+}
+
+int Nmea2000Handler::SendMessages(const tN2kMsg *N2kMsgs, int count)
+{
+    return actisenseLink->postBatch(N2kMsgs, count);
+}
+
+void Nmea2000Handler::StartCapture(const QString &path)
+{
+    QMetaObject::invokeMethod(actisenseLink, "startCapture", Qt::QueuedConnection, Q_ARG(QString, path));
+}
+
+void Nmea2000Handler::StopCapture()
+{
+    QMetaObject::invokeMethod(actisenseLink, "stopCapture", Qt::QueuedConnection);
+}
+
+ActisenseLink::Statistics Nmea2000Handler::GetLinkStatistics() const
+{
+    return actisenseLink->statistics();
 }
 
 void Nmea2000Handler::sendTestPgn129026() {
@@ -48,7 +79,7 @@ void Nmea2000Handler::sendTestPgn129026() {
     SetN2kPGN129026(N2kMsg, 1, COGReference, COG, SOG);
 
     // Send the message via NMEA2000
-    if (nmea2000Actisense->SendMessage(N2kMsg)) {
+    if (SendMessage(N2kMsg)) {
         //qDebug() << "PGN 129026 sent successfully";
     } else {
         qDebug() << "Failed to send PGN 129026";
@@ -63,11 +94,36 @@ void Nmea2000Handler::SendPgn129026(double COG, double SOG, tN2kHeadingReference
     SetN2kPGN129026(N2kMsg, 1, COGReference, COG, SOG);
 
     // Send the message via NMEA2000
-    if (nmea2000Actisense->SendMessage(N2kMsg)) {
+    if (SendMessage(N2kMsg)) {
         //qDebug() << "PGN 129026 sent successfully";
     } else {
         qWarning() << "Failed to send PGN 129026";
     }
 }
 
-void Nmea2000Handler::nmea2000MessageReceived(tN2kMsg &N2kMsg) {}
+void Nmea2000Handler::onRxAvailable()
+{
+    size_t count = actisenseLink->takeReceived(rxBatch.data(), rxBatch.size());
+    if (count == 0) {
+        return;
+    }
+
+    dispatcher.dispatch(rxBatch.data(), count);
+    emit messagesReceived(rxBatch.data(), static_cast<int>(count));
+
+    if (perMessageDelivery) {
+        for (size_t i = 0; i < count; i++) {
+            nmea2000MessageReceived(rxBatch[i]);
+        }
+    }
+
+    // More than one batch waiting, pick the rest up on the next pass instead of starving the GUI
+    if (count == rxBatch.size()) {
+        QMetaObject::invokeMethod(this, &Nmea2000Handler::onRxAvailable, Qt::QueuedConnection);
+    }
+}
+
+void Nmea2000Handler::nmea2000MessageReceived(tN2kMsg &N2kMsg)
+{
+    emit messageReceived(N2kMsg);
+}
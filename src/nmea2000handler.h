@@ -3,23 +3,65 @@
 
 #include <QObject>
 #include <QSerialPort>
-#include "nmea2000_actisense.h"
+#include <QThread>
+#include <vector>
+#include "actisenselink.h"
+#include "n2kdispatcher.h"
+#include "N2kMessages.h"
 
 class Nmea2000Handler : public QObject {
     Q_OBJECT
 
 public:
     explicit Nmea2000Handler(QObject *parent = nullptr);
+    ~Nmea2000Handler();
     void InitializeActisense(const QString &portName, QSerialPort::BaudRate baudRate = QSerialPort::Baud115200);
+    // Linux CAN interface (can0, vcan0) instead of the NGT-1. With kernelFilter only the PGNs that
+    // have a Dispatcher handler at this point reach us (all of them if none has), everything else is
+    // dropped in the kernel and so also missing from captures.
+    void InitializeSocketCan(const QString &interfaceName, bool kernelFilter = false);
     void sendTestPgn129026();
     void SendPgn129026(double COG, double SOG, tN2kHeadingReference COGReference = N2khr_magnetic);
 
+    // Queues a message for the I/O thread, false if the transmit ring is full. Any thread may send.
+    bool SendMessage(const tN2kMsg &N2kMsg);
+    // Queues a batch, returns how many fit in the transmit ring
+    int SendMessages(const tN2kMsg *N2kMsgs, int count);
+
+    // Per PGN handlers for received messages, register before InitializeActisense or InitializeSocketCan
+    N2kDispatcher &Dispatcher() { return dispatcher; }
+
+    // Batches are always delivered; per message delivery through messageReceived is opt-in
+    void SetPerMessageDelivery(bool enable) { perMessageDelivery = enable; }
+
+    // Records the traffic of the I/O thread to a capture file until StopCapture
+    void StartCapture(const QString &path);
+    void StopCapture();
+
+    // Queue depths, drop counts and latency histograms of the I/O thread rings
+    ActisenseLink::Statistics GetLinkStatistics() const;
+#ifdef Q_OS_LINUX
+    // Frame, system call and timestamp counters of the SocketCAN transport, kept after it closes
+    SocketCanTransport::Statistics GetCanStatistics() const { return actisenseLink->canStatistics(); }
+#endif
+
+signals:
+    // Everything received since the last wakeup as one contiguous span, valid during the emission only
+    void messagesReceived(const tN2kMsg *N2kMsgs, int count);
+    void messageReceived(const tN2kMsg &N2kMsg);
+
 public slots:
     void nmea2000MessageReceived(tN2kMsg &N2kMsg);
 
+private slots:
+    void onRxAvailable();
+
 private:
-    QSerialPort serialPort;
-    NMEA2000_Actisense *nmea2000Actisense;
+    QThread ioThread;
+    ActisenseLink *actisenseLink;
+    N2kDispatcher dispatcher;
+    std::vector<tN2kMsg> rxBatch;
+    bool perMessageDelivery = false;
 };
 
 #endif // NMEA2000HANDLER_H
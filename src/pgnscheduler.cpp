@@ -0,0 +1,212 @@
+#include "pgnscheduler.h"
+
+PgnScheduler::PgnScheduler(QObject *parent)
+    : QObject(parent)
+    , batch(64)
+{
+    tickTimer.setTimerType(Qt::PreciseTimer);
+    tickTimer.setInterval(5);
+    connect(&tickTimer, &QTimer::timeout, this, &PgnScheduler::onTick);
+}
+
+int PgnScheduler::registerStream(unsigned long PGN, const StreamOptions &options, Generator generator)
+{
+    if (options.periodMs <= 0 || !generator) {
+        return -1;
+    }
+
+    TimingWheel::Handle handle = wheel.allocate();
+    if (handle >= streams.size()) {
+        streams.resize(handle + 1);
+    }
+
+    Stream &stream = streams[handle];
+    stream.PGN = PGN;
+    stream.options = options;
+    stream.options.jitterMs = qBound(0, options.jitterMs, options.periodMs / 2);
+    stream.options.maxBurst = qMax(1, options.maxBurst);
+    stream.generator = std::move(generator);
+    stream.used = true;
+    stream.enabled = true;
+
+    // Golden ratio spread keeps streams of the same period from firing in the same tick
+    qint64 phase = options.phaseMs >= 0 ? options.phaseMs
+                                        : static_cast<qint64>((handle * 0.6180339887) * options.periodMs) % options.periodMs;
+    stream.idealDueMs = currentMs + phase;
+    wheel.schedule(handle, static_cast<uint64_t>(stream.idealDueMs));
+
+    activeStreams++;
+    return static_cast<int>(handle);
+}
+
+void PgnScheduler::unregisterStream(int stream)
+{
+    if (stream < 0 || stream >= static_cast<int>(streams.size()) || !streams[stream].used) {
+        return;
+    }
+    wheel.release(static_cast<TimingWheel::Handle>(stream));
+    streams[stream] = Stream();
+    activeStreams--;
+}
+
+bool PgnScheduler::setStreamPeriod(int stream, int periodMs)
+{
+    if (stream < 0 || stream >= static_cast<int>(streams.size()) || !streams[stream].used || periodMs <= 0) {
+        return false;
+    }
+
+    Stream &s = streams[stream];
+    s.options.periodMs = periodMs;
+    s.options.jitterMs = qMin(s.options.jitterMs, periodMs / 2);
+
+    // A faster rate takes effect right away instead of after the pending (slower) period
+    if (s.enabled && s.idealDueMs > currentMs + periodMs) {
+        s.idealDueMs = currentMs + periodMs;
+        scheduleNext(static_cast<TimingWheel::Handle>(stream));
+    }
+    return true;
+}
+
+int PgnScheduler::streamPeriod(int stream) const
+{
+    if (stream < 0 || stream >= static_cast<int>(streams.size()) || !streams[stream].used) {
+        return 0;
+    }
+    return streams[stream].options.periodMs;
+}
+
+void PgnScheduler::setStreamEnabled(int stream, bool enabled)
+{
+    if (stream < 0 || stream >= static_cast<int>(streams.size()) || !streams[stream].used
+        || streams[stream].enabled == enabled) {
+        return;
+    }
+
+    Stream &s = streams[stream];
+    s.enabled = enabled;
+    if (enabled) {
+        s.idealDueMs = currentMs;
+        scheduleNext(static_cast<TimingWheel::Handle>(stream));
+    } else {
+        wheel.cancel(static_cast<TimingWheel::Handle>(stream));
+    }
+}
+
+void PgnScheduler::start()
+{
+    if (isRunning()) {
+        return;
+    }
+
+    // Scheduler time continues where it stopped
+    clock.start();
+    tickStartMs = currentMs;
+    tickTimer.start();
+}
+
+void PgnScheduler::stop()
+{
+    tickTimer.stop();
+}
+
+void PgnScheduler::onTick()
+{
+    advanceTo(tickStartMs + clock.elapsed());
+}
+
+void PgnScheduler::advanceTo(qint64 nowMs)
+{
+    if (nowMs < currentMs) {
+        return;
+    }
+
+    QElapsedTimer overhead;
+    overhead.start();
+
+    currentMs = nowMs;
+    batchCount = 0;
+    wheel.advance(static_cast<uint64_t>(nowMs), [this](TimingWheel::Handle handle, uint64_t dueTick) {
+        fire(handle, static_cast<qint64>(dueTick));
+    });
+
+    if (batchCount > 0) {
+        stats.generated += batchCount;
+        int accepted = messageSink ? messageSink(batch.data(), batchCount) : 0;
+        stats.sent += accepted;
+        stats.dropped += batchCount - accepted;
+    }
+
+    double tickUs = overhead.nsecsElapsed() / 1000.0;
+    stats.ticks++;
+    stats.lastTickUs = tickUs;
+    stats.totalTickUs += tickUs;
+    stats.maxTickUs = qMax(stats.maxTickUs, tickUs);
+}
+
+void PgnScheduler::fire(TimingWheel::Handle handle, qint64 dueMs)
+{
+    Stream &stream = streams[handle];
+    const qint64 period = stream.options.periodMs;
+
+    lateness.record(static_cast<uint64_t>(qMax<qint64>(0, currentMs - dueMs)) * 1000);
+
+    // Periods of the ideal timeline that passed without a transmission
+    qint64 missed = qMax<qint64>(0, (currentMs - stream.idealDueMs) / period);
+    qint64 sends = 1;
+    if (stream.options.catchUp == CatchUp::Burst) {
+        sends = qMin<qint64>(missed + 1, stream.options.maxBurst);
+    }
+    stats.skippedPeriods += static_cast<quint64>(missed + 1 - sends);
+    stream.idealDueMs += (missed + 1) * period;
+
+    for (qint64 i = 0; i < sends; i++) {
+        tN2kMsg &N2kMsg = nextBatchSlot();
+        N2kMsg.Clear();
+        if (stream.generator(N2kMsg)) {
+            batchCount++;
+        }
+    }
+
+    scheduleNext(handle);
+}
+
+void PgnScheduler::scheduleNext(TimingWheel::Handle handle)
+{
+    Stream &stream = streams[handle];
+    qint64 due = stream.idealDueMs + nextJitter(stream.options.jitterMs);
+    wheel.schedule(handle, static_cast<uint64_t>(qMax(due, currentMs)));
+}
+
+int PgnScheduler::nextJitter(int jitterMs)
+{
+    if (jitterMs <= 0) {
+        return 0;
+    }
+
+    // xorshift64, deterministic so runs are reproducible
+    jitterState ^= jitterState << 13;
+    jitterState ^= jitterState >> 7;
+    jitterState ^= jitterState << 17;
+    return static_cast<int>(jitterState % static_cast<uint64_t>(2 * jitterMs + 1)) - jitterMs;
+}
+
+tN2kMsg &PgnScheduler::nextBatchSlot()
+{
+    if (batchCount == static_cast<int>(batch.size())) {
+        batch.resize(batch.size() * 2);
+    }
+    return batch[batchCount];
+}
+
+PgnScheduler::Statistics PgnScheduler::statistics() const
+{
+    Statistics result = stats;
+    result.lateness = lateness.snapshot();
+    return result;
+}
+
+void PgnScheduler::resetStatistics()
+{
+    stats = Statistics();
+    lateness.reset();
+}
@@ -0,0 +1,113 @@
+#ifndef PGNSCHEDULER_H
+#define PGNSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <functional>
+#include <vector>
+#include "N2kMsg.h"
+#include "latencyhistogram.h"
+#include "timingwheel.h"
+
+// Drives every periodic PGN from one tick source. Streams sit in a hierarchical timing wheel with
+// 1 ms resolution, so a tick only touches the streams that are due. Each stream keeps an ideal
+// timeline (phase + n * period) that jitter never drifts, and a catch-up policy for periods missed
+// while the event loop was busy. Messages generated in one tick are handed to the sink as one batch.
+class PgnScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Fills N2kMsg, returns false to skip this period
+    using Generator = std::function<bool(tN2kMsg &N2kMsg)>;
+    // Receives every message generated in one tick, returns how many were accepted
+    using Sink = std::function<int(const tN2kMsg *N2kMsgs, int count)>;
+
+    enum class CatchUp {
+        Skip,   // Send once and drop the missed periods
+        Burst   // Send the missed periods too, up to maxBurst per tick
+    };
+
+    struct StreamOptions {
+        int periodMs = 1000;
+        int jitterMs = 0;   // Each transmission is moved by a random offset within +-jitterMs
+        int phaseMs = -1;   // Offset of the first transmission, -1 spreads streams automatically
+        CatchUp catchUp = CatchUp::Skip;
+        int maxBurst = 4;
+    };
+
+    struct Statistics {
+        quint64 ticks = 0;
+        quint64 generated = 0;
+        quint64 sent = 0;
+        quint64 dropped = 0;
+        quint64 skippedPeriods = 0;
+        LatencyHistogram::Snapshot lateness;
+        double lastTickUs = 0.0;
+        double maxTickUs = 0.0;
+        double totalTickUs = 0.0;
+    };
+
+    explicit PgnScheduler(QObject *parent = nullptr);
+
+    void setSink(Sink sink) { messageSink = std::move(sink); }
+
+    int registerStream(unsigned long PGN, const StreamOptions &options, Generator generator);
+    void unregisterStream(int stream);
+    bool setStreamPeriod(int stream, int periodMs);
+    int streamPeriod(int stream) const;
+    void setStreamEnabled(int stream, bool enabled);
+    int streamCount() const { return activeStreams; }
+
+    // Interval of the driving QTimer; the wheel itself always has 1 ms resolution
+    void setTickInterval(int intervalMs) { tickTimer.setInterval(qMax(1, intervalMs)); }
+
+    void start();
+    void stop();
+    bool isRunning() const { return tickTimer.isActive(); }
+
+    // Runs everything due up to nowMs (scheduler time). Used by the internal tick, or directly
+    // when the scheduler is driven by an external clock.
+    void advanceTo(qint64 nowMs);
+    qint64 now() const { return currentMs; }
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+private slots:
+    void onTick();
+
+private:
+    struct Stream {
+        unsigned long PGN = 0;
+        StreamOptions options;
+        Generator generator;
+        qint64 idealDueMs = 0;
+        bool used = false;
+        bool enabled = true;
+    };
+
+    TimingWheel wheel;
+    std::vector<Stream> streams;
+    std::vector<tN2kMsg> batch;
+    int batchCount = 0;
+    int activeStreams = 0;
+    Sink messageSink;
+
+    QTimer tickTimer;
+    QElapsedTimer clock;
+    qint64 currentMs = 0;
+    qint64 tickStartMs = 0;
+    uint64_t jitterState = 0x9E3779B97F4A7C15ULL;
+
+    Statistics stats;
+    LatencyHistogram lateness;
+
+    void fire(TimingWheel::Handle handle, qint64 dueMs);
+    void scheduleNext(TimingWheel::Handle handle);
+    int nextJitter(int jitterMs);
+    tN2kMsg &nextBatchSlot();
+};
+
+#endif // PGNSCHEDULER_H
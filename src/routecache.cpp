@@ -0,0 +1,305 @@
+#include "routecache.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+enum Section {
+    Latitudes, Longitudes, NameIndex,
+    Ux, Uy, Uz, Cumulative,
+    LegLength, LegBearing, Nx, Ny, Nz, Tx, Ty, Tz,
+    NameOffsets, NameData,
+    SectionCount
+};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t sourceSize;
+    int64_t sourceMtimeMs;
+    uint64_t sourceHash;
+    double toleranceM;
+    uint64_t pointCount;
+    uint64_t nameCount;
+    uint64_t sectionOffset[SectionCount];
+    uint64_t sectionBytes[SectionCount];
+};
+
+constexpr char Magic[8] = {'R', 'N', 'S', 'R', 'O', 'U', 'T', 'E'};
+constexpr uint32_t ByteOrderMark = 0x01020304;
+
+constexpr uint64_t align8(uint64_t value)
+{
+    return (value + 7) & ~uint64_t(7);
+}
+
+inline uint64_t rotl(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const unsigned char *p)
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+QString &cacheDirectory()
+{
+    static QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/routes";
+    return directory;
+}
+
+template<typename T>
+void copySection(const uchar *base, const CacheHeader &header, Section section, std::vector<T> &out)
+{
+    out.resize(header.sectionBytes[section] / sizeof(T));
+    if (!out.empty()) {
+        std::memcpy(out.data(), base + header.sectionOffset[section], header.sectionBytes[section]);
+    }
+}
+
+} // namespace
+
+void RouteCache::setDirectory(const QString &directory)
+{
+    cacheDirectory() = directory;
+}
+
+QString RouteCache::directory()
+{
+    return cacheDirectory();
+}
+
+uint64_t RouteCache::hash64(const void *data, size_t length, uint64_t seed)
+{
+    // Four independent multiply-rotate lanes over 32 byte blocks (the xxHash64 round structure)
+    constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+    auto mix = [](uint64_t lane, uint64_t input) { return rotl(lane + input * P2, 31) * P1; };
+
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    const unsigned char *end = p + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        for (; end - p >= 32; p += 32) {
+            v1 = mix(v1, read64(p));
+            v2 = mix(v2, read64(p + 8));
+            v3 = mix(v3, read64(p + 16));
+            v4 = mix(v4, read64(p + 24));
+        }
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        for (uint64_t v : {v1, v2, v3, v4}) {
+            hash = (hash ^ mix(0, v)) * P1 + P4;
+        }
+    } else {
+        hash = seed + P5;
+    }
+
+    hash += static_cast<uint64_t>(length);
+    for (; end - p >= 8; p += 8) {
+        hash = rotl(hash ^ mix(0, read64(p)), 27) * P1 + P4;
+    }
+    for (; p < end; p++) {
+        hash = rotl(hash ^ (*p * P5), 11) * P1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= P2;
+    hash ^= hash >> 29;
+    hash *= P3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+QString RouteCache::cachePath(const QString &sourcePath, double toleranceM)
+{
+    QByteArray key = QFileInfo(sourcePath).absoluteFilePath().toUtf8();
+    key.append(reinterpret_cast<const char *>(&toleranceM), sizeof(toleranceM));
+    return cacheDirectory() + "/" + QString::number(hash64(key.constData(), static_cast<size_t>(key.size())), 16) + ".rnsroute";
+}
+
+bool RouteCache::load(const QString &sourcePath, double toleranceM, RouteData &route, RouteGeometry &geometry)
+{
+    QFileInfo source(sourcePath);
+    QFile cache(cachePath(sourcePath, toleranceM));
+    if (!source.exists() || !cache.open(QIODevice::ReadOnly) || cache.size() < static_cast<qint64>(sizeof(CacheHeader))) {
+        return false;
+    }
+    const uchar *base = cache.map(0, cache.size());
+    if (!base) {
+        return false;
+    }
+
+    // Cheap checks first, the source is only hashed when everything else matches
+    CacheHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != FormatVersion
+        || header.byteOrder != ByteOrderMark || header.sourceSize != static_cast<uint64_t>(source.size())
+        || header.sourceMtimeMs != source.lastModified().toMSecsSinceEpoch() || header.toleranceM != toleranceM) {
+        return false;
+    }
+
+    const uint64_t points = header.pointCount;
+    const uint64_t legs = points > 0 ? points - 1 : 0;
+    const uint64_t expected[SectionCount] = {
+        points * 8, points * 8, points * 4,
+        points * 8, points * 8, points * 8, points * 8,
+        legs * 8, legs * 8, legs * 8, legs * 8, legs * 8, legs * 8, legs * 8, legs * 8,
+        (header.nameCount + 1) * 4, header.sectionBytes[NameData]};
+    // Compared without adding offset and length, a crafted header cannot wrap the sum past the size
+    const uint64_t size = static_cast<uint64_t>(cache.size());
+    for (int section = 0; section < SectionCount; section++) {
+        if (header.sectionBytes[section] != expected[section] || header.sectionOffset[section] > size
+            || header.sectionBytes[section] > size - header.sectionOffset[section]) {
+            return false;
+        }
+    }
+
+    QFile sourceFile(sourcePath);
+    if (!sourceFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const uchar *sourceData = sourceFile.size() > 0 ? sourceFile.map(0, sourceFile.size()) : nullptr;
+    QByteArray sourceBytes;
+    if (!sourceData) {
+        sourceBytes = sourceFile.readAll();
+        sourceData = reinterpret_cast<const uchar *>(sourceBytes.constData());
+    }
+    if (hash64(sourceData, static_cast<size_t>(sourceFile.size())) != header.sourceHash) {
+        return false;
+    }
+
+    route.clear();
+    copySection(base, header, Latitudes, route.latitudes);
+    copySection(base, header, Longitudes, route.longitudes);
+    copySection(base, header, NameIndex, route.nameIndex);
+
+    std::vector<uint32_t> nameOffsets;
+    copySection(base, header, NameOffsets, nameOffsets);
+    const char *nameData = reinterpret_cast<const char *>(base + header.sectionOffset[NameData]);
+    for (uint64_t i = 0; i < header.nameCount; i++) {
+        if (nameOffsets[i] > nameOffsets[i + 1] || nameOffsets[i + 1] > header.sectionBytes[NameData]) {
+            route.clear();
+            return false;
+        }
+        route.names.append(QString::fromUtf8(nameData + nameOffsets[i], static_cast<int>(nameOffsets[i + 1] - nameOffsets[i])));
+    }
+    // RouteData::nameAt indexes names without checking
+    for (int32_t name : route.nameIndex) {
+        if (name < -1 || name >= route.names.size()) {
+            route.clear();
+            return false;
+        }
+    }
+
+    geometry.clear();
+    copySection(base, header, Ux, geometry.ux);
+    copySection(base, header, Uy, geometry.uy);
+    copySection(base, header, Uz, geometry.uz);
+    copySection(base, header, Cumulative, geometry.cumulative);
+    copySection(base, header, LegLength, geometry.legLength);
+    copySection(base, header, LegBearing, geometry.legBearing);
+    copySection(base, header, Nx, geometry.nx);
+    copySection(base, header, Ny, geometry.ny);
+    copySection(base, header, Nz, geometry.nz);
+    copySection(base, header, Tx, geometry.tx);
+    copySection(base, header, Ty, geometry.ty);
+    copySection(base, header, Tz, geometry.tz);
+    return true;
+}
+
+bool RouteCache::store(const QString &sourcePath, double toleranceM, const RouteData &route, const RouteGeometry &geometry)
+{
+    QFileInfo source(sourcePath);
+    QFile sourceFile(sourcePath);
+    if (!sourceFile.open(QIODevice::ReadOnly) || !QDir().mkpath(cacheDirectory())) {
+        return false;
+    }
+    const uchar *sourceData = sourceFile.size() > 0 ? sourceFile.map(0, sourceFile.size()) : nullptr;
+    QByteArray sourceBytes;
+    if (!sourceData) {
+        sourceBytes = sourceFile.readAll();
+        sourceData = reinterpret_cast<const uchar *>(sourceBytes.constData());
+    }
+
+    std::vector<uint32_t> nameOffsets;
+    QByteArray nameData;
+    nameOffsets.reserve(route.names.size() + 1);
+    for (const QString &name : route.names) {
+        nameOffsets.push_back(static_cast<uint32_t>(nameData.size()));
+        nameData.append(name.toUtf8());
+    }
+    nameOffsets.push_back(static_cast<uint32_t>(nameData.size()));
+
+    const void *sections[SectionCount] = {
+        route.latitudes.data(), route.longitudes.data(), route.nameIndex.data(),
+        geometry.ux.data(), geometry.uy.data(), geometry.uz.data(), geometry.cumulative.data(),
+        geometry.legLength.data(), geometry.legBearing.data(), geometry.nx.data(), geometry.ny.data(), geometry.nz.data(),
+        geometry.tx.data(), geometry.ty.data(), geometry.tz.data(),
+        nameOffsets.data(), nameData.constData()};
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    header.byteOrder = ByteOrderMark;
+    header.sourceSize = static_cast<uint64_t>(source.size());
+    header.sourceMtimeMs = source.lastModified().toMSecsSinceEpoch();
+    header.sourceHash = hash64(sourceData, static_cast<size_t>(sourceFile.size()));
+    header.toleranceM = toleranceM;
+    header.pointCount = route.size();
+    header.nameCount = static_cast<uint64_t>(route.names.size());
+    header.sectionBytes[Latitudes] = route.latitudes.size() * sizeof(double);
+    header.sectionBytes[Longitudes] = route.longitudes.size() * sizeof(double);
+    header.sectionBytes[NameIndex] = route.nameIndex.size() * sizeof(int32_t);
+    header.sectionBytes[Ux] = geometry.ux.size() * sizeof(double);
+    header.sectionBytes[Uy] = geometry.uy.size() * sizeof(double);
+    header.sectionBytes[Uz] = geometry.uz.size() * sizeof(double);
+    header.sectionBytes[Cumulative] = geometry.cumulative.size() * sizeof(double);
+    header.sectionBytes[LegLength] = geometry.legLength.size() * sizeof(double);
+    header.sectionBytes[LegBearing] = geometry.legBearing.size() * sizeof(double);
+    header.sectionBytes[Nx] = geometry.nx.size() * sizeof(double);
+    header.sectionBytes[Ny] = geometry.ny.size() * sizeof(double);
+    header.sectionBytes[Nz] = geometry.nz.size() * sizeof(double);
+    header.sectionBytes[Tx] = geometry.tx.size() * sizeof(double);
+    header.sectionBytes[Ty] = geometry.ty.size() * sizeof(double);
+    header.sectionBytes[Tz] = geometry.tz.size() * sizeof(double);
+    header.sectionBytes[NameOffsets] = nameOffsets.size() * sizeof(uint32_t);
+    header.sectionBytes[NameData] = static_cast<uint64_t>(nameData.size());
+
+    uint64_t offset = align8(sizeof(CacheHeader));
+    for (int section = 0; section < SectionCount; section++) {
+        header.sectionOffset[section] = offset;
+        offset = align8(offset + header.sectionBytes[section]);
+    }
+
+    // Written aside and renamed, so readers never see a partial file
+    QSaveFile file(cachePath(sourcePath, toleranceM));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    static const char padding[8] = {};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(padding, static_cast<qint64>(align8(sizeof(header)) - sizeof(header)));
+    for (int section = 0; section < SectionCount; section++) {
+        const uint64_t bytes = header.sectionBytes[section];
+        if (bytes > 0) {
+            file.write(static_cast<const char *>(sections[section]), static_cast<qint64>(bytes));
+        }
+        file.write(padding, static_cast<qint64>(align8(bytes) - bytes));
+    }
+    return file.commit();
+}
@@ -0,0 +1,32 @@
+#ifndef ROUTECACHE_H
+#define ROUTECACHE_H
+
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include "routegeometry.h"
+#include "routeloader.h"
+
+// On-disk cache of compiled routes. A cache file holds the packed point columns, the RouteGeometry
+// leg table and the interned names as 8 byte aligned sections behind a fixed header, so it can be
+// mapped and read without parsing. An entry is only used when the source file's size, mtime and
+// 64-bit content hash, the simplification tolerance and the format version all match.
+class RouteCache
+{
+public:
+    static constexpr uint32_t FormatVersion = 1;
+
+    // Cache directory, defaults to <cache location>/routes
+    static void setDirectory(const QString &directory);
+    static QString directory();
+
+    static bool load(const QString &sourcePath, double toleranceM, RouteData &route, RouteGeometry &geometry);
+    static bool store(const QString &sourcePath, double toleranceM, const RouteData &route, const RouteGeometry &geometry);
+
+    static uint64_t hash64(const void *data, size_t length, uint64_t seed = 0);
+
+private:
+    static QString cachePath(const QString &sourcePath, double toleranceM);
+};
+
+#endif // ROUTECACHE_H
@@ -0,0 +1,134 @@
+#include "routegeometry.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Bearing of direction (dx, dy, dz) at the unit vector (px, py, pz), radians in [0, 2 pi)
+double bearingAt(double px, double py, double pz, double dx, double dy, double dz)
+{
+    // Local east and north unit vectors, undefined exactly at the poles
+    double horizontal = std::max(std::hypot(px, py), 1e-15);
+    double east = (px * dy - py * dx) / horizontal;
+    double north = horizontal * dz - pz * (px * dx + py * dy) / horizontal;
+    double bearing = std::atan2(east, north);
+    return bearing < 0.0 ? bearing + 2.0 * M_PI : bearing;
+}
+
+} // namespace
+
+void RouteGeometry::clear()
+{
+    for (std::vector<double> *column : {&ux, &uy, &uz, &cumulative, &legLength, &legBearing, &nx, &ny, &nz, &tx, &ty, &tz}) {
+        column->clear();
+    }
+}
+
+void RouteGeometry::compile(const double *latitudes, const double *longitudes, size_t count)
+{
+    clear();
+    ux.reserve(count);
+    uy.reserve(count);
+    uz.reserve(count);
+    cumulative.reserve(count);
+    const size_t legs = count > 0 ? count - 1 : 0;
+    for (std::vector<double> *column : {&legLength, &legBearing, &nx, &ny, &nz, &tx, &ty, &tz}) {
+        column->reserve(legs);
+    }
+    for (size_t i = 0; i < count; i++) {
+        append(latitudes[i], longitudes[i]);
+    }
+}
+
+void RouteGeometry::append(double latitude, double longitude)
+{
+    double lat = qDegreesToRadians(latitude);
+    double lon = qDegreesToRadians(longitude);
+    double x = std::cos(lat) * std::cos(lon);
+    double y = std::cos(lat) * std::sin(lon);
+    double z = std::sin(lat);
+
+    if (ux.empty()) {
+        ux.push_back(x);
+        uy.push_back(y);
+        uz.push_back(z);
+        cumulative.push_back(0.0);
+        return;
+    }
+
+    double ax = ux.back(), ay = uy.back(), az = uz.back();
+    double cx = ay * z - az * y;
+    double cy = az * x - ax * z;
+    double cz = ax * y - ay * x;
+    double sinAngle = std::sqrt(cx * cx + cy * cy + cz * cz);
+    double angle = std::atan2(sinAngle, ax * x + ay * y + az * z);
+
+    // Coincident waypoints give a zero length leg without a plane
+    double inv = sinAngle > 0.0 ? 1.0 / sinAngle : 0.0;
+    cx *= inv;
+    cy *= inv;
+    cz *= inv;
+    double txl = cy * az - cz * ay;
+    double tyl = cz * ax - cx * az;
+    double tzl = cx * ay - cy * ax;
+
+    legLength.push_back(angle * EarthRadiusM);
+    legBearing.push_back(sinAngle > 0.0 ? bearingAt(ax, ay, az, txl, tyl, tzl) : 0.0);
+    nx.push_back(cx);
+    ny.push_back(cy);
+    nz.push_back(cz);
+    tx.push_back(txl);
+    ty.push_back(tyl);
+    tz.push_back(tzl);
+    cumulative.push_back(cumulative.back() + legLength.back());
+
+    ux.push_back(x);
+    uy.push_back(y);
+    uz.push_back(z);
+}
+
+int RouteGeometry::legAt(double distanceM) const
+{
+    if (legLength.empty()) {
+        return -1;
+    }
+    // cumulative[i] is the start of leg i, the last entry the route end
+    auto it = std::upper_bound(cumulative.begin(), cumulative.end() - 1, distanceM);
+    int leg = static_cast<int>(it - cumulative.begin()) - 1;
+    return qBound(0, leg, legCount() - 1);
+}
+
+RouteGeometry::Point RouteGeometry::pointAt(int leg, double distanceM) const
+{
+    double angle = qBound(0.0, distanceM, legLength[leg]) / EarthRadiusM;
+    double c = std::cos(angle);
+    double s = std::sin(angle);
+
+    // Rotate the start point towards the end within the leg plane
+    double px = ux[leg] * c + tx[leg] * s;
+    double py = uy[leg] * c + ty[leg] * s;
+    double pz = uz[leg] * c + tz[leg] * s;
+    double dx = tx[leg] * c - ux[leg] * s;
+    double dy = ty[leg] * c - uy[leg] * s;
+    double dz = tz[leg] * c - uz[leg] * s;
+
+    Point point;
+    point.latitude = qRadiansToDegrees(std::atan2(pz, std::hypot(px, py)));
+    point.longitude = qRadiansToDegrees(std::atan2(py, px));
+    point.bearing = legLength[leg] > 0.0 ? bearingAt(px, py, pz, dx, dy, dz) : 0.0;
+    return point;
+}
+
+double RouteGeometry::crossTrackM(int leg, double latitude, double longitude) const
+{
+    double lat = qDegreesToRadians(latitude);
+    double lon = qDegreesToRadians(longitude);
+    double x = std::cos(lat) * std::cos(lon);
+    double y = std::cos(lat) * std::sin(lon);
+    double z = std::sin(lat);
+
+    // The normal points left of the direction of travel
+    double side = x * nx[leg] + y * ny[leg] + z * nz[leg];
+    return -std::asin(qBound(-1.0, side, 1.0)) * EarthRadiusM;
+}
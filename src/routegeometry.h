@@ -0,0 +1,54 @@
+#ifndef ROUTEGEOMETRY_H
+#define ROUTEGEOMETRY_H
+
+#include <vector>
+#include "geodesy.h"
+
+// Route compiled once on load into a structure of arrays: waypoint unit vectors in ECEF, and per leg
+// the length, initial bearing, cumulative distance, great circle normal and start tangent. Positions
+// along a leg are then a rotation in the leg plane and the cross track error a single dot product,
+// instead of QGeoCoordinate's spherical trig on every tick. Same spherical earth as QGeoCoordinate.
+class RouteGeometry
+{
+public:
+    static constexpr double EarthRadiusM = Geodesy::EarthRadiusM;
+
+    struct Point {
+        double latitude;    // degrees
+        double longitude;   // degrees
+        double bearing;     // radians, direction of travel along the leg
+    };
+
+    void compile(const double *latitudes, const double *longitudes, size_t count);
+    void clear();
+    // Adds a waypoint (degrees) and the leg to it from the previous one
+    void append(double latitude, double longitude);
+
+    int waypointCount() const { return static_cast<int>(ux.size()); }
+    int legCount() const { return static_cast<int>(legLength.size()); }
+    double length(int leg) const { return legLength[leg]; }
+    double initialBearing(int leg) const { return legBearing[leg]; }
+    // Distance from the first waypoint to the start of the leg; cumulativeDistance(legCount()) is the total
+    double cumulativeDistance(int leg) const { return cumulative[leg]; }
+    double totalLength() const { return cumulative.empty() ? 0.0 : cumulative.back(); }
+
+    // Leg containing the given distance from the first waypoint, clamped to the route
+    int legAt(double distanceM) const;
+    // Point at distanceM from the start of the leg, clamped to the leg
+    Point pointAt(int leg, double distanceM) const;
+    // Positive right of the leg when travelling from its start to its end, meters
+    double crossTrackM(int leg, double latitude, double longitude) const;
+
+private:
+    friend class RouteCache;
+
+    // Per waypoint
+    std::vector<double> ux, uy, uz;
+    std::vector<double> cumulative;
+    // Per leg
+    std::vector<double> legLength, legBearing;
+    std::vector<double> nx, ny, nz;
+    std::vector<double> tx, ty, tz;
+};
+
+#endif // ROUTEGEOMETRY_H
@@ -0,0 +1,478 @@
+#include "routeloader.h"
+#include <QFile>
+#include <QHash>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+void RouteData::clear()
+{
+    latitudes.clear();
+    longitudes.clear();
+    nameIndex.clear();
+    names.clear();
+}
+
+void RouteData::reserve(size_t count)
+{
+    latitudes.reserve(count);
+    longitudes.reserve(count);
+    nameIndex.reserve(count);
+}
+
+void RouteData::append(double latitude, double longitude, int32_t name)
+{
+    latitudes.push_back(latitude);
+    longitudes.push_back(longitude);
+    nameIndex.push_back(name);
+}
+
+size_t RouteData::memoryBytes() const
+{
+    size_t bytes = latitudes.capacity() * sizeof(double) + longitudes.capacity() * sizeof(double)
+                   + nameIndex.capacity() * sizeof(int32_t);
+    for (const QString &name : names) {
+        bytes += name.capacity() * sizeof(QChar);
+    }
+    return bytes;
+}
+
+namespace {
+
+struct Tag {
+    const char *name;
+    size_t nameLength;
+    const char *attributes;
+    const char *attributesEnd;
+    bool closing;
+    bool selfClosing;
+
+    bool is(const char *other, size_t otherLength) const
+    {
+        return nameLength == otherLength && std::memcmp(name, other, otherLength) == 0;
+    }
+};
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+const char *find(const char *p, const char *end, const char *needle, size_t needleLength)
+{
+    while (p < end) {
+        p = static_cast<const char *>(std::memchr(p, needle[0], end - p));
+        if (!p || static_cast<size_t>(end - p) < needleLength) {
+            return nullptr;
+        }
+        if (std::memcmp(p, needle, needleLength) == 0) {
+            return p;
+        }
+        p++;
+    }
+    return nullptr;
+}
+
+// Next element tag at or after p, skipping comments, declarations and processing instructions.
+// Namespace prefixes are dropped from the name.
+bool nextTag(const char *&p, const char *end, Tag &tag)
+{
+    while (p < end) {
+        p = static_cast<const char *>(std::memchr(p, '<', end - p));
+        if (!p || p + 1 >= end) {
+            return false;
+        }
+        if (p[1] == '!' || p[1] == '?') {
+            const char *close = (end - p >= 4 && std::memcmp(p, "<!--", 4) == 0) ? find(p + 4, end, "-->", 3)
+                                                                                   : static_cast<const char *>(std::memchr(p, '>', end - p));
+            if (!close) {
+                return false;
+            }
+            p = close + 1;
+            continue;
+        }
+
+        const char *q = p + 1;
+        tag.closing = *q == '/';
+        if (tag.closing) {
+            q++;
+        }
+        const char *nameBegin = q;
+        while (q < end && !isSpace(*q) && *q != '>' && *q != '/') {
+            if (*q == ':') {
+                nameBegin = q + 1;
+            }
+            q++;
+        }
+        const char *gt = static_cast<const char *>(std::memchr(q, '>', end - q));
+        if (!gt) {
+            return false;
+        }
+        tag.name = nameBegin;
+        tag.nameLength = static_cast<size_t>(q - nameBegin);
+        tag.attributes = q;
+        tag.attributesEnd = gt;
+        tag.selfClosing = gt > q && gt[-1] == '/';
+        p = gt + 1;
+        return true;
+    }
+    return false;
+}
+
+bool attribute(const Tag &tag, const char *name, size_t nameLength, const char *&value, const char *&valueEnd)
+{
+    const char *p = tag.attributes;
+    const char *end = tag.attributesEnd;
+    while (p < end) {
+        while (p < end && isSpace(*p)) {
+            p++;
+        }
+        const char *nameBegin = p;
+        while (p < end && *p != '=' && !isSpace(*p)) {
+            p++;
+        }
+        const char *nameEnd = p;
+        while (p < end && (isSpace(*p) || *p == '=')) {
+            p++;
+        }
+        if (p >= end || (*p != '"' && *p != '\'')) {
+            return false;
+        }
+        const char quote = *p++;
+        const char *close = static_cast<const char *>(std::memchr(p, quote, end - p));
+        if (!close) {
+            return false;
+        }
+        if (static_cast<size_t>(nameEnd - nameBegin) == nameLength && std::memcmp(nameBegin, name, nameLength) == 0) {
+            value = p;
+            valueEnd = close;
+            return true;
+        }
+        p = close + 1;
+    }
+    return false;
+}
+
+bool parseDouble(const char *&p, const char *end, double &value)
+{
+    if (p < end && *p == '+') {
+        p++;
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    p = result.ptr;
+    return true;
+#else
+    // Numbers in these files are short, copy into a terminated buffer for strtod
+    char buffer[64];
+    size_t length = 0;
+    while (p + length < end && length < sizeof(buffer) - 1 && std::strchr("0123456789+-.eE", p[length])) {
+        length++;
+    }
+    std::memcpy(buffer, p, length);
+    buffer[length] = '\0';
+    char *parsedEnd;
+    value = std::strtod(buffer, &parsedEnd);
+    if (parsedEnd == buffer) {
+        return false;
+    }
+    p += parsedEnd - buffer;
+    return true;
+#endif
+}
+
+bool attributeDouble(const Tag &tag, const char *name, size_t nameLength, double &value)
+{
+    const char *p, *end;
+    if (!attribute(tag, name, nameLength, p, end)) {
+        return false;
+    }
+    while (p < end && isSpace(*p)) {
+        p++;
+    }
+    return parseDouble(p, end, value);
+}
+
+// Interns element text (CDATA and the predefined entities handled) into route.names
+class NameTable
+{
+public:
+    explicit NameTable(RouteData &route) : route(route) {}
+
+    // Reads the text content at p, leaves p at the following '<'
+    int32_t read(const char *&p, const char *end)
+    {
+        text.clear();
+        while (p < end) {
+            if (*p == '<') {
+                if (end - p >= 9 && std::memcmp(p, "<![CDATA[", 9) == 0) {
+                    const char *close = find(p + 9, end, "]]>", 3);
+                    if (!close) {
+                        break;
+                    }
+                    text.append(p + 9, close);
+                    p = close + 3;
+                    continue;
+                }
+                break;
+            }
+            if (*p == '&') {
+                p = decodeEntity(p, end);
+                continue;
+            }
+            text.push_back(*p++);
+        }
+
+        size_t first = 0;
+        size_t last = text.size();
+        while (first < last && isSpace(text[first])) {
+            first++;
+        }
+        while (last > first && isSpace(text[last - 1])) {
+            last--;
+        }
+        if (first == last) {
+            return -1;
+        }
+
+        QByteArray key = QByteArray::fromRawData(text.data() + first, static_cast<int>(last - first));
+        auto existing = index.constFind(key);
+        if (existing != index.constEnd()) {
+            return existing.value();
+        }
+        int32_t id = static_cast<int32_t>(route.names.size());
+        QByteArray owned(key.constData(), key.size());
+        route.names.append(QString::fromUtf8(owned));
+        index.insert(owned, id);
+        return id;
+    }
+
+private:
+    RouteData &route;
+    QHash<QByteArray, int32_t> index;
+    std::string text;
+
+    const char *decodeEntity(const char *p, const char *end)
+    {
+        static const struct { const char *entity; size_t length; char value; } entities[] = {
+            {"&amp;", 5, '&'}, {"&lt;", 4, '<'}, {"&gt;", 4, '>'}, {"&quot;", 6, '"'}, {"&apos;", 6, '\''}};
+        for (const auto &e : entities) {
+            if (static_cast<size_t>(end - p) >= e.length && std::memcmp(p, e.entity, e.length) == 0) {
+                text.push_back(e.value);
+                return p + e.length;
+            }
+        }
+        text.push_back('&');
+        return p + 1;
+    }
+};
+
+enum PointKind : uint8_t { WaypointKind, RoutePointKind, TrackPointKind };
+// KML coordinates by the geometry they belong to, richest last
+enum GeometryKind : uint8_t { OtherGeometry, PointGeometry, LineGeometry };
+
+// Drops every point whose kind is not keep, in place
+void keepOnly(RouteData &route, const std::vector<uint8_t> &kinds, uint8_t keep)
+{
+    size_t out = 0;
+    for (size_t i = 0; i < route.size(); i++) {
+        if (kinds[i] == keep) {
+            route.latitudes[out] = route.latitudes[i];
+            route.longitudes[out] = route.longitudes[i];
+            route.nameIndex[out] = route.nameIndex[i];
+            out++;
+        }
+    }
+    route.latitudes.resize(out);
+    route.longitudes.resize(out);
+    route.nameIndex.resize(out);
+}
+
+} // namespace
+
+bool RouteLoader::load(const QString &filePath, RouteData &route, QString *errorMessage)
+{
+    route.clear();
+
+    const bool kml = filePath.endsWith(".kml", Qt::CaseInsensitive);
+    if (!kml && !filePath.endsWith(".gpx", Qt::CaseInsensitive)) {
+        if (errorMessage) {
+            *errorMessage = "Unsupported file format: " + filePath;
+        }
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) {
+            *errorMessage = "Unable to open file: " + filePath;
+        }
+        return false;
+    }
+
+    // The mapping is released with the file; names are copied out while parsing
+    const qint64 size = file.size();
+    const uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    QByteArray fallback;
+    const char *data = reinterpret_cast<const char *>(mapped);
+    if (!mapped) {
+        fallback = file.readAll();
+        data = fallback.constData();
+    }
+
+    bool parsed = kml ? parseKml(data, static_cast<size_t>(size), route) : parseGpx(data, static_cast<size_t>(size), route);
+    if (!parsed && errorMessage) {
+        *errorMessage = "No route points found in " + filePath;
+    }
+    return parsed;
+}
+
+bool RouteLoader::parseGpx(const char *data, size_t length, RouteData &route)
+{
+    route.clear();
+    const char *p = data;
+    const char *end = data + length;
+    NameTable nameTable(route);
+    std::vector<uint8_t> kinds;
+    int kindCount[3] = {0, 0, 0};
+
+    Tag tag;
+    while (nextTag(p, end, tag)) {
+        if (tag.closing) {
+            continue;
+        }
+        PointKind kind;
+        if (tag.is("trkpt", 5)) {
+            kind = TrackPointKind;
+        } else if (tag.is("rtept", 5)) {
+            kind = RoutePointKind;
+        } else if (tag.is("wpt", 3)) {
+            kind = WaypointKind;
+        } else {
+            continue;
+        }
+
+        double latitude, longitude;
+        bool valid = attributeDouble(tag, "lat", 3, latitude) && attributeDouble(tag, "lon", 3, longitude);
+
+        // Only the point's own <name> counts, extensions and other children are skipped
+        int32_t name = -1;
+        if (!tag.selfClosing) {
+            Tag child;
+            while (nextTag(p, end, child)) {
+                if (child.closing && child.nameLength == tag.nameLength && std::memcmp(child.name, tag.name, tag.nameLength) == 0) {
+                    break;
+                }
+                if (!child.closing && !child.selfClosing && child.is("name", 4)) {
+                    name = nameTable.read(p, end);
+                }
+            }
+        }
+
+        if (valid) {
+            route.append(latitude, longitude, name);
+            kinds.push_back(kind);
+            kindCount[kind]++;
+        }
+    }
+
+    // Keep only the richest kind, in place
+    PointKind keep = kindCount[TrackPointKind] ? TrackPointKind : (kindCount[RoutePointKind] ? RoutePointKind : WaypointKind);
+    if (kindCount[keep] != static_cast<int>(route.size())) {
+        keepOnly(route, kinds, keep);
+    }
+    route.latitudes.shrink_to_fit();
+    route.longitudes.shrink_to_fit();
+    route.nameIndex.shrink_to_fit();
+    return !route.isEmpty();
+}
+
+bool RouteLoader::parseKml(const char *data, size_t length, RouteData &route)
+{
+    route.clear();
+    const char *p = data;
+    const char *end = data + length;
+    NameTable nameTable(route);
+    std::vector<uint8_t> kinds;
+    int kindCount[3] = {0, 0, 0};
+
+    bool inPlacemark = false;
+    int32_t placemarkName = -1;
+    long long placemarkFirstPoint = -1;
+    GeometryKind geometry = OtherGeometry;
+
+    Tag tag;
+    while (nextTag(p, end, tag)) {
+        if (tag.is("Placemark", 9)) {
+            inPlacemark = !tag.closing && !tag.selfClosing;
+            placemarkName = -1;
+            placemarkFirstPoint = -1;
+            geometry = OtherGeometry;
+            continue;
+        }
+        if (tag.is("LineString", 10) || tag.is("Point", 5)) {
+            const GeometryKind kind = tag.is("Point", 5) ? PointGeometry : LineGeometry;
+            geometry = tag.closing || tag.selfClosing ? OtherGeometry : kind;
+            continue;
+        }
+        if (tag.closing || tag.selfClosing || !inPlacemark) {
+            continue;
+        }
+
+        if (tag.is("name", 4)) {
+            placemarkName = nameTable.read(p, end);
+            // A name after the geometry still labels the placemark's first point
+            if (placemarkFirstPoint >= 0 && route.nameIndex[placemarkFirstPoint] < 0) {
+                route.nameIndex[placemarkFirstPoint] = placemarkName;
+            }
+        } else if (tag.is("coordinates", 11)) {
+            // Whitespace separated lon,lat[,alt] tuples
+            const char *textEnd = static_cast<const char *>(std::memchr(p, '<', end - p));
+            if (!textEnd) {
+                textEnd = end;
+            }
+            while (p < textEnd) {
+                while (p < textEnd && isSpace(*p)) {
+                    p++;
+                }
+                if (p >= textEnd) {
+                    break;
+                }
+                double longitude, latitude;
+                bool valid = parseDouble(p, textEnd, longitude) && p < textEnd && *p == ',';
+                if (valid) {
+                    p++;
+                    valid = parseDouble(p, textEnd, latitude);
+                }
+                if (valid) {
+                    if (placemarkFirstPoint < 0) {
+                        placemarkFirstPoint = static_cast<long long>(route.size());
+                        route.append(latitude, longitude, placemarkName);
+                    } else {
+                        route.append(latitude, longitude);
+                    }
+                    kinds.push_back(geometry);
+                    kindCount[geometry]++;
+                }
+                // Skip altitude or anything malformed up to the next tuple
+                while (p < textEnd && !isSpace(*p)) {
+                    p++;
+                }
+            }
+        }
+    }
+
+    // LineString tracks win over Point pins, which win over anything else (polygon rings)
+    GeometryKind keep = kindCount[LineGeometry] ? LineGeometry : (kindCount[PointGeometry] ? PointGeometry : OtherGeometry);
+    if (kindCount[keep] != static_cast<int>(route.size())) {
+        keepOnly(route, kinds, keep);
+    }
+    route.latitudes.shrink_to_fit();
+    route.longitudes.shrink_to_fit();
+    route.nameIndex.shrink_to_fit();
+    return !route.isEmpty();
+}
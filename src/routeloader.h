@@ -0,0 +1,39 @@
+#ifndef ROUTELOADER_H
+#define ROUTELOADER_H
+
+#include <QString>
+#include <QStringList>
+#include <cstdint>
+#include <vector>
+
+// Route points as compact columns. Names are interned: each point refers to an entry of names
+// (or -1), so a million unnamed track points cost 20 bytes each and no QString.
+struct RouteData {
+    std::vector<double> latitudes;   // degrees
+    std::vector<double> longitudes;  // degrees
+    std::vector<int32_t> nameIndex;
+    QStringList names;
+
+    size_t size() const { return latitudes.size(); }
+    bool isEmpty() const { return latitudes.empty(); }
+    void clear();
+    void reserve(size_t count);
+    void append(double latitude, double longitude, int32_t name = -1);
+    QString nameAt(size_t index) const { return nameIndex[index] >= 0 ? names[nameIndex[index]] : QString(); }
+    size_t memoryBytes() const;
+};
+
+// Loads GPX (trkpt, rtept, wpt) and KML (the tuples of every <coordinates> in a Placemark) from a
+// memory-mapped file. Tags are matched on raw bytes and numbers parsed with std::from_chars, nothing
+// is copied except interned names. The richest point kind wins: for GPX track points, else route
+// points, else waypoints; for KML LineString coordinates, else Point pins, else other geometry.
+class RouteLoader
+{
+public:
+    static bool load(const QString &filePath, RouteData &route, QString *errorMessage = nullptr);
+
+    static bool parseGpx(const char *data, size_t length, RouteData &route);
+    static bool parseKml(const char *data, size_t length, RouteData &route);
+};
+
+#endif // ROUTELOADER_H
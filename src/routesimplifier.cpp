@@ -0,0 +1,129 @@
+#include "routesimplifier.h"
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <QtMath>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "geodesy.h"
+
+RouteSimplifier::Result RouteSimplifier::simplify(RouteData &route, double toleranceM, bool keepNamedPoints)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Result result;
+    result.pointsBefore = route.size();
+    if (route.size() < 3 || toleranceM <= 0.0) {
+        result.pointsAfter = route.size();
+        return result;
+    }
+
+    // Each chunk marks its own first point and interior, the route's last point is always kept
+    std::vector<unsigned char> keep(route.size(), 0);
+    keep.back() = 1;
+
+    std::vector<std::pair<size_t, size_t>> chunks;
+    for (size_t first = 0; first + 1 < route.size(); first += ChunkSize) {
+        chunks.emplace_back(first, qMin(first + ChunkSize, route.size() - 1));
+    }
+
+    auto runChunk = [&](const std::pair<size_t, size_t> &chunk) {
+        simplifyRange(route, chunk.first, chunk.second, toleranceM, keepNamedPoints, keep.data());
+    };
+    if (chunks.size() > 1) {
+        QtConcurrent::blockingMap(chunks, runChunk);
+    } else {
+        runChunk(chunks.front());
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < route.size(); i++) {
+        if (keep[i]) {
+            route.latitudes[out] = route.latitudes[i];
+            route.longitudes[out] = route.longitudes[i];
+            route.nameIndex[out] = route.nameIndex[i];
+            out++;
+        }
+    }
+    route.latitudes.resize(out);
+    route.longitudes.resize(out);
+    route.nameIndex.resize(out);
+    route.latitudes.shrink_to_fit();
+    route.longitudes.shrink_to_fit();
+    route.nameIndex.shrink_to_fit();
+
+    result.pointsAfter = out;
+    result.elapsedMs = timer.nsecsElapsed() / 1e6;
+    return result;
+}
+
+void RouteSimplifier::simplifyRange(const RouteData &route, size_t first, size_t last, double toleranceM,
+                                    bool keepNamedPoints, unsigned char *keep)
+{
+    // Equirectangular projection around the chunk's first point, meters
+    const size_t count = last - first + 1;
+    const double degToM = Geodesy::EarthRadiusM * M_PI / 180.0;
+    const double scaleX = degToM * std::cos(route.latitudes[first] * M_PI / 180.0);
+    const double lon0 = route.longitudes[first];
+    const double lat0 = route.latitudes[first];
+    std::vector<double> x(count), y(count);
+    for (size_t i = 0; i < count; i++) {
+        double dLon = route.longitudes[first + i] - lon0;
+        dLon -= 360.0 * std::floor((dLon + 180.0) / 360.0);
+        x[i] = dLon * scaleX;
+        y[i] = (route.latitudes[first + i] - lat0) * degToM;
+    }
+
+    // Forced points split the chunk into independent spans
+    std::vector<size_t> anchors;
+    anchors.push_back(0);
+    if (keepNamedPoints) {
+        for (size_t i = 1; i + 1 < count; i++) {
+            if (route.nameIndex[first + i] >= 0) {
+                anchors.push_back(i);
+            }
+        }
+    }
+    anchors.push_back(count - 1);
+
+    const double tolerance2 = toleranceM * toleranceM;
+    std::vector<std::pair<size_t, size_t>> stack;
+    for (size_t a = 0; a + 1 < anchors.size(); a++) {
+        keep[first + anchors[a]] = 1;
+        stack.emplace_back(anchors[a], anchors[a + 1]);
+
+        while (!stack.empty()) {
+            auto [start, end] = stack.back();
+            stack.pop_back();
+            if (end - start < 2) {
+                continue;
+            }
+
+            // Farthest point from the segment start -> end
+            const double dx = x[end] - x[start];
+            const double dy = y[end] - y[start];
+            const double length2 = dx * dx + dy * dy;
+            double farthest2 = -1.0;
+            size_t farthest = start;
+            for (size_t i = start + 1; i < end; i++) {
+                double px = x[i] - x[start];
+                double py = y[i] - y[start];
+                double t = length2 > 0.0 ? qBound(0.0, (px * dx + py * dy) / length2, 1.0) : 0.0;
+                double ex = px - t * dx;
+                double ey = py - t * dy;
+                double distance2 = ex * ex + ey * ey;
+                if (distance2 > farthest2) {
+                    farthest2 = distance2;
+                    farthest = i;
+                }
+            }
+
+            if (farthest2 > tolerance2) {
+                keep[first + farthest] = 1;
+                stack.emplace_back(start, farthest);
+                stack.emplace_back(farthest, end);
+            }
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef ROUTESIMPLIFIER_H
+#define ROUTESIMPLIFIER_H
+
+#include <cstddef>
+#include "routeloader.h"
+
+// Douglas-Peucker simplification of a loaded route with a tolerance in meters. Points are projected
+// to a local plane per chunk; long routes are split into chunks simplified in parallel, with the
+// chunk edges (and optionally every named point) always kept, so the result stays within the
+// tolerance of the original track.
+class RouteSimplifier
+{
+public:
+    struct Result {
+        size_t pointsBefore = 0;
+        size_t pointsAfter = 0;
+        double elapsedMs = 0.0;
+    };
+
+    static Result simplify(RouteData &route, double toleranceM, bool keepNamedPoints = true);
+
+private:
+    static constexpr size_t ChunkSize = 32768;
+
+    static void simplifyRange(const RouteData &route, size_t first, size_t last, double toleranceM,
+                              bool keepNamedPoints, unsigned char *keep);
+};
+
+#endif // ROUTESIMPLIFIER_H
@@ -0,0 +1,59 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Single-writer sequence lock for a small trivially copyable value. The writer never waits; readers
+// on any thread copy the value and retry only if a store overlapped the copy, so they never block
+// the writer and never see a torn value.
+template<typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied with memcpy");
+
+public:
+    SeqLock() = default;
+    SeqLock(const SeqLock &) = delete;
+    SeqLock &operator=(const SeqLock &) = delete;
+
+    // Writer side, one thread only
+    void store(const T &value)
+    {
+        const uint32_t sequence = counter.load(std::memory_order_relaxed);
+        counter.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&data, &value, sizeof(T));
+        counter.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Any thread
+    T load() const
+    {
+        T value;
+        for (;;) {
+            const uint32_t before = counter.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::memcpy(&value, &data, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (counter.load(std::memory_order_relaxed) == before) {
+                return value;
+            }
+        }
+    }
+
+    // Number of completed stores
+    uint32_t version() const { return counter.load(std::memory_order_acquire) >> 1; }
+
+private:
+    alignas(64) std::atomic<uint32_t> counter{0};
+    T data{};
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,92 @@
+#include "serialtxqueue.h"
+#include <QDebug>
+#include "nmea2000_actisense.h"
+
+SerialTxQueue::SerialTxQueue(QSerialPort &serialPort, QObject *parent)
+    : QObject(parent)
+    , serialPort(serialPort)
+{
+    coalesceTimer.setSingleShot(true);
+    coalesceTimer.setTimerType(Qt::PreciseTimer);
+    coalesceTimer.setInterval(2);
+    connect(&coalesceTimer, &QTimer::timeout, this, &SerialTxQueue::flush);
+}
+
+void SerialTxQueue::setCoalescingWindow(int windowMs)
+{
+    coalesceTimer.setInterval(qMax(0, windowMs));
+}
+
+bool SerialTxQueue::enqueue(const tN2kMsg &N2kMsg)
+{
+    if (!makeRoom(NMEA2000_Actisense::MaxEncodedMessageLen)) {
+        return false;
+    }
+
+    int frameLen = NMEA2000_Actisense::encodeMessage(N2kMsg, pending + pendingLen, BatchCapacity - pendingLen);
+    if (frameLen == 0) {
+        txCounters.dropped++;
+        return false;
+    }
+
+    frameAdded(frameLen);
+    return true;
+}
+
+int SerialTxQueue::enqueue(const tN2kMsg *N2kMsgs, int count)
+{
+    int accepted = 0;
+    for (int i = 0; i < count; i++) {
+        if (enqueue(N2kMsgs[i])) {
+            accepted++;
+        }
+    }
+    return accepted;
+}
+
+bool SerialTxQueue::makeRoom(int length)
+{
+    if (BatchCapacity - pendingLen < length) {
+        flush();
+    }
+
+    // Backpressure: only what QSerialPort still holds counts, the pending batch is ours to fill
+    if (serialPort.bytesToWrite() > maxBacklog) {
+        txCounters.dropped++;
+        return false;
+    }
+    return true;
+}
+
+void SerialTxQueue::frameAdded(int length)
+{
+    pendingLen += length;
+    pendingFrames++;
+    txCounters.queued++;
+
+    if (!coalesceTimer.isActive()) {
+        coalesceTimer.start();
+    }
+}
+
+void SerialTxQueue::flush()
+{
+    coalesceTimer.stop();
+    if (pendingLen == 0) {
+        return;
+    }
+
+    // One write for the whole batch; QSerialPort buffers it and drains asynchronously
+    qint64 bytesWritten = serialPort.write(reinterpret_cast<const char *>(pending), pendingLen);
+    if (bytesWritten == pendingLen) {
+        txCounters.sent += pendingFrames;
+        txCounters.batches++;
+        txCounters.bytesWritten += static_cast<quint64>(bytesWritten);
+    } else {
+        txCounters.dropped += pendingFrames;
+        qWarning() << "Serial write failed, dropped" << pendingFrames << "frames:" << serialPort.errorString();
+    }
+
+    pendingLen = 0;
+    pendingFrames = 0;
+}
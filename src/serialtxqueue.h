@@ -0,0 +1,63 @@
+#ifndef SERIALTXQUEUE_H
+#define SERIALTXQUEUE_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QTimer>
+#include "N2kMsg.h"
+
+// Transmit queue for the Actisense link. Frames are encoded straight into a pending buffer and
+// written to the port as one batch when the coalescing window expires or the batch fills up,
+// instead of a write() + flush() per message. When the bytes already handed to the port
+// (bytesToWrite) are above the configured limit new frames are dropped rather than blocking the
+// event loop.
+class SerialTxQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Counters {
+        quint64 queued = 0;
+        quint64 sent = 0;
+        quint64 dropped = 0;
+        quint64 batches = 0;
+        quint64 bytesWritten = 0;
+    };
+
+    explicit SerialTxQueue(QSerialPort &serialPort, QObject *parent = nullptr);
+
+    bool enqueue(const tN2kMsg &N2kMsg);
+    int enqueue(const tN2kMsg *N2kMsgs, int count);
+
+    // Write everything pending now
+    void flush();
+
+    // 0 writes on the next event loop pass, otherwise frames are held up to windowMs to coalesce
+    void setCoalescingWindow(int windowMs);
+    int coalescingWindow() const { return coalesceTimer.interval(); }
+
+    // Frames are dropped while the port has more than this many bytes waiting to go out. Below one
+    // batch a full flush alone would exceed it, so smaller values are raised to BatchCapacity.
+    void setMaxBacklog(qint64 bytes) { maxBacklog = qMax<qint64>(bytes, BatchCapacity); }
+    qint64 getMaxBacklog() const { return maxBacklog; }
+
+    const Counters &counters() const { return txCounters; }
+    void resetCounters() { txCounters = Counters(); }
+
+private:
+    static constexpr int BatchCapacity = 64 * 1024;
+
+    QSerialPort &serialPort;
+    QTimer coalesceTimer;
+    // Room for one batch in the driver while the next one fills
+    qint64 maxBacklog = 2 * BatchCapacity;
+    uint8_t pending[BatchCapacity];
+    int pendingLen = 0;
+    int pendingFrames = 0;
+    Counters txCounters;
+
+    bool makeRoom(int length);
+    void frameAdded(int length);
+};
+
+#endif // SERIALTXQUEUE_H
@@ -0,0 +1,324 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QTimer>
+#include <cstdio>
+#include <ctime>
+#include "n2klogconverter.h"
+#include "simulationengine.h"
+#ifdef Q_OS_UNIX
+#include "virtualngt1.h"
+#endif
+
+namespace {
+
+// --convert: one log to another and exit, formats from the options or the file names
+int convertLog(const QCommandLineParser &parser, const QCommandLineOption &convertOption, const QCommandLineOption &outputOption,
+               const QCommandLineOption &inputFormatOption, const QCommandLineOption &outputFormatOption,
+               const QCommandLineOption &threadsOption)
+{
+    const QString input = parser.value(convertOption);
+    const QString output = parser.value(outputOption);
+    if (output.isEmpty()) {
+        qCritical() << "--convert needs --output";
+        return 1;
+    }
+    N2kLogFormat::Type inputType, outputType;
+    if (parser.isSet(inputFormatOption) ? !N2kLogFormat::typeFromName(parser.value(inputFormatOption), inputType)
+                                        : !N2kLogFormat::typeForFile(input, inputType)) {
+        qCritical() << "Unknown log format of" << input;
+        return 1;
+    }
+    if (parser.isSet(outputFormatOption) ? !N2kLogFormat::typeFromName(parser.value(outputFormatOption), outputType)
+                                         : !N2kLogFormat::typeForFile(output, outputType)) {
+        qCritical() << "Unknown log format of" << output;
+        return 1;
+    }
+
+    N2kLogConverter::Options options;
+    options.threads = parser.value(threadsOption).toInt();
+    N2kLogConverter::Result result = N2kLogConverter::convert(input, inputType, output, outputType, options);
+    if (!result.ok) {
+        qCritical().noquote() << result.error;
+        return 1;
+    }
+    std::printf("%s -> %s: %llu messages (%llu frames, %llu skipped), %.1f MB in %.2f s, %.0f MB/s, round trip %llu messages\n",
+                qPrintable(N2kLogFormat::typeName(inputType)), qPrintable(N2kLogFormat::typeName(outputType)),
+                static_cast<unsigned long long>(result.messages), static_cast<unsigned long long>(result.frames),
+                static_cast<unsigned long long>(result.skipped), result.inputBytes / 1e6, result.elapsedUs / 1e6,
+                result.megabytesPerSecond(), static_cast<unsigned long long>(result.verifiedMessages));
+    return 0;
+}
+
+}
+
+// Headless runner: no widgets and no style sheets, for servers, CI and scripts
+int main(int argc, char *argv[])
+{
+    QElapsedTimer startup;
+    startup.start();
+
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName(APP_NAME);
+    QCoreApplication::setOrganizationName(APP_COMPANY);
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+    QCoreApplication::setOrganizationDomain("rfstateside.com");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless NMEA2000 simulator");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption portOption("port", "Actisense NGT-1 serial port, \"none\" runs without a transport.", "name");
+    QCommandLineOption baudOption("baud", "Serial baud rate.", "rate");
+    QCommandLineOption canOption("can", "Use this Linux CAN interface (can0, vcan0) instead of the serial port.", "interface");
+    QCommandLineOption canFilterOption("can-filter", "Have the kernel drop the PGNs nothing is subscribed to.");
+    QCommandLineOption captureOption("capture", "Record the bus traffic to this capture file.", "file");
+    QCommandLineOption replayOption("replay", "Play this capture file onto the bus.", "file");
+    QCommandLineOption replaySpeedOption("replay-speed", "Replay speed from 1 to 1000, 0 replays as fast as possible.", "factor");
+    QCommandLineOption replayLoopOption("replay-loop", "Start the replay over when it reaches the end.");
+    QCommandLineOption replayPgnsOption("replay-pgns", "Replay only these comma separated PGNs.", "list");
+    QCommandLineOption replaySourcesOption("replay-sources", "Replay only these comma separated source addresses.", "list");
+    QCommandLineOption routeOption("route", "GPX or KML route for the autopilot.", "file");
+    QCommandLineOption simplifyOption("simplify", "Simplify the route to this tolerance in meters.", "meters");
+    QCommandLineOption noRouteCacheOption("no-route-cache", "Always parse the route file instead of using the cache.");
+    QCommandLineOption speedOption("speed", "Vessel speed in m/s.", "mps");
+    QCommandLineOption reverseOption("reverse", "Sail the route back and forth.");
+    QCommandLineOption fleetOption("fleet", "Simulate a standard boat network of virtual devices.");
+    QCommandLineOption enginesOption("engines", "Engines in the virtual fleet.", "count");
+    QCommandLineOption tanksOption("tanks", "Tanks in the virtual fleet.", "count");
+    QCommandLineOption vesselsOption("vessels", "Pool vessels sailing the route alongside the autopilot.", "count");
+    QCommandLineOption clockOption("clock", "Clock mode: realtime, accelerated or stepped.", "mode");
+    QCommandLineOption scaleOption("scale", "Time scale of the accelerated clock.", "factor");
+    QCommandLineOption stepOption("step", "Simulated milliseconds per step of the stepped clock.", "ms");
+    QCommandLineOption durationOption("duration", "Stop after this many seconds, 0 runs forever.", "seconds", "0");
+    QCommandLineOption statsOption("stats", "Print statistics every this many seconds, 0 disables.", "seconds", "0");
+    QCommandLineOption noSettingsOption("no-settings", "Ignore the settings saved by the GUI.");
+    QCommandLineOption convertOption("convert", "Convert this log (capture, ebl, candump or canboat) to --output and exit.", "file");
+    QCommandLineOption outputOption("output", "Converted log.", "file");
+    QCommandLineOption inputFormatOption("input-format", "Format of the log to convert, by default from its name.", "format");
+    QCommandLineOption outputFormatOption("output-format", "Format of the converted log, by default from its name.", "format");
+    QCommandLineOption threadsOption("threads", "Conversion threads, 0 uses all cores.", "count", "0");
+    parser.addOptions({portOption, baudOption, canOption, canFilterOption, captureOption, replayOption, replaySpeedOption, replayLoopOption, replayPgnsOption,
+                       replaySourcesOption, routeOption, simplifyOption, noRouteCacheOption, speedOption, reverseOption, fleetOption, enginesOption,
+                       tanksOption, vesselsOption, clockOption, scaleOption, stepOption, durationOption, statsOption, noSettingsOption,
+                       convertOption, outputOption, inputFormatOption, outputFormatOption, threadsOption});
+#ifdef Q_OS_UNIX
+    QCommandLineOption virtualOption("virtual-ngt1", "Run against a simulated NGT-1 on a pseudo-terminal instead of --port.");
+    QCommandLineOption virtualBaudOption("virtual-baud", "Line rate the simulated NGT-1 is paced to, 0 runs unpaced.", "rate", "115200");
+    QCommandLineOption virtualLoopbackOption("virtual-loopback", "The simulated NGT-1 echoes every message sent as received.");
+    QCommandLineOption virtualInjectOption("virtual-inject", "Messages per second the simulated NGT-1 receives from the bus.", "rate", "0");
+    parser.addOptions({virtualOption, virtualBaudOption, virtualLoopbackOption, virtualInjectOption});
+#endif
+    parser.process(a);
+
+    if (parser.isSet(convertOption)) {
+        return convertLog(parser, convertOption, outputOption, inputFormatOption, outputFormatOption, threadsOption);
+    }
+
+    SimulationEngine::Config config;
+    config.portName = SimulationEngine::defaultPortName();
+    if (!parser.isSet(noSettingsOption)) {
+        QSettings settings(APP_COMPANY, APP_NAME);
+        config = SimulationEngine::Config::load(settings);
+    }
+    if (parser.isSet(portOption)) {
+        config.portName = parser.value(portOption) == "none" ? QString() : parser.value(portOption);
+    }
+    if (parser.isSet(baudOption)) {
+        config.baudRate = parser.value(baudOption).toInt();
+    }
+    if (parser.isSet(canOption)) {
+        config.canInterface = parser.value(canOption);
+    }
+    if (parser.isSet(canFilterOption)) {
+        config.canFilter = true;
+    }
+    if (parser.isSet(captureOption)) {
+        config.captureFile = parser.value(captureOption);
+    }
+    if (parser.isSet(replayOption)) {
+        config.replayFile = parser.value(replayOption);
+    }
+    if (parser.isSet(replaySpeedOption)) {
+        config.replay.speed = parser.value(replaySpeedOption).toDouble();
+    }
+    if (parser.isSet(replayLoopOption)) {
+        config.replay.loop = true;
+    }
+    for (const QString &pgn : parser.value(replayPgnsOption).split(',', Qt::SkipEmptyParts)) {
+        config.replay.pgns.push_back(pgn.trimmed().toULong());
+    }
+    for (const QString &source : parser.value(replaySourcesOption).split(',', Qt::SkipEmptyParts)) {
+        config.replay.sources.push_back(static_cast<uint8_t>(source.trimmed().toUInt()));
+    }
+    if (parser.isSet(routeOption)) {
+        config.routeFile = parser.value(routeOption);
+    }
+    if (parser.isSet(simplifyOption)) {
+        config.simplifyToleranceM = parser.value(simplifyOption).toDouble();
+    }
+    if (parser.isSet(noRouteCacheOption)) {
+        config.routeCache = false;
+    }
+    if (parser.isSet(speedOption)) {
+        config.speed = parser.value(speedOption).toDouble();
+    }
+    if (parser.isSet(reverseOption)) {
+        config.reverseRoute = true;
+    }
+    if (parser.isSet(fleetOption)) {
+        config.virtualFleet = true;
+    }
+    if (parser.isSet(enginesOption)) {
+        config.engineCount = parser.value(enginesOption).toInt();
+    }
+    if (parser.isSet(tanksOption)) {
+        config.tankCount = parser.value(tanksOption).toInt();
+    }
+    if (parser.isSet(vesselsOption)) {
+        config.vesselCount = parser.value(vesselsOption).toInt();
+    }
+
+    if (parser.isSet(clockOption) && !SimulationEngine::clockModeFromName(parser.value(clockOption), config.clockMode)) {
+        qCritical() << "Unknown clock mode" << parser.value(clockOption);
+        return 1;
+    }
+    if (parser.isSet(scaleOption)) {
+        config.timeScale = parser.value(scaleOption).toDouble();
+    }
+    if (parser.isSet(stepOption)) {
+        config.stepMs = parser.value(stepOption).toInt();
+    }
+
+#ifdef Q_OS_UNIX
+    VirtualNgt1 virtualNgt1;
+    if (parser.isSet(virtualOption)) {
+        VirtualNgt1::Options options;
+        options.baudRate = parser.value(virtualBaudOption).toInt();
+        options.loopback = parser.isSet(virtualLoopbackOption);
+        options.injectRate = parser.value(virtualInjectOption).toInt();
+        QString error;
+        if (!virtualNgt1.start(options, &error)) {
+            qCritical().noquote() << error;
+            return 1;
+        }
+        config.portName = virtualNgt1.portName();
+    }
+#endif
+
+    SimulationEngine engine;
+    QObject::connect(&engine, &SimulationEngine::statusMessage, [](const QString &message) {
+        qInfo().noquote() << message;
+    });
+    QObject::connect(&engine.autoPilot(), &AutoPilotSimulator::routeCompleted, &a, &QCoreApplication::quit);
+    QObject::connect(&engine.replayer(), &CaptureReplayer::finished, &a, &QCoreApplication::quit, Qt::QueuedConnection);
+
+    if (!engine.start(config)) {
+        return 1;
+    }
+    const QString transport = !config.canInterface.isEmpty() ? config.canInterface : config.portName;
+    qInfo() << "Simulation started in" << startup.elapsed() << "ms on" << (transport.isEmpty() ? QString("no transport") : transport);
+
+    int durationS = parser.value(durationOption).toInt();
+    if (durationS > 0) {
+        QTimer::singleShot(durationS * 1000, &a, &QCoreApplication::quit);
+    }
+
+    QTimer statsTimer;
+    int statsS = parser.value(statsOption).toInt();
+    if (statsS > 0) {
+        QObject::connect(&statsTimer, &QTimer::timeout, [&]() {
+            PgnScheduler::Statistics stats = engine.scheduler().statistics();
+            ActisenseLink::Statistics link = engine.handler().GetLinkStatistics();
+            std::printf("generated %llu sent %llu dropped %llu tick %.1f us (max %.1f) tx depth %zu/%zu captured %llu\n",
+                        static_cast<unsigned long long>(stats.generated), static_cast<unsigned long long>(stats.sent),
+                        static_cast<unsigned long long>(stats.dropped), stats.lastTickUs, stats.maxTickUs,
+                        link.txDepth, link.txCapacity, static_cast<unsigned long long>(link.captured));
+            NavigationN2kBridge::Statistics bridge = engine.navigationBridge().statistics();
+            std::printf("navigation pgns %llu (encoded %llu)\n", static_cast<unsigned long long>(bridge.totalGenerated()),
+                        static_cast<unsigned long long>(bridge.totalEncoded()));
+            VesselPool::Statistics pool = engine.vessels().statistics();
+            if (pool.vessels > 0) {
+                std::printf("vessels %d updates %llu update %.1f us (max %.1f)\n", pool.vessels,
+                            static_cast<unsigned long long>(pool.updates), pool.lastUpdateUs, pool.maxUpdateUs);
+            }
+            if (engine.replayer().isRunning()) {
+                CaptureReplayer::Statistics replay = engine.replayer().statistics();
+                std::printf("replay %.1f%% frames %llu at %.0f/s stalls %llu timing error mean %.0f us p99 %llu us\n",
+                            replay.progress * 100.0, static_cast<unsigned long long>(replay.frames), replay.framesPerSecond,
+                            static_cast<unsigned long long>(replay.stalls), replay.timingError.meanUs(),
+                            static_cast<unsigned long long>(replay.timingError.percentileUs(99)));
+            }
+#ifdef Q_OS_LINUX
+            if (!engine.config().canInterface.isEmpty()) {
+                SocketCanTransport::Statistics can = engine.handler().GetCanStatistics();
+                std::printf("can rx %llu frames (%llu msgs) tx %llu frames (%llu msgs) %.1f frames/call overflows %llu latency mean %.0f us p99 %llu us\n",
+                            static_cast<unsigned long long>(can.framesReceived), static_cast<unsigned long long>(can.messagesReceived),
+                            static_cast<unsigned long long>(can.framesSent), static_cast<unsigned long long>(can.messagesSent),
+                            can.framesPerCall(), static_cast<unsigned long long>(can.rxOverflows), can.rxLatency.meanUs(),
+                            static_cast<unsigned long long>(can.rxLatency.percentileUs(99)));
+            }
+#endif
+#ifdef Q_OS_UNIX
+            if (virtualNgt1.isRunning()) {
+                VirtualNgt1::Statistics device = virtualNgt1.statistics();
+                std::printf("virtual ngt-1 from host %llu msgs (%llu bytes) to host %llu msgs (%llu bytes) errors %llu\n",
+                            static_cast<unsigned long long>(device.messagesFromHost), static_cast<unsigned long long>(device.bytesFromHost),
+                            static_cast<unsigned long long>(device.messagesToHost), static_cast<unsigned long long>(device.bytesToHost),
+                            static_cast<unsigned long long>(device.checksumErrors + device.framingErrors));
+            }
+#endif
+            std::fflush(stdout);
+        });
+        statsTimer.start(statsS * 1000);
+    }
+
+    QElapsedTimer run;
+    run.start();
+    const std::clock_t cpuStart = std::clock();
+    int result = a.exec();
+    const double cpuS = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    engine.stop();
+    double wallS = qMax<qint64>(1, run.elapsed()) / 1000.0;
+    qInfo() << "Simulated" << engine.clock().nowSeconds() << "s in" << wallS << "s";
+    // Throughput over the whole run, meaningful with an accelerated or stepped clock
+    PgnScheduler::Statistics stats = engine.scheduler().statistics();
+    std::printf("%.0f PGNs generated/s, %.0f sent/s (%llu navigation PGNs)\n", stats.generated / wallS, stats.sent / wallS,
+                static_cast<unsigned long long>(engine.navigationBridge().statistics().totalGenerated()));
+    if (!config.replayFile.isEmpty()) {
+        CaptureReplayer::Statistics replay = engine.replayer().statistics();
+        std::printf("replayed %llu frames (%llu filtered, %llu loops) at %.0f frames/s, timing error mean %.0f us max %llu us\n",
+                    static_cast<unsigned long long>(replay.frames), static_cast<unsigned long long>(replay.filtered),
+                    static_cast<unsigned long long>(replay.loops), replay.framesPerSecond, replay.timingError.meanUs(),
+                    static_cast<unsigned long long>(replay.timingError.maxUs));
+    }
+#ifdef Q_OS_LINUX
+    if (!config.canInterface.isEmpty()) {
+        // Process CPU time over every frame that crossed the socket, the cost of the whole pipeline per frame
+        SocketCanTransport::Statistics can = engine.handler().GetCanStatistics();
+        const quint64 frames = can.framesReceived + can.framesSent;
+        std::printf("%s: %.0f frames/s received, %.0f frames/s sent, %.1f frames per system call, %.2f us CPU per frame, "
+                    "%llu kernel drops, %llu tx dropped, %llu hardware and %llu software timestamps, %d filters\n",
+                    qPrintable(config.canInterface), can.framesReceived / wallS, can.framesSent / wallS, can.framesPerCall(),
+                    frames ? cpuS * 1e6 / frames : 0.0, static_cast<unsigned long long>(can.rxOverflows),
+                    static_cast<unsigned long long>(can.txDropped), static_cast<unsigned long long>(can.hardwareTimestamps),
+                    static_cast<unsigned long long>(can.softwareTimestamps), can.filters);
+    }
+#endif
+#ifdef Q_OS_UNIX
+    if (virtualNgt1.isRunning()) {
+        VirtualNgt1::Statistics device = virtualNgt1.statistics();
+        ActisenseLink::Statistics link = engine.handler().GetLinkStatistics();
+        std::printf("virtual ngt-1: %.0f msgs/s from host, %.0f msgs/s to host, %llu commands, %llu checksum and %llu framing errors; "
+                    "link rx latency mean %.0f us p99 %llu us, rx dropped %llu\n",
+                    device.messagesFromHost / wallS, device.messagesToHost / wallS,
+                    static_cast<unsigned long long>(device.commandsAcknowledged), static_cast<unsigned long long>(device.checksumErrors),
+                    static_cast<unsigned long long>(device.framingErrors), link.rxLatency.meanUs(),
+                    static_cast<unsigned long long>(link.rxLatency.percentileUs(99)), static_cast<unsigned long long>(link.rxDropped));
+        virtualNgt1.stop();
+    }
+#endif
+    return result;
+}
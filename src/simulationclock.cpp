@@ -0,0 +1,85 @@
+#include "simulationclock.h"
+
+SimulationClock::SimulationClock(QObject *parent)
+    : QObject(parent)
+{
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &SimulationClock::onTimer);
+}
+
+void SimulationClock::setMode(Mode mode)
+{
+    clockMode = mode;
+    if (timer.isActive()) {
+        stop();
+        start();
+    }
+}
+
+void SimulationClock::setTimeScale(double newScale)
+{
+    scale = newScale > 0.0 ? newScale : 1.0;
+}
+
+void SimulationClock::setTickIntervalMs(int intervalMs)
+{
+    tickIntervalMs = qMax(1, intervalMs);
+    if (timer.isActive() && clockMode != Mode::Stepped) {
+        timer.setInterval(tickIntervalMs);
+    }
+}
+
+void SimulationClock::start()
+{
+    if (timer.isActive()) {
+        return;
+    }
+
+    wall.start();
+    lastWallNs = 0;
+    pendingMs = 0.0;
+    // Stepped mode wakes on every event loop pass and yields after a few ms of work
+    timer.start(clockMode == Mode::Stepped ? 0 : tickIntervalMs);
+}
+
+void SimulationClock::stop()
+{
+    timer.stop();
+}
+
+void SimulationClock::reset()
+{
+    simMs = 0;
+    pendingMs = 0.0;
+    lastWallNs = wall.isValid() ? wall.nsecsElapsed() : 0;
+}
+
+void SimulationClock::advance(qint64 deltaMs)
+{
+    if (deltaMs <= 0) {
+        return;
+    }
+    simMs += deltaMs;
+    emit tick(simMs, deltaMs);
+}
+
+void SimulationClock::onTimer()
+{
+    if (clockMode == Mode::Stepped) {
+        QElapsedTimer budget;
+        budget.start();
+        do {
+            advance(step);
+        } while (timer.isActive() && budget.elapsed() < SteppedBudgetMs);
+        return;
+    }
+
+    // Whole milliseconds only, the remainder carries over so no simulated time is lost
+    qint64 nowNs = wall.nsecsElapsed();
+    pendingMs += (nowNs - lastWallNs) / 1e6 * timeScale();
+    lastWallNs = nowNs;
+
+    qint64 deltaMs = static_cast<qint64>(pendingMs);
+    pendingMs -= deltaMs;
+    advance(deltaMs);
+}
@@ -0,0 +1,64 @@
+#ifndef SIMULATIONCLOCK_H
+#define SIMULATIONCLOCK_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+// Source of simulated time. Everything that moves (autopilot, PGN scheduler) advances on tick()
+// instead of reading the wall clock, so the same run can happen in real time, N times faster, or as
+// fast as the CPU allows with fixed steps.
+class SimulationClock : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Mode {
+        RealTime,       // Simulated time follows the wall clock
+        Accelerated,    // Simulated time runs timeScale times faster than the wall clock
+        Stepped         // Fixed steps of stepMs back to back, no waiting
+    };
+
+    explicit SimulationClock(QObject *parent = nullptr);
+
+    void setMode(Mode mode);
+    Mode mode() const { return clockMode; }
+    void setTimeScale(double scale);
+    double timeScale() const { return clockMode == Mode::RealTime ? 1.0 : scale; }
+    void setStepMs(int stepMs) { step = qMax(1, stepMs); }
+    int stepMs() const { return step; }
+    // Wall time between ticks in RealTime and Accelerated mode
+    void setTickIntervalMs(int intervalMs);
+
+    void start();
+    void stop();
+    bool isRunning() const { return timer.isActive(); }
+    void reset();
+
+    // Advances by exactly deltaMs regardless of the mode, for scripts and regression runs
+    void advance(qint64 deltaMs);
+
+    qint64 nowMs() const { return simMs; }
+    double nowSeconds() const { return simMs / 1000.0; }
+
+signals:
+    void tick(qint64 nowMs, qint64 deltaMs);
+
+private slots:
+    void onTimer();
+
+private:
+    Mode clockMode = Mode::RealTime;
+    double scale = 1.0;
+    int step = 100;
+    int tickIntervalMs = 10;
+    QTimer timer;
+    QElapsedTimer wall;
+    qint64 lastWallNs = 0;
+    double pendingMs = 0.0;
+    qint64 simMs = 0;
+
+    static constexpr int SteppedBudgetMs = 5;
+};
+
+#endif // SIMULATIONCLOCK_H
@@ -0,0 +1,261 @@
+#include "simulationengine.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+
+SimulationEngine::SimulationEngine(QObject *parent)
+    : QObject(parent)
+    , virtualFleet(n2kHandler, pgnScheduler)
+    , n2kBridge(autoPilotSimulator, pgnScheduler)
+{
+    simulationClock.setTickIntervalMs(5);
+    autoPilotSimulator.setClock(&simulationClock);
+    virtualFleet.setClock(&simulationClock);
+    vesselPool.setClock(&simulationClock);
+    connect(&simulationClock, &SimulationClock::tick, this, [this](qint64 nowMs, qint64) {
+        pgnScheduler.advanceTo(nowMs);
+    });
+
+    connect(&autoPilotSimulator, &AutoPilotSimulator::statusMessage, this, &SimulationEngine::statusMessage);
+}
+
+SimulationEngine::~SimulationEngine()
+{
+    stop();
+}
+
+QString SimulationEngine::defaultPortName()
+{
+#ifdef Q_OS_WIN
+    return "COM6";
+#else
+    return "/dev/ttyUSB0";
+#endif
+}
+
+QString SimulationEngine::clockModeName(SimulationClock::Mode mode)
+{
+    switch (mode) {
+    case SimulationClock::Mode::Accelerated:
+        return "accelerated";
+    case SimulationClock::Mode::Stepped:
+        return "stepped";
+    default:
+        return "realtime";
+    }
+}
+
+bool SimulationEngine::clockModeFromName(const QString &name, SimulationClock::Mode &mode)
+{
+    QString lower = name.toLower();
+    if (lower == "realtime") {
+        mode = SimulationClock::Mode::RealTime;
+    } else if (lower == "accelerated") {
+        mode = SimulationClock::Mode::Accelerated;
+    } else if (lower == "stepped") {
+        mode = SimulationClock::Mode::Stepped;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+SimulationEngine::Config SimulationEngine::Config::load(QSettings &settings)
+{
+    Config config;
+    settings.beginGroup("Simulation");
+    config.portName = settings.value("PortName", defaultPortName()).toString();
+    config.baudRate = settings.value("BaudRate", config.baudRate).toInt();
+    config.canInterface = settings.value("CanInterface").toString();
+    config.canFilter = settings.value("CanFilter", config.canFilter).toBool();
+    config.captureFile = settings.value("CaptureFile").toString();
+    config.replayFile = settings.value("ReplayFile").toString();
+    config.replay.speed = settings.value("ReplaySpeed", config.replay.speed).toDouble();
+    config.replay.loop = settings.value("ReplayLoop", config.replay.loop).toBool();
+    config.routeFile = settings.value("RouteFile").toString();
+    config.simplifyToleranceM = settings.value("SimplifyToleranceM", config.simplifyToleranceM).toDouble();
+    config.routeCache = settings.value("RouteCache", config.routeCache).toBool();
+    config.speed = settings.value("Speed", config.speed).toDouble();
+    config.reverseRoute = settings.value("ReverseRoute", config.reverseRoute).toBool();
+    config.virtualFleet = settings.value("VirtualFleet", config.virtualFleet).toBool();
+    config.engineCount = settings.value("EngineCount", config.engineCount).toInt();
+    config.tankCount = settings.value("TankCount", config.tankCount).toInt();
+    config.positionPeriodMs = settings.value("PositionPeriodMs", config.positionPeriodMs).toInt();
+    config.cogSogPeriodMs = settings.value("CogSogPeriodMs", config.cogSogPeriodMs).toInt();
+    config.gnssPeriodMs = settings.value("GnssPeriodMs", config.gnssPeriodMs).toInt();
+    config.headingPeriodMs = settings.value("HeadingPeriodMs", config.headingPeriodMs).toInt();
+    config.xtePeriodMs = settings.value("XtePeriodMs", config.xtePeriodMs).toInt();
+    config.navigationPeriodMs = settings.value("NavigationPeriodMs", config.navigationPeriodMs).toInt();
+    config.routeInfoPeriodMs = settings.value("RouteInfoPeriodMs", config.routeInfoPeriodMs).toInt();
+    config.vesselCount = settings.value("VesselCount", config.vesselCount).toInt();
+    clockModeFromName(settings.value("ClockMode").toString(), config.clockMode);
+    config.timeScale = settings.value("TimeScale", config.timeScale).toDouble();
+    config.stepMs = settings.value("StepMs", config.stepMs).toInt();
+    settings.endGroup();
+    return config;
+}
+
+void SimulationEngine::Config::save(QSettings &settings) const
+{
+    settings.beginGroup("Simulation");
+    settings.setValue("PortName", portName);
+    settings.setValue("BaudRate", baudRate);
+    settings.setValue("CanInterface", canInterface);
+    settings.setValue("CanFilter", canFilter);
+    settings.setValue("CaptureFile", captureFile);
+    settings.setValue("ReplayFile", replayFile);
+    settings.setValue("ReplaySpeed", replay.speed);
+    settings.setValue("ReplayLoop", replay.loop);
+    settings.setValue("RouteFile", routeFile);
+    settings.setValue("SimplifyToleranceM", simplifyToleranceM);
+    settings.setValue("RouteCache", routeCache);
+    settings.setValue("Speed", speed);
+    settings.setValue("ReverseRoute", reverseRoute);
+    settings.setValue("VirtualFleet", virtualFleet);
+    settings.setValue("EngineCount", engineCount);
+    settings.setValue("TankCount", tankCount);
+    settings.setValue("PositionPeriodMs", positionPeriodMs);
+    settings.setValue("CogSogPeriodMs", cogSogPeriodMs);
+    settings.setValue("GnssPeriodMs", gnssPeriodMs);
+    settings.setValue("HeadingPeriodMs", headingPeriodMs);
+    settings.setValue("XtePeriodMs", xtePeriodMs);
+    settings.setValue("NavigationPeriodMs", navigationPeriodMs);
+    settings.setValue("RouteInfoPeriodMs", routeInfoPeriodMs);
+    settings.setValue("VesselCount", vesselCount);
+    settings.setValue("ClockMode", clockModeName(clockMode));
+    settings.setValue("TimeScale", timeScale);
+    settings.setValue("StepMs", stepMs);
+    settings.endGroup();
+}
+
+bool SimulationEngine::start(const Config &config)
+{
+    if (running) {
+        stop();
+    }
+    activeConfig = config;
+
+    autoPilotSimulator.setSimplifyTolerance(config.simplifyToleranceM);
+    autoPilotSimulator.setRouteCacheEnabled(config.routeCache);
+    if (!config.routeFile.isEmpty() && !autoPilotSimulator.loadRoute(config.routeFile)) {
+        emit statusMessage("Unable to load route " + config.routeFile);
+        return false;
+    }
+
+    const bool replaying = !config.replayFile.isEmpty();
+    if (replaying) {
+        QString error;
+        if (!captureReplayer.open(config.replayFile, &error)) {
+            emit statusMessage(error);
+            return false;
+        }
+        captureReplayer.setOptions(config.replay);
+    }
+
+    if (!config.captureFile.isEmpty()) {
+        n2kHandler.StartCapture(config.captureFile);
+    }
+    // While replaying, the replay thread feeds the transmit ring instead of the scheduler. The fleet's
+    // claims and ISO responses still come from this thread; the link serializes the two producers.
+    CaptureReplayer::Sink sink;
+    if (!config.canInterface.isEmpty() || !config.portName.isEmpty()) {
+        if (!config.canInterface.isEmpty()) {
+            n2kHandler.InitializeSocketCan(config.canInterface, config.canFilter);
+        } else {
+            n2kHandler.InitializeActisense(config.portName, static_cast<QSerialPort::BaudRate>(config.baudRate));
+        }
+        sink = [this](const tN2kMsg *N2kMsgs, int count) {
+            return n2kHandler.SendMessages(N2kMsgs, count);
+        };
+    }
+    captureReplayer.setSink(replaying ? sink : CaptureReplayer::Sink());
+    pgnScheduler.setSink(replaying ? PgnScheduler::Sink() : sink);
+
+    NavigationN2kBridge::Periods periods;
+    periods.positionMs = config.positionPeriodMs;
+    periods.cogSogMs = config.cogSogPeriodMs;
+    periods.gnssMs = config.gnssPeriodMs;
+    periods.headingMs = config.headingPeriodMs;
+    periods.crossTrackMs = config.xtePeriodMs;
+    periods.navigationMs = config.navigationPeriodMs;
+    periods.routeMs = config.routeInfoPeriodMs;
+    n2kBridge.setPeriods(periods);
+    n2kBridge.setRouteName(QFileInfo(config.routeFile).completeBaseName());
+    if (config.virtualFleet && virtualFleet.deviceCount() == 0) {
+        virtualFleet.addStandardBoat(config.engineCount, config.tankCount);
+    }
+
+    simulationClock.setMode(config.clockMode);
+    simulationClock.setTimeScale(config.timeScale);
+    simulationClock.setStepMs(config.stepMs);
+
+    autoPilotSimulator.setSpeed(config.speed);
+    autoPilotSimulator.setReverseRoute(config.reverseRoute);
+    if (!config.routeFile.isEmpty()) {
+        autoPilotSimulator.start();
+        // Simulated time 0 is the moment the simulation started
+        n2kBridge.setEpochMs(QDateTime::currentMSecsSinceEpoch() - simulationClock.nowMs());
+        n2kBridge.start();
+    }
+    if (config.virtualFleet) {
+        virtualFleet.start();
+    }
+    populateVesselPool(config.routeFile.isEmpty() ? 0 : config.vesselCount);
+    if (vesselPool.vesselCount() > 0) {
+        vesselPool.start();
+    }
+    simulationClock.start();
+    if (replaying) {
+        captureReplayer.start();
+        emit statusMessage(QString("Replaying %1 messages from %2").arg(captureReplayer.reader().recordCount()).arg(config.replayFile));
+    }
+
+    running = true;
+    emit runningChanged(true);
+    return true;
+}
+
+void SimulationEngine::stop()
+{
+    if (!running) {
+        return;
+    }
+
+    captureReplayer.stop();
+    autoPilotSimulator.stop();
+    n2kBridge.stop();
+    vesselPool.stop();
+    virtualFleet.stop();
+    simulationClock.stop();
+    if (!activeConfig.captureFile.isEmpty()) {
+        n2kHandler.StopCapture();
+    }
+
+    running = false;
+    emit runningChanged(false);
+}
+
+void SimulationEngine::populateVesselPool(int count)
+{
+    vesselPool.clear();
+    if (count <= 0) {
+        return;
+    }
+    int route = vesselPool.addRoute(autoPilotSimulator.routeGeometry());
+    if (route < 0) {
+        return;
+    }
+
+    // Spread evenly along the route, every other vessel sailing it the other way at a different speed
+    double length = autoPilotSimulator.routeGeometry().totalLength();
+    vesselPool.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        VesselPool::VesselOptions options;
+        options.id = 366000000u + static_cast<uint32_t>(i);
+        options.speed = 2.0 + (i % 9);
+        options.startDistanceM = length * i / count;
+        options.reverse = (i % 2) != 0;
+        options.endAction = activeConfig.reverseRoute ? VesselPool::EndAction::Reverse : VesselPool::EndAction::Loop;
+        vesselPool.addVessel(route, options);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef SIMULATIONENGINE_H
+#define SIMULATIONENGINE_H
+
+#include <QObject>
+#include <QSettings>
+#include <QString>
+#include "autopilotsimulator.h"
+#include "capturereplayer.h"
+#include "navigationn2kbridge.h"
+#include "nmea2000handler.h"
+#include "pgnscheduler.h"
+#include "simulationclock.h"
+#include "vesselpool.h"
+#include "virtualn2kfleet.h"
+
+// Headless simulation core: the N2K transport, the PGN scheduler, the virtual fleet, the autopilot
+// the vessel pool and the capture replayer, wired together without any widget. The autopilot and the scheduler both advance on
+// the one SimulationClock, so accelerated and stepped runs stay consistent. MainWindow and the CLI runner are thin front ends
+// that only build a Config and call start().
+class SimulationEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Config {
+        QString portName;           // Empty (and no canInterface) runs without a transport, everything is counted as dropped
+        int baudRate = QSerialPort::Baud115200;
+        // Linux CAN interface used instead of the serial port when set
+        QString canInterface;
+        bool canFilter = false;     // Receive only the PGNs the handler dispatches, see InitializeSocketCan
+        QString captureFile;        // Records the bus traffic, empty disables
+        // Plays a capture onto the bus. The replay then owns the transmit ring: the simulated
+        // sources keep running but their messages are counted as dropped
+        QString replayFile;
+        CaptureReplayer::Options replay;
+        QString routeFile;          // GPX or KML, empty leaves the autopilot idle
+        double simplifyToleranceM = 0.0;
+        bool routeCache = true;
+        double speed = 5.0;         // m/s
+        bool reverseRoute = false;
+        bool virtualFleet = false;
+        int engineCount = 2;
+        int tankCount = 4;
+        int vesselCount = 0;        // Pool vessels spread along the route, 0 disables the pool
+        // Own ship navigation PGNs, 0 disables a message
+        int positionPeriodMs = 100;     // 129025
+        int cogSogPeriodMs = 250;       // 129026
+        int gnssPeriodMs = 1000;        // 129029
+        int headingPeriodMs = 100;      // 127250
+        int xtePeriodMs = 1000;         // 129283
+        int navigationPeriodMs = 1000;  // 129284
+        int routeInfoPeriodMs = 5000;   // 129285
+        SimulationClock::Mode clockMode = SimulationClock::Mode::RealTime;
+        double timeScale = 1.0;     // Accelerated mode
+        int stepMs = 100;           // Stepped mode
+
+        // Reads the "Simulation" group, missing keys keep their defaults
+        static Config load(QSettings &settings);
+        void save(QSettings &settings) const;
+    };
+
+    explicit SimulationEngine(QObject *parent = nullptr);
+    ~SimulationEngine();
+
+    bool start(const Config &config);
+    void stop();
+    bool isRunning() const { return running; }
+    const Config &config() const { return activeConfig; }
+
+    Nmea2000Handler &handler() { return n2kHandler; }
+    PgnScheduler &scheduler() { return pgnScheduler; }
+    VirtualN2kFleet &fleet() { return virtualFleet; }
+    AutoPilotSimulator &autoPilot() { return autoPilotSimulator; }
+    NavigationN2kBridge &navigationBridge() { return n2kBridge; }
+    SimulationClock &clock() { return simulationClock; }
+    VesselPool &vessels() { return vesselPool; }
+    CaptureReplayer &replayer() { return captureReplayer; }
+
+    static QString defaultPortName();
+    static QString clockModeName(SimulationClock::Mode mode);
+    static bool clockModeFromName(const QString &name, SimulationClock::Mode &mode);
+
+signals:
+    void runningChanged(bool running);
+    void statusMessage(const QString &message);
+
+private:
+    SimulationClock simulationClock;
+    Nmea2000Handler n2kHandler;
+    PgnScheduler pgnScheduler;
+    VirtualN2kFleet virtualFleet;
+    AutoPilotSimulator autoPilotSimulator;
+    NavigationN2kBridge n2kBridge;
+    VesselPool vesselPool;
+    CaptureReplayer captureReplayer;
+
+    Config activeConfig;
+    bool running = false;
+
+    void populateVesselPool(int count);
+};
+
+#endif // SIMULATIONENGINE_H
@@ -0,0 +1,399 @@
+#include "socketcantransport.h"
+#include <QDebug>
+#include <QMetaObject>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr unsigned long TransportControlPGN = 60416L;  // TP.CM
+constexpr unsigned long TransportDataPGN = 60160L;     // TP.DT
+
+// Ancillary data of one received frame: the timestamps and the overflow counter
+constexpr size_t ControlSize = CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(uint32_t));
+
+// The PGN sits in bits 8-24 of the 29 bit identifier; addressed (PDU1) PGNs have the destination
+// where broadcast ones have their low byte, so only the data page and PF are compared for those
+std::vector<can_filter> kernelFilters(const std::vector<unsigned long> &pgns)
+{
+    std::vector<can_filter> filters;
+    if (pgns.empty()) {
+        return filters;
+    }
+    std::vector<unsigned long> all = pgns;
+    // Transport protocol sessions can carry any of the subscribed PGNs
+    all.push_back(TransportControlPGN);
+    all.push_back(TransportDataPGN);
+    std::sort(all.begin(), all.end());
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+
+    for (unsigned long PGN : all) {
+        can_filter filter;
+        const bool addressed = ((PGN >> 8) & 0xFF) < 240;
+        filter.can_id = CAN_EFF_FLAG | ((PGN & (addressed ? 0x1FF00 : 0x1FFFF)) << 8);
+        filter.can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG | (addressed ? 0x1FF0000 : 0x1FFFF00);
+        // PDU1 PGNs differing only in the low byte end up as the same filter
+        if (filters.empty() || filters.back().can_id != filter.can_id || filters.back().can_mask != filter.can_mask) {
+            filters.push_back(filter);
+        }
+    }
+    return filters;
+}
+
+qint64 realtimeUs()
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<qint64>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+}
+
+struct SocketCanTransport::Buffers {
+    can_frame rxFrames[BatchSize];
+    iovec rxVectors[BatchSize];
+    mmsghdr rxHeaders[BatchSize];
+    alignas(cmsghdr) char rxControl[BatchSize][ControlSize];
+
+    // Frames [txSent, txFrames.size()) are waiting for the interface
+    std::vector<can_frame> txFrames;
+    size_t txSent = 0;
+    iovec txVectors[BatchSize];
+    mmsghdr txHeaders[BatchSize];
+
+    Buffers()
+    {
+        memset(rxHeaders, 0, sizeof(rxHeaders));
+        memset(txHeaders, 0, sizeof(txHeaders));
+        for (int i = 0; i < BatchSize; i++) {
+            rxVectors[i] = {&rxFrames[i], sizeof(can_frame)};
+            rxHeaders[i].msg_hdr.msg_iov = &rxVectors[i];
+            rxHeaders[i].msg_hdr.msg_iovlen = 1;
+            rxHeaders[i].msg_hdr.msg_control = rxControl[i];
+            txHeaders[i].msg_hdr.msg_iov = &txVectors[i];
+            txHeaders[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    size_t txPending() const { return txFrames.size() - txSent; }
+};
+
+SocketCanTransport::Statistics SocketCanTransport::Counters::snapshot() const
+{
+    Statistics stats;
+    stats.framesReceived = framesReceived.load(std::memory_order_relaxed);
+    stats.framesSent = framesSent.load(std::memory_order_relaxed);
+    stats.messagesReceived = messagesReceived.load(std::memory_order_relaxed);
+    stats.messagesSent = messagesSent.load(std::memory_order_relaxed);
+    stats.receiveCalls = receiveCalls.load(std::memory_order_relaxed);
+    stats.sendCalls = sendCalls.load(std::memory_order_relaxed);
+    stats.txDropped = txDropped.load(std::memory_order_relaxed);
+    stats.rxOverflows = rxOverflows.load(std::memory_order_relaxed);
+    stats.hardwareTimestamps = hardwareTimestamps.load(std::memory_order_relaxed);
+    stats.softwareTimestamps = softwareTimestamps.load(std::memory_order_relaxed);
+    stats.filters = filters.load(std::memory_order_relaxed);
+    stats.rxLatency = rxLatency.snapshot();
+    return stats;
+}
+
+void SocketCanTransport::Counters::reset()
+{
+    framesReceived = 0;
+    framesSent = 0;
+    messagesReceived = 0;
+    messagesSent = 0;
+    receiveCalls = 0;
+    sendCalls = 0;
+    txDropped = 0;
+    rxOverflows = 0;
+    hardwareTimestamps = 0;
+    softwareTimestamps = 0;
+    filters = 0;
+    rxLatency.reset();
+}
+
+SocketCanTransport::SocketCanTransport(Counters &counters, QObject *parent)
+    : N2kTransport(parent)
+    , counters(counters)
+    , buffers(new Buffers)
+    , rxBatch(BatchSize)
+{
+    frameClock.start();
+}
+
+SocketCanTransport::~SocketCanTransport()
+{
+    close();
+}
+
+bool SocketCanTransport::open(const QString &interfaceName, const std::vector<unsigned long> &pgns, QString *error)
+{
+    close();
+
+    auto fail = [&](const char *what) {
+        if (error) {
+            *error = QString("%1 on %2: %3").arg(what, interfaceName, strerror(errno));
+        }
+        if (socketFd >= 0) {
+            ::close(socketFd);
+            socketFd = -1;
+        }
+        return false;
+    };
+
+    socketFd = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+    if (socketFd < 0) {
+        return fail("Unable to create CAN socket");
+    }
+    ifreq request;
+    memset(&request, 0, sizeof(request));
+    strncpy(request.ifr_name, interfaceName.toLocal8Bit().constData(), IFNAMSIZ - 1);
+    if (ioctl(socketFd, SIOCGIFINDEX, &request) < 0) {
+        return fail("No CAN interface");
+    }
+    sockaddr_can address;
+    memset(&address, 0, sizeof(address));
+    address.can_family = AF_CAN;
+    address.can_ifindex = request.ifr_ifindex;
+    if (bind(socketFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        return fail("Unable to bind CAN socket");
+    }
+
+    std::vector<can_filter> filters = kernelFilters(pgns);
+    if (static_cast<int>(filters.size()) > MaxFilters) {
+        qWarning() << "More than" << MaxFilters << "CAN filters, receiving everything on" << interfaceName;
+        filters.clear();
+    }
+    if (!filters.empty() && setsockopt(socketFd, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(),
+                                       static_cast<socklen_t>(filters.size() * sizeof(can_filter))) < 0) {
+        return fail("Unable to set CAN filters");
+    }
+    counters.filters = static_cast<int>(filters.size());
+
+    // Hardware timestamps where the controller has them, the kernel's receive time otherwise;
+    // drivers without either simply deliver no timestamp
+    int timestamping = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE
+                       | SOF_TIMESTAMPING_SOFTWARE;
+    setsockopt(socketFd, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping));
+    int enable = 1;
+    setsockopt(socketFd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+    // Room for bursts while the I/O thread is busy sending
+    int receiveBuffer = 1 << 20;
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
+    readNotifier = new QSocketNotifier(socketFd, QSocketNotifier::Read, this);
+    connect(readNotifier, &QSocketNotifier::activated, this, &SocketCanTransport::onReadable);
+    writeNotifier = new QSocketNotifier(socketFd, QSocketNotifier::Write, this);
+    writeNotifier->setEnabled(false);
+    connect(writeNotifier, &QSocketNotifier::activated, this, &SocketCanTransport::onWritable);
+    return true;
+}
+
+void SocketCanTransport::close()
+{
+    if (socketFd < 0) {
+        return;
+    }
+    Flush();
+    delete readNotifier;
+    readNotifier = nullptr;
+    delete writeNotifier;
+    writeNotifier = nullptr;
+    ::close(socketFd);
+    socketFd = -1;
+    buffers->txFrames.clear();
+    buffers->txSent = 0;
+    assembler.clear();
+    sequences.clear();
+}
+
+void SocketCanTransport::onReadable()
+{
+    Buffers &b = *buffers;
+    int batchCount = 0;
+
+    for (;;) {
+        for (int i = 0; i < BatchSize; i++) {
+            b.rxHeaders[i].msg_hdr.msg_controllen = ControlSize;
+        }
+        const int count = recvmmsg(socketFd, b.rxHeaders, BatchSize, MSG_DONTWAIT, nullptr);
+        if (count <= 0) {
+            break;
+        }
+        counters.receiveCalls.fetch_add(1, std::memory_order_relaxed);
+        counters.framesReceived.fetch_add(static_cast<quint64>(count), std::memory_order_relaxed);
+        const qint64 nowUs = realtimeUs();
+        const qint64 nowMs = frameClock.elapsed();
+
+        for (int i = 0; i < count; i++) {
+            msghdr &header = b.rxHeaders[i].msg_hdr;
+            for (cmsghdr *control = CMSG_FIRSTHDR(&header); control; control = CMSG_NXTHDR(&header, control)) {
+                if (control->cmsg_level != SOL_SOCKET) {
+                    continue;
+                }
+                if (control->cmsg_type == SCM_TIMESTAMPING) {
+                    scm_timestamping stamps;
+                    memcpy(&stamps, CMSG_DATA(control), sizeof(stamps));
+                    // ts[2] is the raw hardware stamp, ts[0] the software one
+                    const bool hardware = stamps.ts[2].tv_sec != 0 || stamps.ts[2].tv_nsec != 0;
+                    const timespec &stamp = hardware ? stamps.ts[2] : stamps.ts[0];
+                    if (stamp.tv_sec == 0 && stamp.tv_nsec == 0) {
+                        continue;
+                    }
+                    (hardware ? counters.hardwareTimestamps : counters.softwareTimestamps).fetch_add(1, std::memory_order_relaxed);
+                    const qint64 stampUs = static_cast<qint64>(stamp.tv_sec) * 1000000 + stamp.tv_nsec / 1000;
+                    counters.rxLatency.record(static_cast<uint64_t>(qMax<qint64>(0, nowUs - stampUs)));
+                } else if (control->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t dropped;
+                    memcpy(&dropped, CMSG_DATA(control), sizeof(dropped));
+                    counters.rxOverflows.store(dropped, std::memory_order_relaxed);
+                }
+            }
+
+            const can_frame &frame = b.rxFrames[i];
+            if (!(frame.can_id & CAN_EFF_FLAG) || (frame.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG))) {
+                continue;
+            }
+            if (batchCount == static_cast<int>(rxBatch.size())) {
+                rxBatch.resize(rxBatch.size() * 2);
+            }
+            if (assembler.addFrame(frame.can_id & CAN_EFF_MASK, qMin<unsigned char>(frame.can_dlc, 8), frame.data, nowMs,
+                                   rxBatch[batchCount])) {
+                batchCount++;
+            }
+        }
+        if (count < BatchSize) {
+            break;
+        }
+    }
+
+    assembler.expire(frameClock.elapsed());
+    if (batchCount > 0) {
+        counters.messagesReceived.fetch_add(static_cast<quint64>(batchCount), std::memory_order_relaxed);
+        emit nmea2000MessagesReceived(rxBatch.data(), batchCount);
+    }
+}
+
+bool SocketCanTransport::queueMessage(const tN2kMsg &N2kMsg)
+{
+    Buffers &b = *buffers;
+    if (!isOpen() || b.txPending() >= MaxBacklogFrames) {
+        counters.txDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    unsigned char sequence = 0;
+    if (assembler.isFastPacket(N2kMsg.PGN) && N2kMsg.DataLen > 8) {
+        uint8_t &next = sequences[(uint32_t(N2kMsg.Source) << 24) | N2kMsg.PGN];
+        sequence = next;
+        next = (next + 1) & 0x7;
+    }
+    N2kFrameAssembler::Frame frames[N2kFrameAssembler::MaxFrames];
+    const int count = assembler.fragment(N2kMsg, sequence, frames);
+    if (count == 0) {
+        counters.txDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Drop what the interface already took before the backlog grows
+    if (b.txSent > 0 && b.txSent >= b.txFrames.size() / 2) {
+        b.txFrames.erase(b.txFrames.begin(), b.txFrames.begin() + static_cast<std::ptrdiff_t>(b.txSent));
+        b.txSent = 0;
+    }
+    for (int i = 0; i < count; i++) {
+        can_frame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.can_id = static_cast<canid_t>(frames[i].canId) | CAN_EFF_FLAG;
+        frame.can_dlc = frames[i].len;
+        memcpy(frame.data, frames[i].data, frames[i].len);
+        b.txFrames.push_back(frame);
+    }
+    counters.messagesSent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void SocketCanTransport::scheduleFlush()
+{
+    // Everything queued in this event loop pass goes out together
+    if (!flushPending && !writeNotifier->isEnabled()) {
+        flushPending = true;
+        QMetaObject::invokeMethod(this, &SocketCanTransport::Flush, Qt::QueuedConnection);
+    }
+}
+
+bool SocketCanTransport::SendMessage(const tN2kMsg &N2kMsg)
+{
+    if (!queueMessage(N2kMsg)) {
+        return false;
+    }
+    scheduleFlush();
+    return true;
+}
+
+bool SocketCanTransport::SendMessages(const tN2kMsg *N2kMsgs, int count)
+{
+    int queued = 0;
+    while (queued < count && queueMessage(N2kMsgs[queued])) {
+        queued++;
+    }
+    if (queued > 0) {
+        scheduleFlush();
+    }
+    return queued == count;
+}
+
+void SocketCanTransport::Flush()
+{
+    flushPending = false;
+    if (!isOpen()) {
+        return;
+    }
+    Buffers &b = *buffers;
+    while (b.txPending() > 0) {
+        const int count = static_cast<int>(qMin<size_t>(BatchSize, b.txPending()));
+        for (int i = 0; i < count; i++) {
+            b.txVectors[i] = {&b.txFrames[b.txSent + static_cast<size_t>(i)], sizeof(can_frame)};
+        }
+        const int sent = sendmmsg(socketFd, b.txHeaders, static_cast<unsigned int>(count), MSG_DONTWAIT);
+        if (sent <= 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Socket buffer full, carry on when it drains
+                writeNotifier->setEnabled(true);
+            } else if (errno == ENOBUFS) {
+                // The interface queue is full; the socket itself stays writable, so poll instead
+                if (!flushPending) {
+                    flushPending = true;
+                    QTimer::singleShot(1, this, &SocketCanTransport::Flush);
+                }
+            } else {
+                qWarning() << "CAN send failed:" << strerror(errno);
+                b.txFrames.clear();
+                b.txSent = 0;
+            }
+            return;
+        }
+        counters.sendCalls.fetch_add(1, std::memory_order_relaxed);
+        counters.framesSent.fetch_add(static_cast<quint64>(sent), std::memory_order_relaxed);
+        b.txSent += static_cast<size_t>(sent);
+    }
+    b.txFrames.clear();
+    b.txSent = 0;
+}
+
+void SocketCanTransport::onWritable()
+{
+    writeNotifier->setEnabled(false);
+    Flush();
+}
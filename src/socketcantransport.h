@@ -0,0 +1,119 @@
+#ifndef SOCKETCANTRANSPORT_H
+#define SOCKETCANTRANSPORT_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "latencyhistogram.h"
+#include "n2kframeassembler.h"
+#include "n2ktransport.h"
+
+class QSocketNotifier;
+
+// NMEA2000 straight on a Linux CAN interface (can0 on the Pi, vcan0 for tests) through a raw SocketCAN
+// socket, without the library's per frame read()/write() loop:
+//
+//   - every readable notification drains the socket with recvmmsg in batches of BatchSize frames,
+//     reassembles fast packets and transport sessions with N2kFrameAssembler and hands the completed
+//     messages over in one nmea2000MessagesReceived
+//   - SO_TIMESTAMPING asks for hardware receive timestamps and falls back to the kernel's software
+//     ones; the delay from that timestamp until the frame is read goes into rxLatency
+//   - sent messages are split with N2kFrameAssembler::fragment and queued; the queue goes out with
+//     sendmmsg on the next event loop pass, so a drained transmit ring costs a few system calls. When
+//     the socket or the interface queue is full the rest is sent once there is room again. Transport
+//     sessions go out as BAM only: an addressed message over 8 bytes that is not a fast packet would
+//     need the receiver's CTS answers and counts as txDropped
+//   - with a PGN list, CAN_RAW_FILTER lets the kernel drop every other PGN before it reaches us
+//
+// The counters live outside the transport so they outlast it; any thread may take a snapshot.
+class SocketCanTransport : public N2kTransport
+{
+    Q_OBJECT
+
+public:
+    struct Statistics {
+        quint64 framesReceived = 0;
+        quint64 framesSent = 0;
+        quint64 messagesReceived = 0;   // Completed by the assembler
+        quint64 messagesSent = 0;
+        quint64 receiveCalls = 0;       // recvmmsg calls that returned frames
+        quint64 sendCalls = 0;          // sendmmsg calls that took frames
+        quint64 txDropped = 0;          // Messages refused: backlog full, or not sendable without RTS/CTS
+        quint64 rxOverflows = 0;        // Frames the kernel dropped because the socket buffer was full
+        quint64 hardwareTimestamps = 0;
+        quint64 softwareTimestamps = 0;
+        int filters = 0;                // Kernel filters installed, 0 receives everything
+        LatencyHistogram::Snapshot rxLatency;
+
+        double framesPerCall() const
+        {
+            const quint64 calls = receiveCalls + sendCalls;
+            return calls ? static_cast<double>(framesReceived + framesSent) / calls : 0.0;
+        }
+    };
+
+    struct Counters {
+        std::atomic<quint64> framesReceived{0};
+        std::atomic<quint64> framesSent{0};
+        std::atomic<quint64> messagesReceived{0};
+        std::atomic<quint64> messagesSent{0};
+        std::atomic<quint64> receiveCalls{0};
+        std::atomic<quint64> sendCalls{0};
+        std::atomic<quint64> txDropped{0};
+        std::atomic<quint64> rxOverflows{0};
+        std::atomic<quint64> hardwareTimestamps{0};
+        std::atomic<quint64> softwareTimestamps{0};
+        std::atomic<int> filters{0};
+        LatencyHistogram rxLatency;
+
+        Statistics snapshot() const;
+        void reset();
+    };
+
+    // Frames per recvmmsg/sendmmsg call
+    static constexpr int BatchSize = 64;
+    // Frames waiting for the interface before SendMessage refuses new messages
+    static constexpr size_t MaxBacklogFrames = 8192;
+    // CAN_RAW_FILTER_MAX; longer PGN lists receive everything instead
+    static constexpr int MaxFilters = 512;
+
+    explicit SocketCanTransport(Counters &counters, QObject *parent = nullptr);
+    ~SocketCanTransport();
+
+    // pgns limits reception to these PGNs (plus the transport protocol ones), empty receives everything
+    bool open(const QString &interfaceName, const std::vector<unsigned long> &pgns, QString *error = nullptr);
+    void close();
+    bool isOpen() const { return socketFd >= 0; }
+
+    bool SendMessage(const tN2kMsg &N2kMsg) override;
+    bool SendMessages(const tN2kMsg *N2kMsgs, int count) override;
+    void Flush() override;
+
+private slots:
+    void onReadable();
+    void onWritable();
+
+private:
+    struct Buffers;
+
+    Counters &counters;
+    int socketFd = -1;
+    QSocketNotifier *readNotifier = nullptr;
+    QSocketNotifier *writeNotifier = nullptr;
+    std::unique_ptr<Buffers> buffers;
+
+    N2kFrameAssembler assembler;
+    QElapsedTimer frameClock;
+    std::vector<tN2kMsg> rxBatch;
+    // Fast packet sequence per source and PGN
+    std::unordered_map<uint32_t, uint8_t> sequences;
+    bool flushPending = false;
+
+    bool queueMessage(const tN2kMsg &N2kMsg);
+    void scheduleFlush();
+};
+
+#endif // SOCKETCANTRANSPORT_H
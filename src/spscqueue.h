@@ -0,0 +1,107 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free single-producer/single-consumer ring. One thread may push, one other thread
+// may pop; neither ever blocks. Capacity is rounded up to a power of two.
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t minCapacity)
+        : capacity(roundUpPow2(minCapacity))
+        , mask(capacity - 1)
+        , items(new T[capacity])
+    {}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Producer side. Returns false if the ring is full.
+    bool tryPush(const T &item)
+    {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - cachedHead == capacity) {
+            cachedHead = headIndex.load(std::memory_order_acquire);
+            if (tail - cachedHead == capacity) {
+                return false;
+            }
+        }
+        items[tail & mask] = item;
+        tailIndex.store(tail + 1, std::memory_order_release);
+
+        const size_t depth = tail + 1 - cachedHead;
+        if (depth > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(depth, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool tryPop(T &item)
+    {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == cachedTail) {
+            cachedTail = tailIndex.load(std::memory_order_acquire);
+            if (head == cachedTail) {
+                return false;
+            }
+        }
+        item = items[head & mask];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Pops up to maxCount items into out, returns the number popped.
+    size_t popBulk(T *out, size_t maxCount)
+    {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        cachedTail = tailIndex.load(std::memory_order_acquire);
+        size_t count = cachedTail - head;
+        if (count > maxCount) {
+            count = maxCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            out[i] = items[(head + i) & mask];
+        }
+        headIndex.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Approximate when called while the other side is active
+    size_t size() const
+    {
+        return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+    }
+    bool isEmpty() const { return size() == 0; }
+    size_t getCapacity() const { return capacity; }
+    size_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t CacheLine = 64;
+
+    static size_t roundUpPow2(size_t value)
+    {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<T[]> items;
+
+    // Each side owns its index and a cached copy of the other one, kept on separate cache lines
+    alignas(CacheLine) std::atomic<size_t> headIndex{0};
+    size_t cachedTail = 0;
+    alignas(CacheLine) std::atomic<size_t> tailIndex{0};
+    size_t cachedHead = 0;
+    std::atomic<size_t> highWater{0};
+};
+
+#endif // SPSCQUEUE_H
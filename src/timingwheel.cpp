@@ -0,0 +1,104 @@
+#include "timingwheel.h"
+
+TimingWheel::TimingWheel(uint64_t startTick)
+    : current(startTick)
+{
+    for (Handle &head : heads) {
+        head = InvalidHandle;
+    }
+}
+
+TimingWheel::Handle TimingWheel::allocate()
+{
+    if (!freeHandles.empty()) {
+        Handle handle = freeHandles.back();
+        freeHandles.pop_back();
+        return handle;
+    }
+    nodes.push_back(Node());
+    return static_cast<Handle>(nodes.size() - 1);
+}
+
+void TimingWheel::release(Handle handle)
+{
+    cancel(handle);
+    freeHandles.push_back(handle);
+}
+
+void TimingWheel::schedule(Handle handle, uint64_t dueTick)
+{
+    unlink(handle);
+    nodes[handle].firing = false;
+
+    // While advancing the current tick has already been expired
+    const uint64_t earliest = advancing ? current + 1 : current;
+    nodes[handle].due = dueTick < earliest ? earliest : dueTick;
+    link(handle, slotFor(nodes[handle].due));
+}
+
+void TimingWheel::cancel(Handle handle)
+{
+    unlink(handle);
+    nodes[handle].firing = false;
+}
+
+uint32_t TimingWheel::slotFor(uint64_t due) const
+{
+    const uint64_t distance = due ^ current;
+    for (int level = 0; level < Levels; level++) {
+        if ((distance >> (SlotBits * (level + 1))) == 0) {
+            return level * SlotsPerLevel + ((due >> (SlotBits * level)) & SlotMask);
+        }
+    }
+    return OverflowSlot;
+}
+
+void TimingWheel::link(Handle handle, uint32_t slot)
+{
+    Node &node = nodes[handle];
+    node.slot = slot;
+    node.prev = InvalidHandle;
+    node.next = heads[slot];
+    if (node.next != InvalidHandle) {
+        nodes[node.next].prev = handle;
+    }
+    heads[slot] = handle;
+    scheduled++;
+}
+
+void TimingWheel::unlink(Handle handle)
+{
+    Node &node = nodes[handle];
+    if (node.slot == NoSlot) {
+        return;
+    }
+
+    if (node.prev != InvalidHandle) {
+        nodes[node.prev].next = node.next;
+    } else {
+        heads[node.slot] = node.next;
+    }
+    if (node.next != InvalidHandle) {
+        nodes[node.next].prev = node.prev;
+    }
+    node.prev = InvalidHandle;
+    node.next = InvalidHandle;
+    node.slot = NoSlot;
+    scheduled--;
+}
+
+void TimingWheel::cascade(uint32_t slot)
+{
+    Handle h = heads[slot];
+    heads[slot] = InvalidHandle;
+
+    while (h != InvalidHandle) {
+        Handle next = nodes[h].next;
+        nodes[h].slot = NoSlot;
+        nodes[h].prev = InvalidHandle;
+        nodes[h].next = InvalidHandle;
+        scheduled--;
+        link(h, slotFor(nodes[h].due));
+        h = next;
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel: four levels of 64 slots cover 2^24 ticks (about 4.6 hours at 1 ms),
+// later deadlines wait in an overflow list. Timers are identified by small integer handles and
+// linked intrusively through preallocated node arrays, so scheduling, cancelling and expiring are
+// O(1) with no allocation after the handle pool has grown.
+class TimingWheel
+{
+public:
+    using Handle = uint32_t;
+    static constexpr Handle InvalidHandle = 0xFFFFFFFF;
+
+    explicit TimingWheel(uint64_t startTick = 0);
+
+    Handle allocate();
+    void release(Handle handle);
+
+    // Due ticks already passed expire on the next tick that is processed
+    void schedule(Handle handle, uint64_t dueTick);
+    void cancel(Handle handle);
+    bool isScheduled(Handle handle) const { return nodes[handle].slot != NoSlot; }
+    uint64_t dueTick(Handle handle) const { return nodes[handle].due; }
+
+    // Advances to toTick and calls onExpired(handle, dueTick) for every timer that came due.
+    // The callback may schedule or cancel any timer, including the one that expired.
+    template<typename ExpiredHandler>
+    void advance(uint64_t toTick, ExpiredHandler &&onExpired);
+
+    uint64_t now() const { return current; }
+    std::size_t scheduledCount() const { return scheduled; }
+
+private:
+    static constexpr int Levels = 4;
+    static constexpr int SlotBits = 6;
+    static constexpr int SlotsPerLevel = 1 << SlotBits;
+    static constexpr uint32_t SlotMask = SlotsPerLevel - 1;
+    static constexpr uint32_t NoSlot = 0xFFFFFFFF;
+    static constexpr uint32_t OverflowSlot = Levels * SlotsPerLevel;
+    static constexpr uint32_t ListCount = OverflowSlot + 1;
+
+    struct Node {
+        uint64_t due = 0;
+        Handle prev = InvalidHandle;
+        Handle next = InvalidHandle;
+        uint32_t slot = NoSlot;
+        bool firing = false;
+    };
+
+    uint64_t current;
+    bool advancing = false;
+    std::size_t scheduled = 0;
+    std::vector<Node> nodes;
+    std::vector<Handle> freeHandles;
+    Handle heads[ListCount];
+    std::vector<Handle> expiring;
+
+    uint32_t slotFor(uint64_t due) const;
+    void link(Handle handle, uint32_t slot);
+    void unlink(Handle handle);
+    void cascade(uint32_t slot);
+};
+
+template<typename ExpiredHandler>
+void TimingWheel::advance(uint64_t toTick, ExpiredHandler &&onExpired)
+{
+    advancing = true;
+    for (; current <= toTick; current++) {
+        // Entering a new page of a level moves that level's slot one level down, top level first
+        if (current != 0) {
+            if ((current & ((uint64_t(1) << (SlotBits * Levels)) - 1)) == 0) {
+                cascade(OverflowSlot);
+            }
+            for (int level = Levels - 1; level >= 1; level--) {
+                const uint64_t pageMask = (uint64_t(1) << (SlotBits * level)) - 1;
+                if ((current & pageMask) == 0) {
+                    cascade(level * SlotsPerLevel + ((current >> (SlotBits * level)) & SlotMask));
+                }
+            }
+        }
+
+        const uint32_t slot = current & SlotMask;
+        if (heads[slot] != InvalidHandle) {
+            // Detach first so callbacks can reschedule freely
+            expiring.clear();
+            for (Handle h = heads[slot]; h != InvalidHandle; h = nodes[h].next) {
+                expiring.push_back(h);
+            }
+            for (Handle h : expiring) {
+                unlink(h);
+                nodes[h].firing = true;
+            }
+            for (Handle h : expiring) {
+                // Skip timers an earlier callback cancelled or moved
+                if (nodes[h].firing) {
+                    nodes[h].firing = false;
+                    onExpired(h, nodes[h].due);
+                }
+            }
+        }
+    }
+    advancing = false;
+}
+
+#endif // TIMINGWHEEL_H
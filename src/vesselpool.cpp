@@ -0,0 +1,254 @@
+#include "vesselpool.h"
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <QtMath>
+#include <cmath>
+
+VesselPool::VesselPool(QObject *parent)
+    : QObject(parent)
+{
+}
+
+int VesselPool::addRoute(const RouteGeometry &geometry)
+{
+    return addRoute(std::make_shared<const RouteGeometry>(geometry));
+}
+
+int VesselPool::addRoute(std::shared_ptr<const RouteGeometry> geometry)
+{
+    if (!geometry || geometry->legCount() == 0) {
+        return -1;
+    }
+    routes.push_back(std::move(geometry));
+    return routeCount() - 1;
+}
+
+int VesselPool::addVessel(int route, const VesselOptions &options)
+{
+    if (route < 0 || route >= routeCount()) {
+        return -1;
+    }
+    const RouteGeometry &geometry = *routes[route];
+    double start = qBound(0.0, options.startDistanceM, geometry.totalLength());
+    int startLeg = geometry.legAt(start);
+    double along = start - geometry.cumulativeDistance(startLeg);
+
+    ids.push_back(options.id);
+    routeIndex.push_back(route);
+    leg.push_back(startLeg);
+    legDistance.push_back(options.reverse ? geometry.length(startLeg) - along : along);
+    speed.push_back(qMax(0.0, options.speed));
+    direction.push_back(options.reverse ? -1 : 1);
+    endAction.push_back(options.endAction);
+    // A route of zero length gives nothing to sail and would never leave its first leg
+    stopped.push_back(geometry.totalLength() > 0.0 ? 0 : 1);
+    latitude.push_back(0.0);
+    longitude.push_back(0.0);
+    course.push_back(0.0);
+    distanceToWaypoint.push_back(0.0);
+
+    int vessel = vesselCount() - 1;
+    updatePosition(vessel, geometry);
+    return vessel;
+}
+
+void VesselPool::setVesselSpeed(int vessel, double metersPerSecond)
+{
+    if (vessel >= 0 && vessel < vesselCount()) {
+        speed[vessel] = qMax(0.0, metersPerSecond);
+    }
+}
+
+void VesselPool::reserve(int vessels)
+{
+    size_t count = static_cast<size_t>(qMax(0, vessels));
+    ids.reserve(count);
+    routeIndex.reserve(count);
+    leg.reserve(count);
+    legDistance.reserve(count);
+    speed.reserve(count);
+    direction.reserve(count);
+    endAction.reserve(count);
+    stopped.reserve(count);
+    latitude.reserve(count);
+    longitude.reserve(count);
+    course.reserve(count);
+    distanceToWaypoint.reserve(count);
+}
+
+void VesselPool::clear()
+{
+    ids.clear();
+    routeIndex.clear();
+    leg.clear();
+    legDistance.clear();
+    speed.clear();
+    direction.clear();
+    endAction.clear();
+    stopped.clear();
+    latitude.clear();
+    longitude.clear();
+    course.clear();
+    distanceToWaypoint.clear();
+    routes.clear();
+    stats = Statistics();
+}
+
+void VesselPool::setClock(SimulationClock *simulationClock)
+{
+    if (simulationClock == clock) {
+        return;
+    }
+    if (clock) {
+        disconnect(clock, &SimulationClock::tick, this, &VesselPool::onClockTick);
+    }
+    clock = simulationClock;
+    if (clock) {
+        connect(clock, &SimulationClock::tick, this, &VesselPool::onClockTick);
+    }
+}
+
+void VesselPool::start()
+{
+    pendingMs = 0;
+    running = true;
+}
+
+void VesselPool::stop()
+{
+    running = false;
+}
+
+void VesselPool::onClockTick(qint64 nowMs, qint64 deltaMs)
+{
+    if (!running) {
+        return;
+    }
+
+    // Movement is integrated exactly along the route, so a large clock step is one update, not many
+    pendingMs += deltaMs;
+    if (pendingMs >= updateIntervalMs) {
+        qint64 elapsedMs = pendingMs;
+        pendingMs = 0;
+        timeMs = nowMs - elapsedMs;
+        advance(elapsedMs);
+    }
+}
+
+void VesselPool::advance(qint64 deltaMs)
+{
+    QElapsedTimer overhead;
+    overhead.start();
+
+    timeMs += deltaMs;
+    int count = vesselCount();
+    double seconds = deltaMs / 1000.0;
+    if (count >= 2 * ChunkSize) {
+        // Equal chunks over the thread pool; idle workers pick up the remaining chunks
+        std::vector<int> chunks;
+        chunks.reserve(count / ChunkSize + 1);
+        for (int first = 0; first < count; first += ChunkSize) {
+            chunks.push_back(first);
+        }
+        QtConcurrent::blockingMap(chunks, [this, count, seconds](int first) {
+            advanceRange(first, qMin(first + ChunkSize, count), seconds);
+        });
+    } else {
+        advanceRange(0, count, seconds);
+    }
+
+    double updateUs = overhead.nsecsElapsed() / 1000.0;
+    stats.updates++;
+    stats.lastUpdateUs = updateUs;
+    stats.maxUpdateUs = qMax(stats.maxUpdateUs, updateUs);
+
+    emit vesselsUpdated(batch());
+}
+
+void VesselPool::advanceRange(int first, int last, double seconds)
+{
+    for (int vessel = first; vessel < last; ++vessel) {
+        if (stopped[vessel]) {
+            continue;
+        }
+        const RouteGeometry &geometry = *routes[routeIndex[vessel]];
+        int legCount = geometry.legCount();
+        int current = leg[vessel];
+        int heading = direction[vessel];
+        double covered = legDistance[vessel] + speed[vessel] * seconds;
+
+        // Whole laps change nothing: a loop repeats every route length, back and forth every two
+        double period = 2.0 * geometry.totalLength();
+        if (endAction[vessel] != EndAction::Stop && covered > period) {
+            covered = std::fmod(covered, period);
+        }
+
+        while (covered >= geometry.length(current)) {
+            int next = current + heading;
+            if (next >= 0 && next < legCount) {
+                covered -= geometry.length(current);
+                current = next;
+                continue;
+            }
+            if (endAction[vessel] == EndAction::Stop) {
+                covered = geometry.length(current);
+                stopped[vessel] = 1;
+                break;
+            }
+            covered -= geometry.length(current);
+            if (endAction[vessel] == EndAction::Loop) {
+                current = heading > 0 ? 0 : legCount - 1;
+            } else {
+                heading = -heading;
+            }
+        }
+
+        leg[vessel] = current;
+        direction[vessel] = static_cast<int8_t>(heading);
+        legDistance[vessel] = covered;
+        updatePosition(vessel, geometry);
+    }
+}
+
+void VesselPool::updatePosition(int vessel, const RouteGeometry &geometry)
+{
+    int current = leg[vessel];
+    double length = geometry.length(current);
+    double covered = legDistance[vessel];
+    bool forward = direction[vessel] > 0;
+
+    RouteGeometry::Point point = geometry.pointAt(current, forward ? covered : length - covered);
+    double bearing = forward ? point.bearing : point.bearing + M_PI;
+    if (bearing >= 2.0 * M_PI) {
+        bearing -= 2.0 * M_PI;
+    }
+
+    latitude[vessel] = point.latitude;
+    longitude[vessel] = point.longitude;
+    course[vessel] = bearing;
+    distanceToWaypoint[vessel] = length - covered;
+}
+
+VesselPool::Batch VesselPool::batch() const
+{
+    Batch result;
+    result.count = vesselCount();
+    result.timeMs = timeMs;
+    result.ids = ids.data();
+    result.latitudes = latitude.data();
+    result.longitudes = longitude.data();
+    result.courses = course.data();
+    result.speeds = speed.data();
+    result.distancesToWaypoint = distanceToWaypoint.data();
+    result.legs = leg.data();
+    result.stopped = stopped.data();
+    return result;
+}
+
+VesselPool::Statistics VesselPool::statistics() const
+{
+    Statistics result = stats;
+    result.vessels = vesselCount();
+    result.routes = routeCount();
+    return result;
+}
@@ -0,0 +1,115 @@
+#ifndef VESSELPOOL_H
+#define VESSELPOOL_H
+
+#include <QObject>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "routegeometry.h"
+#include "simulationclock.h"
+
+// Many simulated vessels (AIS targets, marina traffic) each following its own route. Routes are
+// compiled once and shared; the per vessel state lives in parallel arrays indexed by vessel, so a
+// tick walks contiguous memory and large pools are split into chunks advanced on all cores. Each
+// update publishes the whole pool as one batch instead of per vessel signals.
+class VesselPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class EndAction : uint8_t {
+        Stop,       // Stays on the last waypoint
+        Loop,       // Jumps back to the first waypoint
+        Reverse     // Sails the route back and forth
+    };
+
+    struct VesselOptions {
+        uint32_t id = 0;                // MMSI or any caller defined key
+        double speed = 5.0;             // m/s
+        double startDistanceM = 0.0;    // Along the route from its first waypoint
+        bool reverse = false;           // Start by sailing from the last waypoint
+        EndAction endAction = EndAction::Loop;
+    };
+
+    // Columns of the pool after an update, valid only during the vesselsUpdated emission
+    struct Batch {
+        int count = 0;
+        qint64 timeMs = 0;
+        const uint32_t *ids = nullptr;
+        const double *latitudes = nullptr;      // degrees
+        const double *longitudes = nullptr;     // degrees
+        const double *courses = nullptr;        // radians, direction of travel
+        const double *speeds = nullptr;         // m/s, stopped vessels keep their set speed
+        const double *distancesToWaypoint = nullptr;    // meters to the end of the current leg
+        const int32_t *legs = nullptr;
+        const uint8_t *stopped = nullptr;
+    };
+
+    struct Statistics {
+        int vessels = 0;
+        int routes = 0;
+        quint64 updates = 0;
+        double lastUpdateUs = 0.0;
+        double maxUpdateUs = 0.0;
+    };
+
+    explicit VesselPool(QObject *parent = nullptr);
+
+    // Routes without legs are rejected with -1
+    int addRoute(const RouteGeometry &geometry);
+    int addRoute(std::shared_ptr<const RouteGeometry> geometry);
+    int routeCount() const { return static_cast<int>(routes.size()); }
+    // Returns the vessel index, or -1 for an unknown route
+    int addVessel(int route, const VesselOptions &options);
+    int vesselCount() const { return static_cast<int>(ids.size()); }
+    void setVesselSpeed(int vessel, double speed);
+    void reserve(int vessels);
+    void clear();
+
+    void setClock(SimulationClock *simulationClock);
+    // Simulated time between published updates, positions are exact for any interval
+    void setUpdateIntervalMs(int intervalMs) { updateIntervalMs = qMax(1, intervalMs); }
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Moves every vessel deltaMs along its route and publishes the batch
+    void advance(qint64 deltaMs);
+    Batch batch() const;
+    Statistics statistics() const;
+
+signals:
+    // Points into the pool's columns, so receivers must be connected directly and copy what they keep
+    void vesselsUpdated(const VesselPool::Batch &batch);
+
+private slots:
+    void onClockTick(qint64 nowMs, qint64 deltaMs);
+
+private:
+    static constexpr int ChunkSize = 256;
+
+    std::vector<std::shared_ptr<const RouteGeometry>> routes;
+    SimulationClock *clock = nullptr;
+    bool running = false;
+    int updateIntervalMs = 1000;
+    qint64 pendingMs = 0;
+    qint64 timeMs = 0;
+    Statistics stats;
+
+    // Per vessel state
+    std::vector<uint32_t> ids;
+    std::vector<int32_t> routeIndex;
+    std::vector<int32_t> leg;
+    std::vector<double> legDistance;    // Covered on the current leg in the direction of travel, meters
+    std::vector<double> speed;
+    std::vector<int8_t> direction;      // +1 towards the last waypoint, -1 towards the first
+    std::vector<EndAction> endAction;
+    std::vector<uint8_t> stopped;
+    // Per vessel output
+    std::vector<double> latitude, longitude, course, distanceToWaypoint;
+
+    void advanceRange(int first, int last, double seconds);
+    void updatePosition(int vessel, const RouteGeometry &geometry);
+};
+
+#endif // VESSELPOOL_H
@@ -0,0 +1,358 @@
+#include "virtualn2kfleet.h"
+#include <QDebug>
+#include <QtMath>
+#include "N2kMessages.h"
+#include "nmea2000_actisense.h"
+#include "nmea2000handler.h"
+#include "pgnscheduler.h"
+
+VirtualN2kFleet::VirtualN2kFleet(Nmea2000Handler &handler, PgnScheduler &scheduler, QObject *parent)
+    : QObject(parent)
+    , handler(handler)
+    , scheduler(scheduler)
+{
+    addressOwner.fill(-1);
+    setClock(new SimulationClock(this));
+
+    handler.Dispatcher().registerHandler<60928>([this](const tN2kMsg &N2kMsg) { onAddressClaim(N2kMsg); });
+    handler.Dispatcher().registerHandler<59904>([this](const tN2kMsg &N2kMsg) { onIsoRequest(N2kMsg); });
+}
+
+void VirtualN2kFleet::setClock(SimulationClock *simulationClock)
+{
+    if (!simulationClock || simulationClock == clock) {
+        return;
+    }
+    if (clock && clock->parent() == this) {
+        clock->deleteLater();
+    }
+    // Keep the elapsed time across the switch
+    const qint64 elapsed = elapsedMs();
+    clock = simulationClock;
+    startMs = clock->nowMs() - elapsed;
+}
+
+uint64_t VirtualN2kFleet::buildName(const VirtualN2kDeviceConfig &config)
+{
+    uint64_t name = config.uniqueNumber & 0x1FFFFF;
+    name |= static_cast<uint64_t>(config.manufacturerCode & 0x7FF) << 21;
+    name |= static_cast<uint64_t>(config.deviceInstance & 0xFF) << 32;
+    name |= static_cast<uint64_t>(config.deviceFunction) << 40;
+    name |= static_cast<uint64_t>(config.deviceClass & 0x7F) << 49;
+    name |= static_cast<uint64_t>(config.systemInstance & 0x0F) << 56;
+    name |= static_cast<uint64_t>(config.industryGroup & 0x07) << 60;
+    name |= static_cast<uint64_t>(1) << 63; // Arbitrary address capable
+    return name;
+}
+
+int VirtualN2kFleet::addDevice(const VirtualN2kDeviceConfig &config)
+{
+    if (devices.size() >= MaxDevices) {
+        qWarning() << "Virtual fleet is full, cannot add" << config.label;
+        return -1;
+    }
+
+    Device device;
+    device.config = config;
+    if (device.config.uniqueNumber == 0) {
+        device.config.uniqueNumber = static_cast<uint32_t>(devices.size() + 1);
+    }
+    if (device.config.modelSerialCode.isEmpty()) {
+        device.config.modelSerialCode = QString::number(device.config.uniqueNumber);
+    }
+    device.name = buildName(device.config);
+    device.source = NullAddress;
+    device.modelIdUtf8 = device.config.modelId.toUtf8();
+    device.swCodeUtf8 = device.config.swCode.toUtf8();
+    device.modelVersionUtf8 = device.config.modelVersion.toUtf8();
+    device.serialCodeUtf8 = device.config.modelSerialCode.toUtf8();
+    devices.push_back(device);
+
+    int index = static_cast<int>(devices.size()) - 1;
+    if (isRunning()) {
+        assignAddress(index, config.preferredAddress);
+        sendAddressClaim(index);
+    }
+    return index;
+}
+
+int VirtualN2kFleet::addPgnStream(int device, unsigned long PGN, int periodMs, PgnGenerator generator)
+{
+    if (device < 0 || device >= deviceCount() || periodMs <= 0 || !generator) {
+        return -1;
+    }
+
+    PgnScheduler::StreamOptions options;
+    options.periodMs = periodMs;
+    int stream = scheduler.registerStream(PGN, options, [this, device, generator](tN2kMsg &N2kMsg) {
+        Device &d = devices[device];
+        if (!running || !isActive(d) || !generator(d, N2kMsg)) {
+            return false;
+        }
+        N2kMsg.Source = d.source;
+        stats.messagesGenerated++;
+        return true;
+    });
+    if (stream >= 0) {
+        streams.push_back(stream);
+    }
+    return stream;
+}
+
+void VirtualN2kFleet::clear()
+{
+    stop();
+    for (int stream : streams) {
+        scheduler.unregisterStream(stream);
+    }
+    streams.clear();
+    devices.clear();
+    addressOwner.fill(-1);
+    remoteOccupied.reset();
+}
+
+void VirtualN2kFleet::start()
+{
+    if (clock->parent() == this) {
+        clock->start();
+    }
+    startMs = clock->nowMs();
+    stats = Statistics();
+    running = true;
+
+    for (int i = 0; i < deviceCount(); i++) {
+        if (devices[i].source == NullAddress) {
+            assignAddress(i, devices[i].config.preferredAddress);
+        }
+        sendAddressClaim(i);
+    }
+}
+
+void VirtualN2kFleet::stop()
+{
+    running = false;
+    if (clock->parent() == this) {
+        clock->stop();
+    }
+}
+
+bool VirtualN2kFleet::isActive(Device &device)
+{
+    // Streams start once the claim went unchallenged for the settle time
+    if (device.state == ClaimState::Claiming && elapsedMs() - device.claimSentMs >= ClaimSettleMs) {
+        device.state = ClaimState::Active;
+    }
+    return device.state == ClaimState::Active;
+}
+
+VirtualN2kFleet::Statistics VirtualN2kFleet::statistics() const
+{
+    Statistics result = stats;
+    const qint64 elapsed = elapsedMs();
+    if (elapsed > 0) {
+        result.messagesPerSecond = stats.messagesGenerated * 1000.0 / elapsed;
+    }
+    return result;
+}
+
+bool VirtualN2kFleet::assignAddress(int device, uint8_t startAddress)
+{
+    Device &d = devices[device];
+    if (d.source < 252 && addressOwner[d.source] == device) {
+        addressOwner[d.source] = -1;
+    }
+
+    for (int i = 0; i < 252; i++) {
+        uint8_t address = static_cast<uint8_t>((startAddress + i) % 252);
+        if (addressOwner[address] < 0 && !remoteOccupied.test(address)) {
+            uint8_t oldAddress = d.source;
+            addressOwner[address] = static_cast<int16_t>(device);
+            d.source = address;
+            d.state = ClaimState::Claiming;
+            if (oldAddress != NullAddress && oldAddress != address) {
+                emit addressChanged(device, oldAddress, address);
+            }
+            return true;
+        }
+    }
+
+    d.source = NullAddress;
+    d.state = ClaimState::CannotClaim;
+    return false;
+}
+
+void VirtualN2kFleet::sendAddressClaim(int device)
+{
+    Device &d = devices[device];
+
+    tN2kMsg N2kMsg;
+    N2kMsg.SetPGN(60928L);
+    N2kMsg.Priority = 6;
+    N2kMsg.Destination = BroadcastAddress;
+    N2kMsg.Add8ByteUInt(d.name);
+
+    d.claimSentMs = elapsedMs();
+    stats.addressClaimsSent++;
+    send(N2kMsg, device);
+}
+
+void VirtualN2kFleet::sendProductInformation(int device, uint8_t destination)
+{
+    const Device &d = devices[device];
+
+    tN2kMsg N2kMsg;
+    N2kMsg.SetPGN(126996L);
+    N2kMsg.Priority = 6;
+    N2kMsg.Destination = destination;
+    N2kMsg.Add2ByteUInt(d.config.n2kVersion);
+    N2kMsg.Add2ByteUInt(d.config.productCode);
+    N2kMsg.AddStr(d.modelIdUtf8.constData(), 32);
+    N2kMsg.AddStr(d.swCodeUtf8.constData(), 32);
+    N2kMsg.AddStr(d.modelVersionUtf8.constData(), 32);
+    N2kMsg.AddStr(d.serialCodeUtf8.constData(), 32);
+    N2kMsg.AddByte(d.config.certificationLevel);
+    N2kMsg.AddByte(d.config.loadEquivalency);
+    send(N2kMsg, device);
+}
+
+bool VirtualN2kFleet::send(tN2kMsg &N2kMsg, int device)
+{
+    N2kMsg.Source = devices[device].source;
+    if (handler.SendMessage(N2kMsg)) {
+        stats.messagesSent++;
+        return true;
+    }
+    stats.sendFailures++;
+    return false;
+}
+
+void VirtualN2kFleet::onAddressClaim(const tN2kMsg &N2kMsg)
+{
+    if (N2kMsg.DataLen < 8 || N2kMsg.Source >= 252) {
+        return;
+    }
+
+    int index = 0;
+    uint64_t remoteName = N2kMsg.GetUInt64(index);
+    int owner = addressOwner[N2kMsg.Source];
+
+    if (owner < 0) {
+        remoteOccupied.set(N2kMsg.Source);
+        return;
+    }
+
+    Device &d = devices[owner];
+    if (d.name == remoteName) {
+        return; // Our own claim echoed back
+    }
+
+    stats.addressConflicts++;
+    if (d.name < remoteName) {
+        // Lower NAME wins, defend the address
+        sendAddressClaim(owner);
+        return;
+    }
+
+    remoteOccupied.set(N2kMsg.Source);
+    if (!assignAddress(owner, static_cast<uint8_t>(N2kMsg.Source + 1))) {
+        qWarning() << "Virtual device" << d.config.label << "cannot claim an address";
+    }
+    sendAddressClaim(owner);
+}
+
+void VirtualN2kFleet::onIsoRequest(const tN2kMsg &N2kMsg)
+{
+    unsigned long requestedPGN;
+    if (!NMEA2000_Actisense::ParseN2kPGN59904(N2kMsg, requestedPGN)) {
+        return;
+    }
+
+    auto answer = [this, requestedPGN, &N2kMsg](int device) {
+        if (requestedPGN == 60928L) {
+            sendAddressClaim(device);
+        } else if (requestedPGN == 126996L && devices[device].state == ClaimState::Active) {
+            sendProductInformation(device, N2kMsg.Source);
+        } else {
+            return;
+        }
+        stats.requestsAnswered++;
+    };
+
+    if (N2kMsg.Destination == BroadcastAddress) {
+        for (int i = 0; i < deviceCount(); i++) {
+            answer(i);
+        }
+    } else if (addressOwner[N2kMsg.Destination] >= 0) {
+        answer(addressOwner[N2kMsg.Destination]);
+    }
+}
+
+void VirtualN2kFleet::addStandardBoat(int engineCount, int tankCount)
+{
+    auto seconds = [this]() { return elapsedMs() / 1000.0; };
+
+    VirtualN2kDeviceConfig gps;
+    gps.label = "GPS";
+    gps.preferredAddress = 10;
+    gps.deviceFunction = 145;
+    gps.deviceClass = 60;
+    int gpsDevice = addDevice(gps);
+    addPgnStream(gpsDevice, 129025L, 100, [seconds](const Device &, tN2kMsg &N2kMsg) {
+        SetN2kPGN129025(N2kMsg, 26.1 + seconds() * 1e-6, -80.1);
+        return true;
+    });
+    addPgnStream(gpsDevice, 129026L, 250, [](const Device &, tN2kMsg &N2kMsg) {
+        SetN2kPGN129026(N2kMsg, 1, N2khr_true, qDegreesToRadians(45.0), 5.0);
+        return true;
+    });
+
+    for (int i = 0; i < engineCount; i++) {
+        VirtualN2kDeviceConfig engine;
+        engine.label = QString("Engine %1").arg(i);
+        engine.preferredAddress = static_cast<uint8_t>(20 + i);
+        engine.deviceInstance = static_cast<uint8_t>(i);
+        engine.deviceFunction = 140;
+        engine.deviceClass = 50;
+        int engineDevice = addDevice(engine);
+        addPgnStream(engineDevice, 127488L, 100, [i, seconds](const Device &, tN2kMsg &N2kMsg) {
+            SetN2kPGN127488(N2kMsg, static_cast<unsigned char>(i), 2500 + 100 * qSin(seconds() / 10.0 + i));
+            return true;
+        });
+    }
+
+    for (int i = 0; i < tankCount; i++) {
+        VirtualN2kDeviceConfig tank;
+        tank.label = QString("Tank %1").arg(i);
+        tank.preferredAddress = static_cast<uint8_t>(40 + i);
+        tank.deviceInstance = static_cast<uint8_t>(i);
+        tank.deviceFunction = 150;
+        tank.deviceClass = 75;
+        int tankDevice = addDevice(tank);
+        addPgnStream(tankDevice, 127505L, 2500, [i](const Device &, tN2kMsg &N2kMsg) {
+            SetN2kPGN127505(N2kMsg, static_cast<unsigned char>(i), N2kft_Fuel, 75.0, 400.0);
+            return true;
+        });
+    }
+
+    VirtualN2kDeviceConfig wind;
+    wind.label = "Wind";
+    wind.preferredAddress = 60;
+    wind.deviceFunction = 130;
+    wind.deviceClass = 85;
+    int windDevice = addDevice(wind);
+    addPgnStream(windDevice, 130306L, 100, [seconds](const Device &, tN2kMsg &N2kMsg) {
+        SetN2kPGN130306(N2kMsg, 1, 6.0 + qSin(seconds()), qDegreesToRadians(40.0), N2kWind_Apparent);
+        return true;
+    });
+
+    VirtualN2kDeviceConfig depth;
+    depth.label = "Depth";
+    depth.preferredAddress = 70;
+    depth.deviceFunction = 130;
+    depth.deviceClass = 60;
+    int depthDevice = addDevice(depth);
+    addPgnStream(depthDevice, 128267L, 1000, [seconds](const Device &, tN2kMsg &N2kMsg) {
+        SetN2kPGN128267(N2kMsg, 1, 12.0 + qSin(seconds() / 30.0), 0.5);
+        return true;
+    });
+}
@@ -0,0 +1,139 @@
+#ifndef VIRTUALN2KFLEET_H
+#define VIRTUALN2KFLEET_H
+
+#include <QObject>
+#include <QString>
+#include <array>
+#include <bitset>
+#include <functional>
+#include <vector>
+#include "N2kMsg.h"
+#include "simulationclock.h"
+
+class Nmea2000Handler;
+class PgnScheduler;
+
+// Identity of one simulated NMEA2000 node
+struct VirtualN2kDeviceConfig {
+    QString label;
+    uint8_t preferredAddress = 0;
+
+    // ISO 11783 NAME fields
+    uint32_t uniqueNumber = 0;         // 21 bits
+    uint16_t manufacturerCode = 2046;  // 11 bits
+    uint8_t deviceInstance = 0;
+    uint8_t deviceFunction = 130;
+    uint8_t deviceClass = 25;
+    uint8_t systemInstance = 0;
+    uint8_t industryGroup = 4;         // Marine
+
+    // Product information (PGN 126996)
+    uint16_t n2kVersion = 2101;
+    uint16_t productCode = 100;
+    QString modelId = "RayNmeaSim Virtual";
+    QString swCode = APP_VERSION;
+    QString modelVersion = "1.0";
+    QString modelSerialCode;
+    uint8_t certificationLevel = 1;
+    uint8_t loadEquivalency = 1;
+};
+
+// Many virtual N2K nodes multiplexed over the one transport owned by Nmea2000Handler. Every device
+// has its own NAME, source address, product information and periodic PGN streams, and takes part in
+// address claiming. The streams run on the shared PgnScheduler, which the owner drives and whose
+// sink it points at the transport. Claim settling and the generated values follow the simulation
+// clock, so they keep pace with an accelerated or stepped run. Address ownership is tracked in 256 entry tables so claims, conflicts and
+// requests cost the same with 5 or 250 devices.
+//
+// Note that the NGT-1 transmits everything with its own source address; per device sources only
+// reach the bus through a raw CAN or virtual transport.
+class VirtualN2kFleet : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class ClaimState { Claiming, Active, CannotClaim };
+
+    struct Device {
+        VirtualN2kDeviceConfig config;
+        uint64_t name = 0;
+        uint8_t source = 0;
+        ClaimState state = ClaimState::Claiming;
+        qint64 claimSentMs = 0;
+        QByteArray modelIdUtf8, swCodeUtf8, modelVersionUtf8, serialCodeUtf8;
+    };
+
+    // Fills N2kMsg for the device, returns false to skip this period
+    using PgnGenerator = std::function<bool(const Device &device, tN2kMsg &N2kMsg)>;
+
+    struct Statistics {
+        quint64 messagesGenerated = 0;
+        quint64 messagesSent = 0;
+        quint64 sendFailures = 0;
+        quint64 addressClaimsSent = 0;
+        quint64 addressConflicts = 0;
+        quint64 requestsAnswered = 0;
+        double messagesPerSecond = 0.0;
+    };
+
+    static constexpr int MaxDevices = 252;
+    static constexpr uint8_t NullAddress = 254;
+    static constexpr uint8_t BroadcastAddress = 255;
+
+    VirtualN2kFleet(Nmea2000Handler &handler, PgnScheduler &scheduler, QObject *parent = nullptr);
+
+    int addDevice(const VirtualN2kDeviceConfig &config);
+    int addPgnStream(int device, unsigned long PGN, int periodMs, PgnGenerator generator);
+    void clear();
+
+    // Typical boat network: GPS, engines, tanks, wind and depth with their usual rates
+    void addStandardBoat(int engineCount = 2, int tankCount = 4);
+
+    // Without a shared clock the fleet runs on a private real-time one
+    void setClock(SimulationClock *simulationClock);
+    SimulationClock *getClock() const { return clock; }
+
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    int deviceCount() const { return static_cast<int>(devices.size()); }
+    const Device &device(int index) const { return devices[index]; }
+    int deviceAtAddress(uint8_t address) const { return addressOwner[address]; }
+    Statistics statistics() const;
+
+    static uint64_t buildName(const VirtualN2kDeviceConfig &config);
+
+signals:
+    void addressChanged(int device, uint8_t oldAddress, uint8_t newAddress);
+
+private:
+    Nmea2000Handler &handler;
+    PgnScheduler &scheduler;
+    SimulationClock *clock = nullptr;
+    qint64 startMs = 0;
+    bool running = false;
+    std::vector<Device> devices;
+    std::vector<int> streams;
+
+    // Local owner of each address (-1 if none) and addresses seen claimed by other nodes
+    std::array<int16_t, 256> addressOwner;
+    std::bitset<256> remoteOccupied;
+
+    Statistics stats;
+
+    static constexpr int ClaimSettleMs = 250;
+
+    // Simulated time since start()
+    qint64 elapsedMs() const { return clock ? clock->nowMs() - startMs : 0; }
+    bool isActive(Device &device);
+
+    void onAddressClaim(const tN2kMsg &N2kMsg);
+    void onIsoRequest(const tN2kMsg &N2kMsg);
+    void sendAddressClaim(int device);
+    void sendProductInformation(int device, uint8_t destination);
+    bool assignAddress(int device, uint8_t startAddress);
+    bool send(tN2kMsg &N2kMsg, int device);
+};
+
+#endif // VIRTUALN2KFLEET_H
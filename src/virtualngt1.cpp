@@ -0,0 +1,292 @@
+#include "virtualngt1.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "N2kMessages.h"
+#include "actisensecodec.h"
+#include "nmea2000_actisense.h"
+
+namespace {
+
+qint64 nowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+QString systemError(const char *what)
+{
+    return QString("%1: %2").arg(what, strerror(errno));
+}
+
+}
+
+VirtualNgt1::VirtualNgt1(size_t injectCapacity)
+    : injectQueue(injectCapacity)
+{
+}
+
+VirtualNgt1::~VirtualNgt1()
+{
+    stop();
+}
+
+bool VirtualNgt1::start(const Options &options, QString *error)
+{
+    if (isRunning()) {
+        return false;
+    }
+    endpointOptions = options;
+
+    QString failure;
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (masterFd < 0) {
+        failure = systemError("posix_openpt");
+    } else if (grantpt(masterFd) != 0 || unlockpt(masterFd) != 0) {
+        failure = systemError("unlockpt");
+    } else {
+        const char *name = ptsname(masterFd);
+        if (!name) {
+            failure = systemError("ptsname");
+        } else {
+            slaveName = QString::fromLocal8Bit(name);
+            slaveFd = ::open(name, O_RDWR | O_NOCTTY);
+            if (slaveFd < 0) {
+                failure = systemError("open pty slave");
+            }
+        }
+    }
+    if (failure.isEmpty()) {
+        // Raw until the host configures the port, so nothing is echoed or translated meanwhile
+        termios settings;
+        if (tcgetattr(slaveFd, &settings) == 0) {
+            cfmakeraw(&settings);
+            tcsetattr(slaveFd, TCSANOW, &settings);
+        }
+        fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+    }
+    if (!failure.isEmpty()) {
+        closePty();
+        if (error) {
+            *error = "Virtual NGT-1: " + failure;
+        }
+        return false;
+    }
+
+    parser.reset();
+    out.bytes.clear();
+    out.sent = 0;
+    generated = 0;
+    bytesFromHost = 0;
+    bytesToHost = 0;
+    messagesFromHost = 0;
+    commandsAcknowledged = 0;
+    messagesToHost = 0;
+    injectDropped = 0;
+    checksumErrors = 0;
+    framingErrors = 0;
+    stopRequested = false;
+    startUs = nowUs();
+
+    thread = QThread::create([this]() { run(); });
+    thread->setObjectName("VirtualNgt1");
+    thread->start();
+    return true;
+}
+
+void VirtualNgt1::stop()
+{
+    if (thread) {
+        stopRequested = true;
+        thread->wait();
+        delete thread;
+        thread = nullptr;
+    }
+    closePty();
+}
+
+void VirtualNgt1::closePty()
+{
+    if (slaveFd >= 0) {
+        ::close(slaveFd);
+        slaveFd = -1;
+    }
+    if (masterFd >= 0) {
+        ::close(masterFd);
+        masterFd = -1;
+    }
+}
+
+bool VirtualNgt1::inject(const tN2kMsg &N2kMsg)
+{
+    if (!injectQueue.tryPush(N2kMsg)) {
+        injectDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+VirtualNgt1::Statistics VirtualNgt1::statistics() const
+{
+    Statistics stats;
+    stats.bytesFromHost = bytesFromHost.load(std::memory_order_relaxed);
+    stats.bytesToHost = bytesToHost.load(std::memory_order_relaxed);
+    stats.messagesFromHost = messagesFromHost.load(std::memory_order_relaxed);
+    stats.commandsAcknowledged = commandsAcknowledged.load(std::memory_order_relaxed);
+    stats.messagesToHost = messagesToHost.load(std::memory_order_relaxed);
+    stats.injectDropped = injectDropped.load(std::memory_order_relaxed);
+    stats.checksumErrors = checksumErrors.load(std::memory_order_relaxed);
+    stats.framingErrors = framingErrors.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void VirtualNgt1::queueFrame(const uint8_t *message, int length)
+{
+    // Drop what the host already has before the buffer grows
+    if (out.sent > 0 && out.sent >= out.bytes.size() / 2) {
+        out.bytes.erase(out.bytes.begin(), out.bytes.begin() + static_cast<std::ptrdiff_t>(out.sent));
+        out.sent = 0;
+    }
+    const size_t used = out.bytes.size();
+    out.bytes.resize(used + ActisenseCodec::maxEncodedLength(length));
+    const int written = ActisenseCodec::encodeFrame(message, length, out.bytes.data() + used);
+    out.bytes.resize(used + static_cast<size_t>(written));
+}
+
+void VirtualNgt1::queueMessage(const tN2kMsg &N2kMsg, qint64 nowUs)
+{
+    uint8_t body[NMEA2000_Actisense::MaxBodyLen];
+    const uint32_t timestampMs = static_cast<uint32_t>((nowUs - startUs) / 1000);
+    const int length = NMEA2000_Actisense::encodeBody(N2kMsg, true, timestampMs, body, sizeof(body));
+    if (length > 0) {
+        queueFrame(body, length);
+        messagesToHost.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void VirtualNgt1::handleFrame(const ActisenseBstParser::Frame &frame, qint64 nowUs)
+{
+    if (NMEA2000_Actisense::isN2kBody(frame.command())) {
+        messagesFromHost.fetch_add(1, std::memory_order_relaxed);
+        tN2kMsg N2kMsg;
+        if (endpointOptions.loopback && NMEA2000_Actisense::decodeMessage(frame.data, frame.length, N2kMsg)) {
+            N2kMsg.Source = endpointOptions.address;
+            queueMessage(N2kMsg, nowUs);
+        }
+        return;
+    }
+    if (frame.command() != MsgTypeCommand || frame.payloadLength() == 0) {
+        return;
+    }
+
+    // Reply: BEM id, model, serial number, error code (0), then the rest of the command echoed back
+    constexpr int HeaderLen = 1 + 2 + 4 + 4;
+    const int echoed = std::min<int>(frame.payloadLength() - 1, 255 - HeaderLen);
+    uint8_t reply[2 + 255];
+    int pos = 0;
+    reply[pos++] = MsgTypeCommandReply;
+    reply[pos++] = static_cast<uint8_t>(HeaderLen + echoed);
+    reply[pos++] = frame.payload()[0];
+    reply[pos++] = ModelId & 0xFF;
+    reply[pos++] = ModelId >> 8;
+    for (int shift = 0; shift < 32; shift += 8) {
+        reply[pos++] = static_cast<uint8_t>(SerialNumber >> shift);
+    }
+    for (int i = 0; i < 4; i++) {
+        reply[pos++] = 0;
+    }
+    memcpy(reply + pos, frame.payload() + 1, static_cast<size_t>(echoed));
+    queueFrame(reply, pos + echoed);
+    commandsAcknowledged.fetch_add(1, std::memory_order_relaxed);
+}
+
+void VirtualNgt1::generate(qint64 nowUs)
+{
+    const int rate = endpointOptions.injectRate;
+    if (rate <= 0) {
+        return;
+    }
+    quint64 due = static_cast<quint64>((nowUs - startUs) * rate / 1000000);
+    // At most a second of backlog when the host stops reading for a while
+    if (due > generated + static_cast<quint64>(rate)) {
+        generated = due - static_cast<quint64>(rate);
+    }
+    tN2kMsg N2kMsg;
+    while (generated < due && out.pending() < OutHighWater) {
+        SetN2kPGN129025(N2kMsg, 60.0 + (generated % 100000) * 1e-6, 25.0);
+        N2kMsg.Source = endpointOptions.address;
+        queueMessage(N2kMsg, nowUs);
+        generated++;
+    }
+}
+
+void VirtualNgt1::run()
+{
+    const bool paced = endpointOptions.baudRate > 0;
+    const double bytesPerUs = paced ? endpointOptions.baudRate / (BitsPerByte * 1e6) : 0.0;
+    const double burst = std::max<double>(MinBurstBytes, BurstUs * bytesPerUs);
+    // Host to device and device to host token buckets, in bytes
+    double rxTokens = burst;
+    double txTokens = burst;
+    qint64 lastUs = nowUs();
+
+    uint8_t chunk[ReadChunkSize];
+    tN2kMsg N2kMsg;
+    while (!stopRequested.load(std::memory_order_relaxed)) {
+        const qint64 now = nowUs();
+        if (paced) {
+            rxTokens = std::min(burst, rxTokens + (now - lastUs) * bytesPerUs);
+            txTokens = std::min(burst, txTokens + (now - lastUs) * bytesPerUs);
+            lastUs = now;
+        }
+
+        // What the line cannot carry yet stays in the pty buffer and eventually blocks the host
+        const int readable = paced ? std::min(ReadChunkSize, static_cast<int>(rxTokens)) : ReadChunkSize;
+        if (readable > 0) {
+            const ssize_t count = ::read(masterFd, chunk, static_cast<size_t>(readable));
+            if (count > 0) {
+                rxTokens -= count;
+                bytesFromHost.fetch_add(static_cast<quint64>(count), std::memory_order_relaxed);
+                parser.feed(chunk, static_cast<int>(count), [this, now](const ActisenseBstParser::Frame &frame) {
+                    handleFrame(frame, now);
+                });
+                checksumErrors.store(parser.statistics().checksumErrors, std::memory_order_relaxed);
+                framingErrors.store(parser.statistics().framingErrors, std::memory_order_relaxed);
+            }
+        }
+
+        while (out.pending() < OutHighWater && injectQueue.tryPop(N2kMsg)) {
+            queueMessage(N2kMsg, now);
+        }
+        generate(now);
+
+        const size_t writable = paced ? std::min(out.pending(), static_cast<size_t>(txTokens)) : out.pending();
+        if (writable > 0) {
+            const ssize_t count = ::write(masterFd, out.bytes.data() + out.sent, writable);
+            if (count > 0) {
+                txTokens -= count;
+                out.sent += static_cast<size_t>(count);
+                bytesToHost.fetch_add(static_cast<quint64>(count), std::memory_order_relaxed);
+                if (out.sent == out.bytes.size()) {
+                    out.bytes.clear();
+                    out.sent = 0;
+                }
+            }
+        }
+
+        // Only wait for what the buckets allow, otherwise the timeout paces the loop
+        pollfd descriptor{masterFd, 0, 0};
+        if (!paced || rxTokens >= 1.0) {
+            descriptor.events |= POLLIN;
+        }
+        if (out.pending() > 0 && (!paced || txTokens >= 1.0)) {
+            descriptor.events |= POLLOUT;
+        }
+        poll(&descriptor, 1, PollTimeoutMs);
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef VIRTUALNGT1_H
+#define VIRTUALNGT1_H
+
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <vector>
+#include "N2kMsg.h"
+#include "actisensebstparser.h"
+#include "spscqueue.h"
+
+// Fake Actisense NGT-1 behind a pseudo-terminal, so the whole serial path (QSerialPort, ActisenseLink,
+// the BST codec and parser) runs without an adapter. start() opens a pty pair and hands out the slave
+// path as the port name; the endpoint keeps the master on its own thread and behaves like the device:
+//
+//   - BST from the host is parsed, N2K messages (0x94) are counted and with loopback come back as
+//     received (0x93) messages, the way a second device on the bus would see them
+//   - commands (0xA1) are answered with an 0xA0 reply echoing the command, as the NGT-1 does
+//   - injected messages and the optional generator are sent to the host as received messages
+//
+// Both directions are paced to the emulated baud rate (8N1, ten bits per byte) by a token bucket
+// that allows a couple of milliseconds of burst, so the host sees the same throughput ceiling as on
+// the real UART. Baud rate 0 disables pacing for raw pipeline throughput.
+class VirtualNgt1
+{
+public:
+    struct Options {
+        int baudRate = 115200;          // Emulated line rate, 0 runs unpaced
+        bool loopback = false;          // Echo messages sent by the host back as received
+        int injectRate = 0;             // Generated 129025 messages per second, 0 disables the generator
+        uint8_t address = 35;           // Bus address of the adapter, source of looped back and generated messages
+    };
+
+    struct Statistics {
+        quint64 bytesFromHost = 0;
+        quint64 bytesToHost = 0;
+        quint64 messagesFromHost = 0;   // N2K messages the host sent
+        quint64 commandsAcknowledged = 0;
+        quint64 messagesToHost = 0;     // Loopback, injected and generated
+        quint64 injectDropped = 0;      // inject() calls refused because the queue was full
+        quint64 checksumErrors = 0;
+        quint64 framingErrors = 0;
+    };
+
+    explicit VirtualNgt1(size_t injectCapacity = 4096);
+    ~VirtualNgt1();
+
+    VirtualNgt1(const VirtualNgt1 &) = delete;
+    VirtualNgt1 &operator=(const VirtualNgt1 &) = delete;
+
+    bool start(const Options &options, QString *error = nullptr);
+    void stop();
+    bool isRunning() const { return thread != nullptr; }
+    // Slave side of the pty, for QSerialPort
+    const QString &portName() const { return slaveName; }
+
+    // Queue a message for the host as if it came off the bus. One producer thread at a time.
+    bool inject(const tN2kMsg &N2kMsg);
+    Statistics statistics() const;
+
+private:
+    struct OutBuffer {
+        std::vector<uint8_t> bytes;
+        size_t sent = 0;
+
+        size_t pending() const { return bytes.size() - sent; }
+    };
+
+    // 8N1 framing, and the burst the token buckets allow
+    static constexpr int BitsPerByte = 10;
+    static constexpr qint64 BurstUs = 2000;
+    static constexpr int MinBurstBytes = 64;
+    static constexpr int ReadChunkSize = 4096;
+    // Stop filling the host buffer above this, the rest waits in the queues
+    static constexpr size_t OutHighWater = 64 * 1024;
+    static constexpr int PollTimeoutMs = 1;
+
+    static constexpr uint8_t MsgTypeCommand = 0xA1;
+    static constexpr uint8_t MsgTypeCommandReply = 0xA0;
+    static constexpr uint16_t ModelId = 0x000E;     // NGT-1
+    static constexpr uint32_t SerialNumber = 0x00100001;
+
+    void run();
+    void handleFrame(const ActisenseBstParser::Frame &frame, qint64 nowUs);
+    void queueFrame(const uint8_t *message, int length);
+    void queueMessage(const tN2kMsg &N2kMsg, qint64 nowUs);
+    void generate(qint64 nowUs);
+    void closePty();
+
+    Options endpointOptions;
+    int masterFd = -1;
+    int slaveFd = -1;           // Held open so the master never sees a hangup between host opens
+    QString slaveName;
+    QThread *thread = nullptr;
+    std::atomic<bool> stopRequested{false};
+
+    // Endpoint thread only
+    ActisenseBstParser parser;
+    OutBuffer out;
+    qint64 startUs = 0;
+    quint64 generated = 0;
+
+    SpscQueue<tN2kMsg> injectQueue;
+    std::atomic<quint64> bytesFromHost{0};
+    std::atomic<quint64> bytesToHost{0};
+    std::atomic<quint64> messagesFromHost{0};
+    std::atomic<quint64> commandsAcknowledged{0};
+    std::atomic<quint64> messagesToHost{0};
+    std::atomic<quint64> injectDropped{0};
+    std::atomic<quint64> checksumErrors{0};
+    std::atomic<quint64> framingErrors{0};
+};
+
+#endif // VIRTUALNGT1_H